@@ -0,0 +1,113 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef AABB_H
+#define AABB_H
+
+/* Axis-aligned bounding box, one interval per axis */
+class aabb
+{
+  public:
+	interval x, y, z;
+
+	aabb() {} // The default box is empty, since intervals are empty by default
+
+	aabb(const interval& x, const interval& y, const interval& z) : x(x), y(y), z(z) {}
+
+	// Box spanning two extrema in any order
+	aabb(const point3& a, const point3& b)
+	{
+		x = (a[0] <= b[0]) ? interval(a[0], b[0]) : interval(b[0], a[0]);
+		y = (a[1] <= b[1]) ? interval(a[1], b[1]) : interval(b[1], a[1]);
+		z = (a[2] <= b[2]) ? interval(a[2], b[2]) : interval(b[2], a[2]);
+	}
+
+	// Tightest box enclosing both boxes
+	aabb(const aabb& box0, const aabb& box1) : x(box0.x, box1.x), y(box0.y, box1.y), z(box0.z, box1.z) {}
+
+	const interval& axis_interval(int n) const
+	{
+		if (n == 1) return y;
+		if (n == 2) return z;
+		return x;
+	}
+
+	/*
+	 * Slab test against a precomputed inverse ray direction, narrows ray_t to the overlap on a hit.
+	 * The near and far side of each slab are picked by selects and the overlap is checked once at
+	 * the end, so the loop compiles without data dependent branches.
+	 */
+	bool hit(const point3& origin, const vec3& inv_dir, interval& ray_t) const
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const interval& ax = axis_interval(axis);
+			double t0 = (ax.min - origin[axis]) * inv_dir[axis];
+			double t1 = (ax.max - origin[axis]) * inv_dir[axis];
+			bool flip = inv_dir[axis] < 0;
+			double t_near = flip ? t1 : t0;
+			double t_far = flip ? t0 : t1;
+
+			// Written so a NaN from a ray starting on a slab plane leaves the bounds alone
+			ray_t.min = t_near > ray_t.min ? t_near : ray_t.min;
+			ray_t.max = t_far < ray_t.max ? t_far : ray_t.max;
+		}
+		return ray_t.min <= ray_t.max;
+	}
+
+	bool hit(const ray& r, interval ray_t) const
+	{
+		return hit(r.origin(), r.inverse_direction(), ray_t);
+	}
+
+	bool contains(const point3& p) const
+	{
+		return x.contains(p.x()) && y.contains(p.y()) && z.contains(p.z());
+	}
+
+	// Whether every side is finite, unbounded geometry such as planes reports the universe box
+	bool is_bounded() const
+	{
+		return std::isfinite(x.size()) && std::isfinite(y.size()) && std::isfinite(z.size());
+	}
+
+	bool is_empty() const
+	{
+		return x.size() < 0 || y.size() < 0 || z.size() < 0;
+	}
+
+	int longest_axis() const
+	{
+		if (x.size() > y.size())
+			return x.size() > z.size() ? 0 : 2;
+		return y.size() > z.size() ? 1 : 2;
+	}
+
+	double surface_area() const
+	{
+		if (is_empty())
+			return 0;
+		return 2 * (x.size() * y.size() + y.size() * z.size() + z.size() * x.size());
+	}
+
+	point3 centroid() const
+	{
+		return point3(0.5 * (x.min + x.max), 0.5 * (y.min + y.max), 0.5 * (z.min + z.max));
+	}
+
+	// Overlap of two boxes, empty when they are disjoint
+	static aabb intersect(const aabb& a, const aabb& b)
+	{
+		return aabb(interval(std::fmax(a.x.min, b.x.min), std::fmin(a.x.max, b.x.max)),
+					interval(std::fmax(a.y.min, b.y.min), std::fmin(a.y.max, b.y.max)),
+					interval(std::fmax(a.z.min, b.z.min), std::fmin(a.z.max, b.z.max)));
+	}
+
+	static const aabb empty, universe;
+};
+
+const aabb aabb::empty    = aabb(interval::empty, interval::empty, interval::empty);
+const aabb aabb::universe = aabb(interval::universe, interval::universe, interval::universe);
+
+#endif
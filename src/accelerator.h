@@ -0,0 +1,137 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef ACCELERATOR_H
+#define ACCELERATOR_H
+
+#include "bvh.h"
+#include "compile.h"
+#include "grid.h"
+#include "hittable.h"
+#include "quadric.h"
+
+#include <algorithm>
+#include <vector>
+
+/* Shape of a scene's bounded objects, enough to tell whether a uniform grid will suit it */
+struct scene_statistics
+{
+	size_t bounded = 0;
+	size_t unbounded = 0;
+	double size_variation = 0; // Coefficient of variation of the box diagonals
+	double empty_cells = 0;    // Fraction of empty cells in a one-object-per-cell grid over the centroids
+	double peak_occupancy = 0; // Fullest of those cells against the mean of the occupied ones
+
+	static scene_statistics measure(const std::vector<shared_ptr<hittable>>& objects)
+	{
+		scene_statistics stats;
+		std::vector<aabb> boxes;
+		aabb bounds;
+		double sum = 0, sum_squares = 0;
+		for (const auto& object : objects)
+		{
+			aabb box = object->bounding_box();
+			if (!box.is_bounded())
+			{
+				stats.unbounded++;
+				continue;
+			}
+			double diagonal = std::sqrt(box.x.size() * box.x.size() + box.y.size() * box.y.size() + box.z.size() * box.z.size());
+			sum += diagonal;
+			sum_squares += diagonal * diagonal;
+			bounds = aabb(bounds, aabb(box.centroid(), box.centroid()));
+			boxes.push_back(box);
+		}
+		stats.bounded = boxes.size();
+		if (boxes.empty())
+			return stats;
+
+		double mean = sum / boxes.size();
+		double variance = std::max(0.0, sum_squares / boxes.size() - mean * mean);
+		stats.size_variation = mean > 0 ? std::sqrt(variance) / mean : 0;
+
+		// Bin the centroids over only the axes they spread along, so a ground layer counts as 2D
+		int resolution[3];
+		double extent[3], volume = 1;
+		int spread_axes = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			extent[axis] = bounds.axis_interval(axis).size();
+			if (extent[axis] > 1e-3 * mean)
+			{
+				volume *= extent[axis];
+				spread_axes++;
+			}
+		}
+		double cells_per_unit = spread_axes ? std::pow(boxes.size() / volume, 1.0 / spread_axes) : 0;
+		for (int axis = 0; axis < 3; axis++)
+			resolution[axis] = extent[axis] > 1e-3 * mean ? std::clamp(int(extent[axis] * cells_per_unit), 1, 256) : 1;
+
+		std::vector<uint32_t> counts(size_t(resolution[0]) * resolution[1] * resolution[2], 0);
+		for (const auto& box : boxes)
+		{
+			point3 c = box.centroid();
+			size_t index = 0;
+			for (int axis = 2; axis >= 0; axis--)
+			{
+				const interval& range = bounds.axis_interval(axis);
+				int cell = range.size() > 0 ? int((c[axis] - range.min) / range.size() * resolution[axis]) : 0;
+				index = index * resolution[axis] + std::clamp(cell, 0, resolution[axis] - 1);
+			}
+			counts[index]++;
+		}
+		size_t occupied = 0;
+		uint32_t peak = 0;
+		for (uint32_t count : counts)
+		{
+			occupied += count > 0;
+			peak = std::max(peak, count);
+		}
+		stats.empty_cells = 1.0 - double(occupied) / counts.size();
+		stats.peak_occupancy = peak / (double(boxes.size()) / occupied);
+		return stats;
+	}
+
+	/*
+	 * Grids win on many similar objects spread evenly, where their O(n) build and cheap cell steps pay off.
+	 * Mixed sizes leave big objects in many cells, and clusters leave cells empty or crowded, so those go to the BVH.
+	 */
+	bool prefers_grid() const
+	{
+		return bounded >= 64 && size_variation < 0.5 && empty_cells < 0.5 && peak_occupancy < 6;
+	}
+};
+
+/* Below this many quadrics a quadric_set's leaves would be too few to pay for its own tree */
+const size_t quadric_set_minimum = 16;
+
+/*
+ * Simplifies the objects, then builds whichever of a grid or a BVH suits them. Enough
+ * quadrics are first pulled out into one quadric_set, which the outer structure holds.
+ */
+inline shared_ptr<hittable> build_accelerator(const std::vector<shared_ptr<hittable>>& objects)
+{
+	std::vector<shared_ptr<hittable>> simplified = simplify(objects);
+	std::vector<shared_ptr<quadric>> quadrics;
+	for (const auto& object : simplified)
+	{
+		if (auto q = std::dynamic_pointer_cast<quadric>(object))
+			quadrics.push_back(q);
+	}
+	if (quadrics.size() >= quadric_set_minimum)
+	{
+		std::erase_if(simplified, [](const shared_ptr<hittable>& object) { return bool(std::dynamic_pointer_cast<quadric>(object)); });
+		simplified.push_back(make_shared<quadric_set>(quadrics));
+	}
+	if (scene_statistics::measure(simplified).prefers_grid())
+		return make_shared<grid_accel>(simplified);
+	return make_shared<bvh>(simplified);
+}
+
+inline shared_ptr<hittable> build_accelerator(const hittable_list& list)
+{
+	return build_accelerator(list.objects);
+}
+
+#endif
@@ -0,0 +1,180 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "bvh.h"
+#include "camera.h"
+#include "hittable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* Camera placement at a point in time, in seconds */
+struct camera_keyframe
+{
+	double time;
+	point3 lookfrom;
+	point3 lookat;
+	double vfov;
+	double focus_dist;
+};
+
+/*
+ * Keyframed camera motion. Positions follow a Catmull-Rom spline through the keys,
+ * so paths are smooth, while the field of view and focus distance blend linearly.
+ */
+class camera_path
+{
+  public:
+	void add(const camera_keyframe& key)
+	{
+		auto position = std::upper_bound(keys.begin(), keys.end(), key.time,
+			[](double time, const camera_keyframe& k) { return time < k.time; });
+		keys.insert(position, key);
+	}
+
+	bool empty() const { return keys.empty(); }
+
+	double duration() const
+	{
+		return keys.empty() ? 0 : keys.back().time - keys.front().time;
+	}
+
+	/* Placement at time, held at the first or last key outside the path */
+	camera_keyframe at(double time) const
+	{
+		if (keys.size() == 1 || time <= keys.front().time)
+			return keys.front();
+		if (time >= keys.back().time)
+			return keys.back();
+
+		size_t i = 0;
+		while (keys[i + 1].time < time)
+			i++;
+		const camera_keyframe& k0 = keys[i == 0 ? 0 : i - 1];
+		const camera_keyframe& k1 = keys[i];
+		const camera_keyframe& k2 = keys[i + 1];
+		const camera_keyframe& k3 = keys[std::min(i + 2, keys.size() - 1)];
+		double s = (time - k1.time) / (k2.time - k1.time);
+
+		camera_keyframe key;
+		key.time = time;
+		key.lookfrom = catmull_rom(k0.lookfrom, k1.lookfrom, k2.lookfrom, k3.lookfrom, s);
+		key.lookat = catmull_rom(k0.lookat, k1.lookat, k2.lookat, k3.lookat, s);
+		key.vfov = (1 - s) * k1.vfov + s * k2.vfov;
+		key.focus_dist = (1 - s) * k1.focus_dist + s * k2.focus_dist;
+		return key;
+	}
+
+	void apply(camera& cam, double time) const
+	{
+		camera_keyframe key = at(time);
+		cam.lookfrom = key.lookfrom;
+		cam.lookat = key.lookat;
+		cam.vfov = key.vfov;
+		cam.focus_dist = key.focus_dist;
+	}
+
+  private:
+	std::vector<camera_keyframe> keys; // Sorted by time
+
+	static point3 catmull_rom(const point3& p0, const point3& p1, const point3& p2, const point3& p3, double s)
+	{
+		double s2 = s * s, s3 = s2 * s;
+		return 0.5 * ((2 * p1) + (-1 * p0 + p2) * s + (2 * p0 - 5 * p1 + 4 * p2 - p3) * s2
+			+ (-1 * p0 + 3 * p1 - 3 * p2 + p3) * s3);
+	}
+};
+
+/*
+ * Renders a numbered frame sequence of one resident scene. Each frame is encoded in the
+ * background while the next one traces, and per-frame costs are reported at the end.
+ */
+class animation
+{
+  public:
+	int frame_count = 48;
+	double frames_per_second = 24;
+	std::string frame_pattern = "frame_%04d.png"; // printf pattern taking the frame number
+
+	// Seconds the caller spent building the scene and its acceleration structures, for the report
+	double scene_build_seconds = 0;
+
+	// Optional per-frame scene changes, called before the frame renders
+	std::function<void(int frame, double time)> update;
+
+	// Hierarchies over animated objects, brought up to date after every update
+	std::vector<shared_ptr<bvh>> accelerators;
+
+	void render(camera& cam, const hittable& scene, const camera_path& path)
+	{
+		cam.background_output = true;
+		cam.checkpoint_file = ""; // A checkpoint belongs to one frame, sequences restart whole frames
+
+		double total_overhead = 0, total_trace = 0;
+		for (int frame = 0; frame < frame_count; frame++)
+		{
+			double time = frame / frames_per_second;
+			if (!path.empty())
+				path.apply(cam, time);
+
+			double update_seconds = 0;
+			if (update)
+			{
+				auto update_start = std::chrono::steady_clock::now();
+				update(frame, time);
+				update_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - update_start).count();
+			}
+
+			double accel_seconds = 0;
+			std::ostringstream accel_report;
+			for (const auto& accelerator : accelerators)
+			{
+				auto report = accelerator->update();
+				accel_seconds += report.seconds;
+				accel_report << (report.rebuilt ? ", rebuild " : ", refit ") << milliseconds(report.seconds)
+					<< " ms (SAH x" << std::round(report.sah_ratio * 1000) / 1000 << ")";
+			}
+
+			char filename[512];
+			std::snprintf(filename, sizeof(filename), frame_pattern.c_str(), frame);
+			cam.output_file = filename;
+			std::clog << "Frame " << frame + 1 << "/" << frame_count << " (" << filename << ")\n";
+			cam.render(scene);
+
+			double overhead = update_seconds + accel_seconds + cam.timings.setup + cam.timings.output;
+			total_overhead += overhead;
+			total_trace += cam.timings.trace;
+			std::clog << "  update " << milliseconds(update_seconds) << " ms" << accel_report.str()
+				<< ", setup " << milliseconds(cam.timings.setup)
+				<< " ms, trace " << milliseconds(cam.timings.trace) << " ms, output wait "
+				<< milliseconds(cam.timings.output) << " ms\n";
+		}
+		cam.finish_output();
+
+		if (frame_count > 0)
+		{
+			std::clog << "Per-frame overhead " << milliseconds(total_overhead / frame_count) << " ms against "
+				<< milliseconds(total_trace / frame_count) << " ms of tracing.\n"
+				<< "Relaunching the binary per frame would add the " << milliseconds(scene_build_seconds)
+				<< " ms scene build to every frame, " << milliseconds(scene_build_seconds * frame_count)
+				<< " ms over the sequence, plus process start-up.\n";
+		}
+	}
+
+  private:
+	static double milliseconds(double seconds)
+	{
+		return std::round(seconds * 1e5) / 100;
+	}
+};
+
+#endif
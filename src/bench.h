@@ -0,0 +1,1222 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "accelerator.h"
+#include "box.h"
+#include "bvh.h"
+#include "compressed_bvh.h"
+#include "cone.h"
+#include "convex_polyhedron.h"
+#include "csg.h"
+#include "grid.h"
+#include "lazy_bvh.h"
+#include "hittable.h"
+#include "infinite_cone.h"
+#include "material.h"
+#include "mesh.h"
+#include "obj_loader.h"
+#include "plane.h"
+#include "ply_loader.h"
+#include "procedural.h"
+#include "quadric.h"
+#include "ray_order.h"
+#include "scene_file.h"
+#include "sdf.h"
+#include "sphere.h"
+#include "stats.h"
+#include "snapshot.h"
+#include "streamed_mesh.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Builds and traces one named scene under each accelerator, printing one table row per structure */
+class accelerator_benchmark
+{
+  public:
+	int ray_count = 1000000;
+
+	void run(const std::string& name, const std::vector<shared_ptr<hittable>>& objects)
+	{
+		scene_statistics stats = scene_statistics::measure(objects);
+		std::printf("%s: %zu objects, size variation %.2f, empty cells %.0f%%, peak occupancy x%.1f, chooser picks %s\n",
+			name.c_str(), stats.bounded, stats.size_variation, 100 * stats.empty_cells, stats.peak_occupancy,
+			stats.prefers_grid() ? "grid" : "bvh");
+
+		std::vector<ray> rays = make_rays(objects);
+		std::vector<double> reference;
+		measure("bvh", [&] { return make_shared<bvh>(objects); }, rays, reference);
+		measure("grid", [&] { return make_shared<grid_accel>(objects); }, rays, reference);
+	}
+
+	/*
+	 * Plain SAH against spatial splits at growing duplication budgets, on camera rays from
+	 * viewpoint towards target and bounce rays leaving the y = 0 ground inside ground_extent.
+	 */
+	void compare_splits(const std::string& name, const std::vector<shared_ptr<hittable>>& objects,
+						const point3& viewpoint, const point3& target, double ground_extent)
+	{
+		std::printf("%s: %zu objects\n", name.c_str(), objects.size());
+		std::vector<ray> rays = camera_rays(viewpoint, target, ray_count / 2);
+		for (int i = 0; i < ray_count / 2; i++)
+		{
+			point3 origin(random_double(-ground_extent, ground_extent), 0.001, random_double(-ground_extent, ground_extent));
+			rays.push_back(ray(origin, random_on_hemisphere(vec3(0, 1, 0))));
+		}
+
+		std::vector<double> reference;
+		for (double budget : { 0.0, 0.1, 0.3, 1.0 })
+		{
+			shared_ptr<bvh> accelerator;
+			char label[32];
+			std::snprintf(label, sizeof(label), budget > 0 ? "sbvh %.1f" : "sah", budget);
+			measure(label, [&] { return accelerator = make_shared<bvh>(objects, budget); }, rays, reference);
+			std::printf("             %zu nodes, %zu references\n",
+				accelerator->hierarchy().nodes.size(), accelerator->hierarchy().indices.size());
+		}
+	}
+
+	/* Binary bvh against the quantized four-wide layout on uniform clouds of growing size */
+	void compare_layouts()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		for (int n : { 100000, 1000000, 4000000 })
+		{
+			std::vector<shared_ptr<hittable>> cloud;
+			cloud.reserve(n);
+			double extent = std::cbrt(double(n)) * 1.5;
+			for (int i = 0; i < n; i++)
+				cloud.push_back(make_shared<sphere>(point3::random(-extent, extent), 0.3, mat));
+			std::printf("uniform cloud %d\n", n);
+
+			std::vector<ray> rays = make_rays(cloud);
+			std::vector<double> reference;
+			size_t bytes = 0;
+			measure("bvh", [&]
+			{
+				auto accelerator = make_shared<bvh>(cloud);
+				const bvh_tree& tree = accelerator->hierarchy();
+				bytes = tree.nodes.size() * sizeof(bvh_node) + tree.indices.size() * sizeof(uint32_t)
+					+ cloud.size() * sizeof(shared_ptr<hittable>);
+				return accelerator;
+			}, rays, reference);
+			std::printf("             %.1f bytes per object\n", double(bytes) / n);
+			measure("compressed", [&]
+			{
+				auto accelerator = make_shared<compressed_bvh>(cloud);
+				bytes = accelerator->footprint();
+				return accelerator;
+			}, rays, reference);
+			std::printf("             %.1f bytes per object\n", double(bytes) / n);
+		}
+	}
+
+	/*
+	 * Time to a first 1 spp preview of a large ground layer seen from one corner, a full
+	 * build against lazy_bvh, which only splits the nodes the preview rays reach.
+	 */
+	void compare_lazy()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		std::vector<shared_ptr<hittable>> layer;
+		for (int a = -700; a < 700; a++)
+			for (int b = -700; b < 700; b++)
+				layer.push_back(make_shared<sphere>(point3(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double()), 0.2, mat));
+		std::printf("ground layer %zu, 320x180 preview from a corner\n", layer.size());
+		std::vector<ray> preview = camera_rays(point3(-705, 3, -705), point3(-680, 0, -690), 320 * 180);
+
+		std::vector<double> reference, distances;
+		auto start = std::chrono::steady_clock::now();
+		auto full = make_shared<bvh>(layer);
+		double build_seconds = seconds_since(start);
+		double trace_seconds = trace(*full, preview, reference);
+		std::printf("  bvh   build %8.2f ms, preview %7.2f ms, first image after %8.2f ms, %zu nodes\n",
+			build_seconds * 1e3, trace_seconds * 1e3, (build_seconds + trace_seconds) * 1e3, full->hierarchy().nodes.size());
+
+		start = std::chrono::steady_clock::now();
+		auto lazy = make_shared<lazy_bvh>(layer);
+		double setup_seconds = seconds_since(start);
+		double first_seconds = trace(*lazy, preview, distances);
+		size_t first_nodes = lazy->built_nodes();
+		double second_seconds = trace(*lazy, preview, distances);
+
+		long mismatches = 0;
+		for (size_t i = 0; i < preview.size(); i++)
+			mismatches += distances[i] != reference[i];
+		std::printf("  lazy  setup %8.2f ms, preview %7.2f ms, first image after %8.2f ms, %zu nodes (%.2f%%)\n"
+			"        second preview %7.2f ms, %ld mismatches\n",
+			setup_seconds * 1e3, first_seconds * 1e3, (setup_seconds + first_seconds) * 1e3, first_nodes,
+			100.0 * first_nodes / (2 * layer.size() - 1), second_seconds * 1e3, mismatches);
+	}
+
+	/*
+	 * A field of spheres generated cell by cell, once up front under a bvh and once on demand by
+	 * procedural_field, timed to a first 320x180 preview from one corner. The on-demand field is
+	 * traced again with a cache too small for the preview, so evicted cells must come back the
+	 * same, and then grown to ten billion cells, which could never be generated up front.
+	 */
+	void compare_procedural()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		cell_generator scatter = [mat](const aabb& cell, std::vector<shared_ptr<hittable>>& objects)
+		{
+			if (random_double() < 0.2)
+				return;
+			double radius = random_double(0.1, 0.3);
+			point3 center(random_double(cell.x.min + radius, cell.x.max - radius), radius,
+						  random_double(cell.z.min + radius, cell.z.max - radius));
+			objects.push_back(make_shared<sphere>(center, radius, mat));
+		};
+		auto field_of = [&](double half_width, size_t budget)
+		{
+			aabb bounds(point3(-half_width, 0, -half_width), point3(half_width, 0.6, half_width));
+			return make_shared<procedural_field>(bounds, vec3(1, 0.6, 1), 7, scatter, budget);
+		};
+		auto report = [](const char* label, double setup_seconds, double first_seconds, double second_seconds,
+						 const procedural_field& field, long mismatches)
+		{
+			cache_statistics stats = field.statistics();
+			std::printf("  %-9s setup %8.2f ms, preview %7.2f ms, first image after %8.2f ms, second preview %7.2f ms\n"
+				"            %zu of %llu cells resident holding %zu objects, %.1f%% hits, %llu evictions, %ld mismatches\n",
+				label, setup_seconds * 1e3, first_seconds * 1e3, (setup_seconds + first_seconds) * 1e3, second_seconds * 1e3,
+				stats.resident, (unsigned long long)field.cell_count(), stats.cost - stats.resident, 100 * stats.hit_rate(),
+				(unsigned long long)stats.evictions, mismatches);
+		};
+
+		std::vector<ray> preview = camera_rays(point3(-705, 3, -705), point3(-680, 0, -690), 320 * 180);
+		std::printf("sphere field over 1400x1400 cells, 320x180 preview from a corner\n");
+
+		std::vector<double> reference, distances;
+		auto start = std::chrono::steady_clock::now();
+		std::vector<shared_ptr<hittable>> all = field_of(700, 0)->generate_all();
+		auto full = make_shared<bvh>(all);
+		double build_seconds = seconds_since(start);
+		double trace_seconds = trace(*full, preview, reference);
+		std::printf("  up front  build %8.2f ms, preview %7.2f ms, first image after %8.2f ms, %zu objects\n",
+			build_seconds * 1e3, trace_seconds * 1e3, (build_seconds + trace_seconds) * 1e3, all.size());
+		all.clear();
+		full.reset();
+
+		auto count_mismatches = [&]
+		{
+			long mismatches = 0;
+			for (size_t i = 0; i < preview.size(); i++)
+				mismatches += distances[i] != reference[i];
+			return mismatches;
+		};
+		for (size_t budget : { size_t(1) << 20, size_t(2048) })
+		{
+			start = std::chrono::steady_clock::now();
+			auto field = field_of(700, budget);
+			double setup_seconds = seconds_since(start);
+			double first_seconds = trace(*field, preview, distances);
+			long mismatches = count_mismatches();
+			double second_seconds = trace(*field, preview, distances);
+			report(budget > 2048 ? "on demand" : "tiny cache", setup_seconds, first_seconds, second_seconds, *field,
+				mismatches + count_mismatches());
+		}
+
+		std::printf("sphere field over 100000x100000 cells, same preview from its corner\n");
+		for (ray& r : preview)
+			r = ray(r.origin() - vec3(49300, 0, 49300), r.direction());
+		start = std::chrono::steady_clock::now();
+		auto landscape = field_of(50000, size_t(1) << 20);
+		double setup_seconds = seconds_since(start);
+		double first_seconds = trace(*landscape, preview, distances);
+		double second_seconds = trace(*landscape, preview, distances);
+		report("on demand", setup_seconds, first_seconds, second_seconds, *landscape, 0);
+	}
+
+	/*
+	 * Loads an OBJ mesh, writing a bumpy sphere of about three million triangles there first if the
+	 * file does not exist, then reports the load and build times, memory per triangle and trace speed.
+	 */
+	void load_mesh(const std::string& filename)
+	{
+		if (!std::filesystem::exists(filename))
+			write_bumpy_sphere(filename, 1225);
+
+		auto start = std::chrono::steady_clock::now();
+		shared_ptr<mesh_buffers> buffers = obj_loader::load(filename);
+		double load_seconds = seconds_since(start);
+		if (!buffers)
+			return;
+		size_t triangles = buffers->triangle_count;
+		double megabytes = std::filesystem::file_size(filename) / 1e6;
+		std::printf("%s: %.0f MB, %zu vertices, %zu triangles\n", filename.c_str(), megabytes, buffers->vertex_count, triangles);
+		std::printf("  load  %8.2f ms, %.0f MB/s, %.1f bytes per triangle of mesh data\n",
+			load_seconds * 1e3, megabytes / load_seconds, double(buffers->owned_bytes()) / triangles);
+
+		start = std::chrono::steady_clock::now();
+		auto mesh = make_shared<triangle_mesh>(buffers, make_shared<lambertian>(color(0.5, 0.5, 0.5)));
+		double build_seconds = seconds_since(start);
+		std::printf("  build %8.2f ms, %.1f bytes per triangle with the bvh\n",
+			build_seconds * 1e3, double(mesh->memory_bytes()) / triangles);
+
+		aabb box = mesh->bounding_box();
+		point3 center = box.centroid();
+		double reach = box.x.size() + box.y.size() + box.z.size();
+		std::vector<ray> rays = camera_rays(center + reach * vec3(0.8, 0.3, 0.6), center, ray_count);
+		std::vector<double> distances;
+		double trace_seconds = trace(*mesh, rays, distances);
+		long hits = 0;
+		for (double d : distances)
+			hits += d < infinity;
+		std::printf("  trace %6.2f Mrays/s, %.0f%% hit\n", rays.size() / trace_seconds * 1e-6, 100.0 * hits / rays.size());
+	}
+
+	/*
+	 * Disk to first pixel for a ten million triangle PLY: mapping and checking or converting the
+	 * file, building the mesh BVH and tracing a 320x180 preview. Runs once on a file in the layout
+	 * meshes use in place and once on one that needs converting, writing both if missing.
+	 */
+	void load_ply(const std::string& directory)
+	{
+		const int resolution = 2237;
+		for (bool packed : { true, false })
+		{
+			std::string filename = directory + (packed ? "/bench_packed.ply" : "/bench_converted.ply");
+			if (!std::filesystem::exists(filename))
+				write_bumpy_sphere_ply(filename, resolution, packed);
+
+			auto start = std::chrono::steady_clock::now();
+			shared_ptr<mesh_buffers> buffers = ply_loader::load(filename);
+			double load_seconds = seconds_since(start);
+			if (!buffers)
+				return;
+			auto mesh = make_shared<triangle_mesh>(buffers, make_shared<lambertian>(color(0.5, 0.5, 0.5)));
+			double build_seconds = seconds_since(start) - load_seconds;
+
+			aabb box = mesh->bounding_box();
+			point3 center = box.centroid();
+			double reach = box.x.size() + box.y.size() + box.z.size();
+			std::vector<ray> preview = camera_rays(center + reach * vec3(0.8, 0.3, 0.6), center, 320 * 180);
+			std::vector<double> distances;
+			double preview_seconds = trace(*mesh, preview, distances);
+
+			std::printf("%s: %.0f MB, %zu triangles, %s\n", filename.c_str(), std::filesystem::file_size(filename) / 1e6,
+				buffers->triangle_count, ply_loader::zero_copy(*buffers) ? "used in place" : "converted");
+			std::printf("  load %8.2f ms, build %8.2f ms, preview %7.2f ms, first image after %8.2f ms\n",
+				load_seconds * 1e3, build_seconds * 1e3, preview_seconds * 1e3,
+				(load_seconds + build_seconds + preview_seconds) * 1e3);
+			std::printf("  %.1f bytes per triangle copied out of the file, %.1f with the bvh\n",
+				double(buffers->owned_bytes()) / buffers->triangle_count, double(mesh->memory_bytes()) / buffers->triangle_count);
+		}
+	}
+
+	/*
+	 * The sphere and infinite_cone classes against the same shapes as quadrics, then a bvh over
+	 * single quadrics against quadric_set, which intersects a whole leaf at once, on a mix of
+	 * every shape and on spheres alone.
+	 */
+	void compare_quadrics()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		std::vector<shared_ptr<hittable>> probe = { make_shared<sphere>(point3(0, 0, 0), 4, mat) };
+		std::vector<ray> rays = make_rays(probe);
+		std::vector<double> reference;
+		std::printf("one sphere\n");
+		measure("sphere", [&] { return make_shared<sphere>(point3(0, 0, 0), 2, mat); }, rays, reference);
+		measure("quadric", [&] { return quadric::make_sphere(point3(0, 0, 0), 2, mat); }, rays, reference);
+		reference.clear();
+		std::printf("one infinite cone\n");
+		measure("cone", [&] { return make_shared<infinite_cone>(point3(0, 0, 0), vec3(0, 1, 0), 30, mat); }, rays, reference);
+		measure("quadric", [&] { return quadric::make_infinite_cone(point3(0, 0, 0), vec3(0, 1, 0), 30, mat); }, rays, reference);
+
+		const int n = 200000;
+		double extent = std::cbrt(double(n)) * 1.5;
+		for (bool mixed : { true, false })
+		{
+			std::vector<shared_ptr<quadric>> quadrics;
+			std::vector<shared_ptr<hittable>> spheres;
+			for (int i = 0; i < n; i++)
+			{
+				point3 center = point3::random(-extent, extent);
+				vec3 axis = random_unit_vector();
+				switch (mixed ? i % 5 : 0)
+				{
+				case 0:
+					quadrics.push_back(quadric::make_sphere(center, 0.3, mat));
+					spheres.push_back(make_shared<sphere>(center, 0.3, mat));
+					break;
+				case 1: quadrics.push_back(quadric::make_cylinder(center, axis, 0.2, 0.6, mat)); break;
+				case 2: quadrics.push_back(quadric::make_cone(center, axis, 25, 0.6, mat)); break;
+				case 3: quadrics.push_back(quadric::make_paraboloid(center, axis, 0.3, 0.6, mat)); break;
+				case 4: quadrics.push_back(quadric::make_hyperboloid(center, axis, 0.15, 0.3, 0.6, mat)); break;
+				}
+			}
+			std::vector<shared_ptr<hittable>> objects(quadrics.begin(), quadrics.end());
+			std::printf("%s %d\n", mixed ? "mixed quadrics" : "sphere quadrics", n);
+			rays = make_rays(objects);
+			reference.clear();
+			if (!mixed)
+				measure("spheres", [&] { return make_shared<bvh>(spheres); }, rays, reference);
+			measure("bvh", [&] { return make_shared<bvh>(objects); }, rays, reference);
+			measure("set", [&] { return make_shared<quadric_set>(quadrics); }, rays, reference);
+		}
+	}
+
+	/* Plain sphere tracing against over-relaxed steps on each kind of distance field, with camera rays at the shape */
+	void compare_marching()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		std::pair<const char*, shared_ptr<sdf_node>> shapes[] = {
+			{ "menger sponge", make_shared<sdf_menger>(point3(0, 0, 0), 1, 4) },
+			{ "blended box and torus", make_shared<sdf_blend>(make_shared<sdf_box>(point3(0, 0, 0), vec3(1, 0.5, 1), 0.15),
+				make_shared<sdf_torus>(point3(0, 0.6, 0), 0.8, 0.25), 0.4) },
+			{ "twisted box", make_shared<sdf_twist>(make_shared<sdf_box>(point3(0, 0, 0), vec3(0.5, 1.25, 0.5), 0.05), 1.2) },
+			{ "rippled sphere", make_shared<sdf_displace>(make_shared<sdf_sphere>(point3(0, 0, 0), 1), 0.04, 12) },
+		};
+		for (const auto& [name, shape] : shapes)
+		{
+			std::printf("%s, lipschitz bound %.2f\n", name, shape->lipschitz());
+			std::vector<ray> rays = camera_rays(point3(2.5, 1.5, 3.5), point3(0, 0, 0), ray_count / 4);
+			std::vector<double> reference;
+			// Both stop anywhere within their tolerance of the surface, so hits only agree that closely
+			measure("plain", [&] { return make_shared<distance_field>(shape, mat, 1.0); }, rays, reference, 1e-3);
+			measure("relaxed", [&] { return make_shared<distance_field>(shape, mat, 1.2); }, rays, reference, 1e-3);
+		}
+	}
+
+	/*
+	 * A block with growing numbers of spherical holes carved out, the holes joined by a chain
+	 * of unions that culls one child at a time and by a balanced tree that culls by halves
+	 */
+	void compare_csg()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		for (int n : { 64, 512, 4096 })
+		{
+			auto block = make_shared<convex_polyhedron>();
+			for (int axis = 0; axis < 3; axis++)
+			{
+				vec3 normal(0, 0, 0);
+				normal[axis] = 1;
+				block->add(point3(0, 0, 0) + 10 * normal, normal, mat);
+				block->add(point3(0, 0, 0) - 10 * normal, -normal, mat);
+			}
+			double radius = 8 / std::cbrt(double(n));
+			std::vector<shared_ptr<hittable>> holes;
+			for (int i = 0; i < n; i++)
+				holes.push_back(make_shared<sphere>(point3::random(-10, 10), radius, mat));
+
+			std::printf("block with %d holes\n", n);
+			std::vector<ray> rays = camera_rays(point3(30, 20, 25), point3(0, 0, 0), ray_count / 10);
+			std::vector<double> reference;
+			measure("chain", [&]
+			{
+				shared_ptr<hittable> chain = holes[0];
+				for (int i = 1; i < n; i++)
+					chain = make_shared<csg_union>(holes[i], chain);
+				return make_shared<csg_difference>(block, chain);
+			}, rays, reference);
+			measure("balanced", [&] { return make_shared<csg_difference>(block, csg_union::balanced(holes)); }, rays, reference);
+		}
+	}
+
+	/*
+	 * Boxes as six planes under a hittable_intersection, as one convex_polyhedron and as a slab
+	 * tested aabb_box, first axis-aligned, then turned, where the box is an aabb_box under an
+	 * instance. A lone box shows the cost of one primitive, a field of them the cost under a bvh.
+	 */
+	void compare_boxes()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		for (bool turned : { false, true })
+		{
+			for (int n : { 1, 20000 })
+			{
+				std::vector<shared_ptr<hittable>> planes, polyhedra, boxes;
+				double extent = n == 1 ? 0 : std::cbrt(double(n)) * 2;
+				for (int i = 0; i < n; i++)
+				{
+					point3 center = point3::random(-extent, extent);
+					vec3 half(random_double(0.3, 1), random_double(0.3, 1), random_double(0.3, 1));
+					affine rotation = turned ? affine::rotation(random_unit_vector(), random_double(0, 90)) : affine();
+					auto six = make_shared<hittable_intersection>();
+					auto solid = make_shared<convex_polyhedron>();
+					for (int axis = 0; axis < 3; axis++)
+					{
+						vec3 normal(0, 0, 0);
+						normal[axis] = 1;
+						normal = rotation.vector(normal);
+						for (double side : { 1.0, -1.0 })
+						{
+							six->add(make_shared<plane>(center + side * half[axis] * normal, side * normal, mat));
+							solid->add(center + side * half[axis] * normal, side * normal, mat);
+						}
+					}
+					planes.push_back(six);
+					polyhedra.push_back(solid);
+					if (turned)
+						boxes.push_back(make_shared<box>(center, half, rotation, mat));
+					else
+						boxes.push_back(make_shared<aabb_box>(center - half, center + half, mat));
+				}
+
+				std::printf("%s %s\n", n == 1 ? "one box" : "field of 20000 boxes", turned ? "turned" : "axis-aligned");
+				std::vector<ray> rays = n == 1 ? make_rays_towards(point3(0, 0, 0), 4) : make_rays(polyhedra);
+				std::vector<double> reference;
+				auto single = [&](const std::vector<shared_ptr<hittable>>& objects) -> shared_ptr<hittable>
+				{
+					if (n == 1)
+						return objects[0];
+					return make_shared<bvh>(objects);
+				};
+				measure("polyhedron", [&] { return single(polyhedra); }, rays, reference);
+				// Planes intersect in single precision, and are unbounded so only the lone box runs without a bvh test per ray
+				if (n == 1)
+					measure("six planes", [&] { return single(planes); }, rays, reference, 1e-4);
+				measure(turned ? "box" : "aabb_box", [&] { return single(boxes); }, rays, reference);
+			}
+		}
+	}
+
+	/*
+	 * A four million triangle bumpy sphere traced in memory, then paged in from a chunked file under
+	 * shrinking memory budgets. Each budget is traced by threads that wait for missing chunks and
+	 * again by threads that defer rays to a later round, as the camera does with samples.
+	 */
+	void compare_streaming()
+	{
+		shared_ptr<mesh_buffers> buffers = bumpy_sphere_buffers(1415);
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+
+		std::vector<ray> preview = scanline_rays(point3(1.6, 0.9, 1.2), point3(0, 0, 0), 640, 360);
+		std::vector<double> reference, distances;
+		auto start = std::chrono::steady_clock::now();
+		triangle_mesh in_memory(buffers, mat);
+		double build_seconds = seconds_since(start);
+		double trace_seconds = trace(in_memory, preview, reference);
+		size_t total_bytes = in_memory.memory_bytes();
+		std::printf("bumpy sphere, %zu triangles, %.0f MB in memory, 640x360 preview in scanline order\n",
+			in_memory.triangle_count(), total_bytes / 1e6);
+		std::printf("  in memory  build %8.2f ms, preview %8.2f ms\n", build_seconds * 1e3, trace_seconds * 1e3);
+
+		const std::string filename = "bench_stream.chunks";
+		start = std::chrono::steady_clock::now();
+		if (!chunked_mesh_file::write(filename, *buffers))
+			return;
+		std::printf("  wrote %s in %.2f s\n", filename.c_str(), seconds_since(start));
+
+		for (double fraction : { 2.0, 0.1, 0.06 })
+		{
+			size_t budget = size_t(fraction * total_bytes);
+			for (bool defer : { false, true })
+			{
+				auto streamed = streamed_mesh::open(filename, mat, budget);
+				if (!streamed)
+					return;
+				ray_statistics totals;
+				double stall_seconds = 0;
+				double seconds = defer ? trace_deferring(*streamed, preview, distances, totals, stall_seconds)
+									   : trace_counting(*streamed, preview, distances, totals);
+				streamed_mesh::streaming_statistics stats = streamed->statistics();
+				if (!defer)
+					stall_seconds = stats.stall_seconds;
+
+				long mismatches = 0;
+				for (size_t i = 0; i < preview.size(); i++)
+					mismatches += distances[i] != reference[i];
+				std::printf("  budget %5.1f%% %-6s preview %8.2f ms, %6.2f%% chunk visits resident, %llu loads, %llu evictions, %ld mismatches\n"
+					"                         read %7.2f ms, build %7.2f ms, stalled %7.2f ms\n",
+					100 * fraction, defer ? "defer" : "wait", seconds * 1e3,
+					100.0 * (totals.chunk_visits - totals.chunk_misses) / std::max<uint64_t>(1, totals.chunk_visits),
+					(unsigned long long)stats.loads, (unsigned long long)stats.evictions, mismatches,
+					stats.read_seconds * 1e3, stats.build_seconds * 1e3, stall_seconds * 1e3);
+			}
+		}
+		std::filesystem::remove(filename);
+	}
+
+	/* Small spheres filling a slab, with large spheres sunk into it, each overlapping hundreds of them */
+	std::vector<shared_ptr<hittable>> boulder_field() const
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		std::vector<shared_ptr<hittable>> objects;
+		for (int i = 0; i < 40000; i++)
+			objects.push_back(make_shared<sphere>(point3(random_double(-40, 40), random_double(0, 6), random_double(-40, 40)), 0.15, mat));
+		for (int i = 0; i < 40; i++)
+			objects.push_back(make_shared<sphere>(point3(random_double(-40, 40), random_double(-6, 2), random_double(-40, 40)), 8, mat));
+		return objects;
+	}
+
+	/*
+	 * Startup of a scene of half a million spheres and a two million triangle mesh, built from code
+	 * with its acceleration structures as every launch does, against mapping a snapshot of it
+	 */
+	void compare_snapshot()
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::vector<shared_ptr<hittable>> objects;
+		shared_ptr<material> mats[3] = { make_shared<lambertian>(color(0.5, 0.5, 0.5)),
+			make_shared<metal>(color(0.7, 0.6, 0.5), 0.1), make_shared<dielectric>(1.5) };
+		for (int i = 0; i < 500000; i++)
+			objects.push_back(make_shared<sphere>(point3::random(-3, 3), 0.01, mats[i % 3]));
+		objects.push_back(make_shared<triangle_mesh>(bumpy_sphere_buffers(1001), mats[0]));
+		auto built = build_accelerator(objects);
+		double build_seconds = seconds_since(start);
+
+		std::vector<ray> preview = scanline_rays(point3(6, 3.5, 4.5), point3(0, 0, 0), 640, 360);
+		std::vector<double> reference, distances;
+		double built_trace = trace(*built, preview, reference);
+		std::printf("500000 spheres and a 2 million triangle mesh, 640x360 preview\n");
+		std::printf("  built from code  startup %9.2f ms, preview %8.2f ms\n", build_seconds * 1e3, built_trace * 1e3);
+
+		const std::string filename = "bench_scene.snapshot";
+		camera cam;
+		start = std::chrono::steady_clock::now();
+		if (!scene_snapshot::write(filename, objects, cam))
+			return;
+		double write_seconds = seconds_since(start);
+		objects.clear();
+		built.reset();
+
+		start = std::chrono::steady_clock::now();
+		auto snapshot = scene_snapshot::open(filename);
+		if (!snapshot)
+			return;
+		double open_seconds = seconds_since(start);
+		double snapshot_trace = trace(*snapshot, preview, distances);
+		long mismatches = 0;
+		for (size_t i = 0; i < preview.size(); i++)
+			mismatches += distances[i] != reference[i];
+		std::printf("  snapshot         startup %9.2f ms, preview %8.2f ms, %ld mismatches\n",
+			open_seconds * 1e3, snapshot_trace * 1e3, mismatches);
+		std::printf("  written in %.2f s, %.0f MB\n", write_seconds, snapshot->file_size() / 1e6);
+		snapshot.reset();
+		std::filesystem::remove(filename);
+	}
+
+	/*
+	 * Reading a scene file of 200000 spheres written out one per line with inline materials,
+	 * and the same spheres made by a loop, against building the scene in code
+	 */
+	void parse_scene()
+	{
+		std::string text = "material ground lambertian (0.5, 0.5, 0.5)\nsphere (0, -1000, 0) 1000 ground\n";
+		char line[160];
+		for (int i = 0; i < 200000; i++)
+		{
+			int shade = i % 50;
+			std::snprintf(line, sizeof(line), "sphere (%.6f, 0.2, %.6f) 0.2 lambertian (%.2f, 0.3, 0.7)\n",
+				random_double(-250, 250), random_double(-250, 250), shade / 50.0);
+			text += line;
+		}
+		const std::string loop = "material ground lambertian (0.5, 0.5, 0.5)\nsphere (0, -1000, 0) 1000 ground\n"
+			"for i in 0 .. 200000 {\n"
+			"\tsphere (random(-250, 250), 0.2, random(-250, 250)) 0.2 lambertian (floor(random(0, 50)) / 50, 0.3, 0.7)\n"
+			"}\n";
+
+		for (const auto& [label, source] : { std::pair<const char*, const std::string&>{ "one per line", text }, { "loop", loop } })
+		{
+			scene_description scene;
+			auto start = std::chrono::steady_clock::now();
+			if (!scene_file::parse(source, label, "", scene))
+				return;
+			double seconds = seconds_since(start);
+			start = std::chrono::steady_clock::now();
+			auto accelerator = build_accelerator(scene.objects);
+			double build_seconds = seconds_since(start);
+			std::printf("  %-14s %8.2f MB  parse %8.2f ms (%6.1f MB/s, %5.2f M objects/s), %zu materials, build %8.2f ms\n",
+				label, source.size() / 1e6, seconds * 1e3, source.size() / 1e6 / seconds, scene.objects.size() / 1e6 / seconds,
+				scene.material_count, build_seconds * 1e3);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<shared_ptr<hittable>> objects;
+		auto ground = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		objects.push_back(make_shared<sphere>(point3(0, -1000, 0), 1000, ground));
+		for (int i = 0; i < 200000; i++)
+		{
+			auto mat = make_shared<lambertian>(color(int(random_double(0, 50)) / 50.0, 0.3, 0.7));
+			objects.push_back(make_shared<sphere>(point3(random_double(-250, 250), 0.2, random_double(-250, 250)), 0.2, mat));
+		}
+		std::printf("  %-14s             made in  %8.2f ms\n", "in code", seconds_since(start) * 1e3);
+	}
+
+	/*
+	 * hit per ray against hit_stream on batches of rays: a small list of spheres, cones and a plane
+	 * run through their SIMD kernels, a bvh over a sphere and cone field on camera and random rays,
+	 * then renders of the field by recursive paths and by wavefront bounces
+	 */
+	void compare_batches()
+	{
+		shared_ptr<material> mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		shared_ptr<material> shiny = make_shared<metal>(color(0.7, 0.6, 0.5), 0.1);
+		hittable_list list;
+		list.add(make_shared<plane>(point3(0, -10, 0), vec3(0, 1, 0), mat));
+		for (int i = 0; i < 24; i++)
+			list.add(make_shared<sphere>(point3::random(-10, 10), random_double(0.5, 2), mat));
+		for (int i = 0; i < 8; i++)
+			list.add(make_shared<cone>(point3::random(-10, 10), random_unit_vector(), 25, 3, mat, i % 2 == 0));
+		std::printf("list of 24 spheres, 8 cones and a plane\n");
+		compare_stream("random rays", list, make_rays(list.objects));
+
+		std::vector<shared_ptr<hittable>> field = sphere_cone_field();
+		bvh tree(field);
+		std::printf("bvh over a field of 90000 spheres and cones on a plane\n");
+		compare_stream("camera rays", tree, scanline_rays(point3(13, 2, 3), point3(0, 0, 0), 1280, 720));
+		compare_stream("random rays", tree, make_rays(field));
+
+		render_field(tree, "recursive", false, false);
+		render_field(tree, "wavefront", true, false);
+	}
+
+	/*
+	 * Diffuse bounce rays off what a camera sees, traced in pixel order and sorted by direction octant
+	 * and origin Morton code with the sort timed in, then wavefront renders with and without sorting
+	 */
+	void compare_reordering()
+	{
+		bvh tree(sphere_cone_field());
+		std::vector<ray> bounces = diffuse_bounces(tree);
+		std::printf("%zu diffuse bounces off a field of 90000 spheres and cones\n", bounces.size());
+
+		std::vector<double> reference, distances;
+		ray_statistics totals;
+		double single = trace(tree, bounces, reference);
+		std::printf("  %-14s %6.2f Mrays/s\n", "per ray", bounces.size() / single * 1e-6);
+		double unsorted = trace_stream(tree, bounces, distances, 256, totals);
+		std::printf("  %-14s %6.2f Mrays/s, %5.1f%% of rays in packets, %5.2f rays per node test\n", "streams",
+			bounces.size() / unsorted * 1e-6, 100.0 * totals.packet_rays / bounces.size(),
+			totals.packet_steps ? double(totals.packet_lanes) / totals.packet_steps : 0.0);
+
+		auto start = std::chrono::steady_clock::now();
+		ray_order sorter;
+		std::vector<uint32_t> order;
+		sorter.sort(bounces, order);
+		std::vector<ray> sorted(bounces.size());
+		for (size_t i = 0; i < order.size(); i++)
+			sorted[i] = bounces[order[i]];
+		double sort_seconds = seconds_since(start);
+		totals = ray_statistics();
+		double sorted_seconds = sort_seconds + trace_stream(tree, sorted, distances, 256, totals);
+		long mismatches = 0;
+		for (size_t i = 0; i < order.size(); i++)
+			mismatches += distances[i] != reference[order[i]];
+		std::printf("  %-14s %6.2f Mrays/s, %5.1f%% of rays in packets, %5.2f rays per node test, sort %.1f ms, %ld mismatches\n",
+			"sorted streams", bounces.size() / sorted_seconds * 1e-6, 100.0 * totals.packet_rays / bounces.size(),
+			totals.packet_steps ? double(totals.packet_lanes) / totals.packet_steps : 0.0, sort_seconds * 1e3, mismatches);
+
+		render_field(tree, "recursive", false, false);
+		render_field(tree, "wavefront", true, false);
+		render_field(tree, "sorted", true, true);
+		std::filesystem::remove("bench_batch.png");
+	}
+	/*
+	 * Streams of rays no packet can take, traced one ray after another and interleaved a few at a
+	 * time, through a sphere and cone field whose BVH and objects outgrow the L2 cache and one that
+	 * also outgrows the L3 cache. Then wavefront renders of the first, with and without interleaving.
+	 */
+	void compare_interleaving()
+	{
+		for (int side : { 300, 1400 })
+		{
+			std::vector<shared_ptr<hittable>> field = sphere_cone_field(side);
+			bvh tree(field);
+			std::printf("field of %d spheres and cones, %.0f MB of BVH nodes\n", side * side,
+				tree.hierarchy().view().node_count * sizeof(bvh_node) / 1e6);
+			for (const auto& [label, rays] : { std::pair{ "random rays", make_rays(field) }, std::pair{ "bounces", diffuse_bounces(tree) } })
+			{
+				std::vector<double> reference, distances;
+				ray_statistics totals;
+				double single = trace_stream(tree, rays, reference, 256, totals);
+				std::printf("  %-12s one at a time %6.2f Mrays/s", label, rays.size() / single * 1e-6);
+				for (int interleave : { 4, 8, 16 })
+				{
+					double seconds = trace_stream(tree, rays, distances, 256, totals, interleave);
+					long mismatches = 0;
+					for (size_t i = 0; i < rays.size(); i++)
+						mismatches += distances[i] != reference[i];
+					std::printf(", %2d in flight %6.2f (x%.2f)", interleave, rays.size() / seconds * 1e-6, single / seconds);
+					if (mismatches > 0)
+						std::printf(" %ld mismatches", mismatches);
+				}
+				std::printf("\n");
+			}
+		}
+
+		bvh tree(sphere_cone_field());
+		render_field(tree, "wavefront", true, false);
+		render_field(tree, "interleaved", true, false, 8);
+	}
+
+
+	/* Scenes at both ends of the grid's comfort zone */
+	void run_all()
+	{
+		auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+
+		for (int n : { 10000, 200000 })
+		{
+			std::vector<shared_ptr<hittable>> cloud;
+			double extent = std::cbrt(double(n)) * 1.5;
+			for (int i = 0; i < n; i++)
+				cloud.push_back(make_shared<sphere>(point3::random(-extent, extent), 0.3, mat));
+			run("uniform cloud " + std::to_string(n), cloud);
+		}
+
+		std::vector<shared_ptr<hittable>> layer;
+		for (int a = -150; a < 150; a++)
+			for (int b = -150; b < 150; b++)
+				layer.push_back(make_shared<sphere>(point3(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double()), 0.2, mat));
+		run("ground layer 90000", layer);
+
+		std::vector<shared_ptr<hittable>> mixed = layer;
+		mixed.push_back(make_shared<sphere>(point3(0, -1000, 0), 1000, mat));
+		for (int i = 0; i < 200; i++)
+			mixed.push_back(make_shared<sphere>(point3(random_double(-150, 150), 5, random_double(-150, 150)), 5, mat));
+		run("ground layer with large spheres", mixed);
+
+		std::vector<shared_ptr<hittable>> clusters;
+		for (int c = 0; c < 8; c++)
+		{
+			point3 center = point3::random(-500, 500);
+			for (int i = 0; i < 25000; i++)
+				clusters.push_back(make_shared<sphere>(center + 5 * random_in_unit_sphere(), 0.1, mat));
+		}
+		run("8 tight clusters 200000", clusters);
+	}
+
+  private:
+	// Random rays through the scene bounds, starting inside and around them like a mix of camera and bounce rays
+	std::vector<ray> make_rays(const std::vector<shared_ptr<hittable>>& objects) const
+	{
+		aabb bounds;
+		for (const auto& object : objects)
+		{
+			aabb box = object->bounding_box();
+			if (box.is_bounded())
+				bounds = aabb(bounds, box);
+		}
+		bounds = aabb::intersect(bounds, aabb(point3(-200, -50, -200), point3(200, 50, 200)));
+		point3 lo(bounds.x.min, bounds.y.min, bounds.z.min), hi(bounds.x.max, bounds.y.max, bounds.z.max);
+
+		std::vector<ray> rays;
+		rays.reserve(ray_count);
+		for (int i = 0; i < ray_count; i++)
+		{
+			point3 origin(random_double(lo.x(), hi.x()), random_double(lo.y(), hi.y()), random_double(lo.z(), hi.z()));
+			rays.push_back(ray(origin, random_unit_vector()));
+		}
+		return rays;
+	}
+
+	// Vertex i, j of a unit sphere with a rippled radius, resolution by resolution vertices, with its unrippled normal
+	static point3 bumpy_sphere_vertex(int i, int j, int resolution, vec3& normal)
+	{
+		double theta = pi * (i + 0.5) / resolution, phi = 2 * pi * j / (resolution - 1);
+		normal = vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+		return (1 + 0.02 * std::sin(40 * theta) * std::sin(40 * phi)) * normal;
+	}
+
+	// The bumpy sphere as an indexed triangle mesh in memory
+	static shared_ptr<mesh_buffers> bumpy_sphere_buffers(int resolution)
+	{
+		auto buffers = make_shared<mesh_buffers>();
+		for (int i = 0; i < resolution; i++)
+		{
+			for (int j = 0; j < resolution; j++)
+			{
+				vec3 n;
+				point3 p = bumpy_sphere_vertex(i, j, resolution, n);
+				buffers->position_storage.insert(buffers->position_storage.end(), { float(p.x()), float(p.y()), float(p.z()) });
+			}
+		}
+		for (uint32_t i = 0; i + 1 < uint32_t(resolution); i++)
+		{
+			for (uint32_t j = 0; j + 1 < uint32_t(resolution); j++)
+			{
+				uint32_t a = i * resolution + j, b = a + 1, c = a + resolution + 1, d = a + resolution;
+				buffers->index_storage.insert(buffers->index_storage.end(), { a, b, c, a, c, d });
+			}
+		}
+		buffers->use_storage();
+		return buffers;
+	}
+
+	// The bumpy sphere as OBJ quads with texture coordinates and normals
+	static void write_bumpy_sphere(const std::string& filename, int resolution)
+	{
+		std::FILE* out = std::fopen(filename.c_str(), "w");
+		if (!out)
+			return;
+		for (int i = 0; i < resolution; i++)
+		{
+			for (int j = 0; j < resolution; j++)
+			{
+				vec3 n;
+				point3 p = bumpy_sphere_vertex(i, j, resolution, n);
+				std::fprintf(out, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.5f %.5f %.5f\n",
+					p.x(), p.y(), p.z(), double(j) / (resolution - 1), double(i) / (resolution - 1), n.x(), n.y(), n.z());
+			}
+		}
+		for (int i = 0; i + 1 < resolution; i++)
+		{
+			for (int j = 0; j + 1 < resolution; j++)
+			{
+				int a = i * resolution + j + 1, b = a + 1, c = a + resolution + 1, d = a + resolution;
+				std::fprintf(out, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			}
+		}
+		std::fclose(out);
+	}
+
+	/*
+	 * The bumpy sphere as binary PLY. Packed files hold float positions and normals with triangles
+	 * of 32-bit indices, the layout meshes use in place. Otherwise positions are doubles and faces quads.
+	 */
+	static void write_bumpy_sphere_ply(const std::string& filename, int resolution, bool packed)
+	{
+		std::FILE* out = std::fopen(filename.c_str(), "wb");
+		if (!out)
+			return;
+		size_t vertices = size_t(resolution) * resolution, quads = size_t(resolution - 1) * (resolution - 1);
+		std::fprintf(out, "ply\nformat binary_little_endian 1.0\nelement vertex %zu\n", vertices);
+		if (packed)
+			std::fprintf(out, "property float x\nproperty float y\nproperty float z\n"
+				"property float nx\nproperty float ny\nproperty float nz\n"
+				"element face %zu\nproperty list uchar int vertex_indices\nend_header\n", 2 * quads);
+		else
+			std::fprintf(out, "property double x\nproperty double y\nproperty double z\n"
+				"element face %zu\nproperty list uchar uint vertex_indices\nend_header\n", quads);
+
+		std::vector<unsigned char> row;
+		for (int i = 0; i < resolution; i++)
+		{
+			row.clear();
+			for (int j = 0; j < resolution; j++)
+			{
+				vec3 n;
+				point3 p = bumpy_sphere_vertex(i, j, resolution, n);
+				if (packed)
+				{
+					float values[6] = { float(p.x()), float(p.y()), float(p.z()), float(n.x()), float(n.y()), float(n.z()) };
+					row.insert(row.end(), reinterpret_cast<unsigned char*>(values), reinterpret_cast<unsigned char*>(values + 6));
+				}
+				else
+				{
+					double values[3] = { p.x(), p.y(), p.z() };
+					row.insert(row.end(), reinterpret_cast<unsigned char*>(values), reinterpret_cast<unsigned char*>(values + 3));
+				}
+			}
+			std::fwrite(row.data(), 1, row.size(), out);
+		}
+		for (int i = 0; i + 1 < resolution; i++)
+		{
+			row.clear();
+			for (int j = 0; j + 1 < resolution; j++)
+			{
+				uint32_t a = uint32_t(i * resolution + j), b = a + 1, c = a + resolution + 1, d = a + resolution;
+				uint32_t faces[2][3] = { { a, b, c }, { a, c, d } }, quad[4] = { a, b, c, d };
+				for (int f = 0; f < (packed ? 2 : 1); f++)
+				{
+					unsigned char corners = packed ? 3 : 4;
+					const uint32_t* indices = packed ? faces[f] : quad;
+					row.push_back(corners);
+					row.insert(row.end(), reinterpret_cast<const unsigned char*>(indices),
+						reinterpret_cast<const unsigned char*>(indices + corners));
+				}
+			}
+			std::fwrite(row.data(), 1, row.size(), out);
+		}
+		std::fclose(out);
+	}
+
+	// Rays from random points within reach of target, aimed at random points near it
+	std::vector<ray> make_rays_towards(const point3& target, double reach) const
+	{
+		std::vector<ray> rays;
+		rays.reserve(ray_count);
+		for (int i = 0; i < ray_count; i++)
+		{
+			point3 origin = target + reach * vec3::random(-1, 1);
+			rays.push_back(ray(origin, unit_vector(target + vec3::random(-1, 1) - origin)));
+		}
+		return rays;
+	}
+
+	// Rays from viewpoint through a 0.4 by 0.24 window one unit towards target
+	static std::vector<ray> camera_rays(const point3& viewpoint, const point3& target, int count)
+	{
+		vec3 forward = unit_vector(target - viewpoint);
+		vec3 side = unit_vector(cross(forward, vec3(0, 1, 0)));
+		vec3 up = cross(side, forward);
+		std::vector<ray> rays;
+		rays.reserve(count);
+		for (int i = 0; i < count; i++)
+		{
+			double u = random_double(-0.2, 0.2), v = random_double(-0.12, 0.12);
+			rays.push_back(ray(viewpoint, unit_vector(forward + u * side + v * up)));
+		}
+		return rays;
+	}
+
+	// Rays through a width by height grid of pixel centers, row by row as a camera traces them
+	static std::vector<ray> scanline_rays(const point3& viewpoint, const point3& target, int width, int height)
+	{
+		vec3 forward = unit_vector(target - viewpoint);
+		vec3 side = unit_vector(cross(forward, vec3(0, 1, 0)));
+		vec3 up = cross(side, forward);
+		std::vector<ray> rays;
+		rays.reserve(size_t(width) * height);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				double u = 0.8 * ((x + 0.5) / width - 0.5), v = 0.45 * (0.5 - (y + 0.5) / height);
+				rays.push_back(ray(viewpoint, unit_vector(forward + u * side + v * up)));
+			}
+		}
+		return rays;
+	}
+
+	// trace, also summing the threads' ray statistics
+	static double trace_counting(const hittable& scene, const std::vector<ray>& rays, std::vector<double>& distances,
+								 ray_statistics& totals)
+	{
+		distances.resize(rays.size());
+		auto start = std::chrono::steady_clock::now();
+		#pragma omp parallel
+		{
+			ray_stats = ray_statistics();
+			#pragma omp for schedule(dynamic, 256)
+			for (long i = 0; i < long(rays.size()); i++)
+			{
+				hit_record rec;
+				distances[i] = scene.hit(rays[i], interval(0.001, infinity), rec) ? rec.t : infinity;
+			}
+			#pragma omp critical
+			totals += ray_stats;
+			interleaving.rays = 0;
+		}
+		return seconds_since(start);
+	}
+
+	/*
+	 * trace_counting with deferral allowed, tracing deferred rays again in rounds until all finish.
+	 * Rounds that finish nothing sleep a millisecond, counted as stall time.
+	 */
+	static double trace_deferring(const hittable& scene, const std::vector<ray>& rays, std::vector<double>& distances,
+								  ray_statistics& totals, double& stall_seconds)
+	{
+		distances.resize(rays.size());
+		std::vector<uint32_t> pending(rays.size());
+		for (uint32_t i = 0; i < pending.size(); i++)
+			pending[i] = i;
+		auto start = std::chrono::steady_clock::now();
+		while (!pending.empty())
+		{
+			std::vector<uint32_t> remaining;
+			#pragma omp parallel
+			{
+				ray_stats = ray_statistics();
+				std::vector<uint32_t> own_remaining;
+				#pragma omp for schedule(dynamic, 256)
+				for (long k = 0; k < long(pending.size()); k++)
+				{
+					uint32_t i = pending[k];
+					hit_record rec;
+					deferral.allowed = true;
+					deferral.deferred = false;
+					bool hit = scene.hit(rays[i], interval(0.001, infinity), rec);
+					deferral.allowed = false;
+					if (deferral.deferred)
+						own_remaining.push_back(i);
+					else
+						distances[i] = hit ? rec.t : infinity;
+				}
+				#pragma omp critical
+				{
+					totals += ray_stats;
+					remaining.insert(remaining.end(), own_remaining.begin(), own_remaining.end());
+				}
+			}
+			if (remaining.size() == pending.size())
+			{
+				auto wait_start = std::chrono::steady_clock::now();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				stall_seconds += seconds_since(wait_start);
+			}
+			std::sort(remaining.begin(), remaining.end());
+			pending.swap(remaining);
+		}
+		return seconds_since(start);
+	}
+
+	// Diffuse bounces off what a 1280x720 camera sees of the sphere and cone field, in pixel order
+	static std::vector<ray> diffuse_bounces(const hittable& field)
+	{
+		std::vector<ray> bounces;
+		for (const ray& r : scanline_rays(point3(13, 2, 3), point3(0, 0, 0), 1280, 720))
+		{
+			hit_record rec;
+			if (field.hit(r, interval(0.001, infinity), rec))
+				bounces.push_back(ray(rec.p, rec.normal + random_unit_vector()));
+		}
+		return bounces;
+	}
+
+	// Small spheres and cones on a side by side grid with a ground plane, matte and metal
+	static std::vector<shared_ptr<hittable>> sphere_cone_field(int side = 300)
+	{
+		shared_ptr<material> mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+		shared_ptr<material> shiny = make_shared<metal>(color(0.7, 0.6, 0.5), 0.1);
+		std::vector<shared_ptr<hittable>> field = { make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), mat) };
+		for (int a = -side / 2; a < side / 2; a++)
+		{
+			for (int b = -side / 2; b < side / 2; b++)
+			{
+				point3 base(a + 0.9 * random_double(), 0, b + 0.9 * random_double());
+				if ((a + b) % 16 == 0)
+					field.push_back(make_shared<cone>(base + vec3(0, 0.5, 0), base, 0.2, shiny));
+				else
+					field.push_back(make_shared<sphere>(base + vec3(0, 0.2, 0), 0.2, (a ^ b) & 1 ? mat : shiny));
+			}
+		}
+		return field;
+	}
+
+	// A 480x270 render of the field at 16 samples, printing its time and ray statistics
+	static void render_field(const hittable& scene, const char* label, bool wavefront, bool reorder, int interleave = 0)
+	{
+		camera cam;
+		cam.image_width = 480;
+		cam.image_height = 270;
+		cam.samples_per_pixel = 16;
+		cam.max_depth = 10;
+		cam.vfov = 20;
+		cam.lookfrom = point3(13, 2, 3);
+		cam.lookat = point3(0, 0, 0);
+		cam.wavefront = wavefront;
+		cam.reorder_rays = reorder;
+		cam.interleaved_rays = interleave;
+		cam.output_file = "bench_batch.png";
+		cam.render(scene);
+		const ray_statistics& stats = cam.statistics;
+		std::printf("  %-14s render %6.2f s, %5.2f Mrays/s, %llu rays", label, cam.timings.trace,
+			stats.rays / cam.timings.trace * 1e-6, (unsigned long long) stats.rays);
+		if (stats.packet_steps > 0)
+			std::printf(", %4.1f%% in packets, %5.2f rays per node test", 100.0 * stats.packet_rays / stats.rays,
+				double(stats.packet_lanes) / stats.packet_steps);
+		if (reorder)
+			std::printf(", sort %.2f s", cam.timings.reorder);
+		std::printf("\n");
+		std::filesystem::remove("bench_batch.png");
+	}
+
+	// One row of compare_batches: the rays traced one by one, then in streams of batch rays
+	static void compare_stream(const char* label, const hittable& scene, const std::vector<ray>& rays, size_t batch = 256)
+	{
+		std::vector<double> reference, distances;
+		double single = trace(scene, rays, reference);
+		ray_statistics totals;
+		double streamed = trace_stream(scene, rays, distances, batch, totals);
+		long mismatches = 0;
+		for (size_t i = 0; i < rays.size(); i++)
+			mismatches += distances[i] != reference[i];
+		std::printf("  %-14s per ray %6.2f Mrays/s, streams of %zu %6.2f Mrays/s, x%.2f, %ld mismatches\n", label,
+			rays.size() / single * 1e-6, batch, rays.size() / streamed * 1e-6, single / streamed, mismatches);
+	}
+
+	// trace_counting through hit_stream, a batch of consecutive rays per call
+	static double trace_stream(const hittable& scene, const std::vector<ray>& rays, std::vector<double>& distances, size_t batch,
+							   ray_statistics& totals, int interleave = 0)
+	{
+		distances.resize(rays.size());
+		auto start = std::chrono::steady_clock::now();
+		#pragma omp parallel
+		{
+			ray_stats = ray_statistics();
+			interleaving.rays = interleave;
+			std::vector<interval> ray_t(batch);
+			std::vector<hit_record> recs(batch);
+			std::vector<uint8_t> active(batch, 1), hits(batch);
+			#pragma omp for schedule(dynamic)
+			for (long first = 0; first < long(rays.size()); first += long(batch))
+			{
+				size_t n = std::min(batch, rays.size() - first);
+				std::fill(ray_t.begin(), ray_t.end(), interval(0.001, infinity));
+				std::fill(hits.begin(), hits.end(), 0);
+				scene.hit_stream(std::span<const ray>(rays.data() + first, n), std::span<interval>(ray_t.data(), n),
+					std::span<hit_record>(recs.data(), n), std::span<const uint8_t>(active.data(), n), std::span<uint8_t>(hits.data(), n));
+				for (size_t i = 0; i < n; i++)
+					distances[first + i] = hits[i] ? recs[i].t : infinity;
+			}
+			#pragma omp critical
+			totals += ray_stats;
+		}
+		return seconds_since(start);
+	}
+
+	// Traces every ray in parallel, storing hit distances, and returns the seconds taken
+	static double trace(const hittable& accelerator, const std::vector<ray>& rays, std::vector<double>& distances)
+	{
+		distances.resize(rays.size());
+		auto start = std::chrono::steady_clock::now();
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (long i = 0; i < long(rays.size()); i++)
+		{
+			hit_record rec;
+			distances[i] = accelerator.hit(rays[i], interval(0.001, infinity), rec) ? rec.t : infinity;
+		}
+		return seconds_since(start);
+	}
+
+	void measure(const std::string& label, const std::function<shared_ptr<hittable>()>& build,
+				 const std::vector<ray>& rays, std::vector<double>& reference, double tolerance = 1e-9) const
+	{
+		auto build_start = std::chrono::steady_clock::now();
+		shared_ptr<hittable> accelerator = build();
+		double build_seconds = seconds_since(build_start);
+
+		std::vector<double> distances(rays.size());
+		ray_statistics totals;
+		auto trace_start = std::chrono::steady_clock::now();
+		#pragma omp parallel
+		{
+			ray_stats = ray_statistics();
+			#pragma omp for schedule(dynamic, 1024)
+			for (long i = 0; i < long(rays.size()); i++)
+			{
+				hit_record rec;
+				distances[i] = accelerator->hit(rays[i], interval(0.001, infinity), rec) ? rec.t : infinity;
+			}
+			#pragma omp critical
+			totals += ray_stats;
+		}
+		double trace_seconds = seconds_since(trace_start);
+
+		// The first structure is the reference, the others must find the same hits
+		long mismatches = 0;
+		if (reference.empty())
+			reference = distances;
+		else
+			for (size_t i = 0; i < rays.size(); i++)
+				mismatches += std::fabs(distances[i] - reference[i]) > tolerance && distances[i] != reference[i];
+
+		std::printf("  %-10s build %8.2f ms, trace %6.2f Mrays/s, %6.2f nodes and %6.2f tests per ray, %ld mismatches\n",
+			label.c_str(), build_seconds * 1e3, rays.size() / trace_seconds * 1e-6,
+			double(totals.node_visits) / rays.size(), double(totals.primitive_tests) / rays.size(), mismatches);
+		if (totals.marched_rays > 0)
+			std::printf("             %.2f steps per march, %.0f%% of rays marched\n",
+				double(totals.march_steps) / totals.marched_rays, 100.0 * totals.marched_rays / rays.size());
+	}
+
+	static double seconds_since(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+#endif
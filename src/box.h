@@ -0,0 +1,93 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef BOX_H
+#define BOX_H
+
+#include "hittable.h"
+#include "instance.h"
+
+/*
+ * Solid axis-aligned box. One slab test against the ray's cached inverse direction finds both
+ * crossings, and the slab that set the crossing names the face, so the normal is exact rather
+ * than picked by comparing hit points against the sides.
+ */
+class aabb_box : public hittable
+{
+  public:
+	/* Box spanning two opposite corners in any order */
+	aabb_box(const point3& a, const point3& b, shared_ptr<material> mat) : bbox(a, b), mat(mat) {}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		const point3& o = r.origin();
+		const vec3& inv_dir = r.inverse_direction();
+
+		// Latest slab entry and earliest slab exit, with the axis each came from
+		double enter = -infinity, exit = infinity;
+		int enter_axis = 0, exit_axis = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const interval& ax = bbox.axis_interval(axis);
+			double t0 = (ax.min - o[axis]) * inv_dir[axis];
+			double t1 = (ax.max - o[axis]) * inv_dir[axis];
+			bool flip = inv_dir[axis] < 0;
+			double t_near = flip ? t1 : t0;
+			double t_far = flip ? t0 : t1;
+
+			// A NaN from a ray lying in a face plane loses every comparison and leaves the crossings alone
+			enter_axis = t_near > enter ? axis : enter_axis;
+			enter = t_near > enter ? t_near : enter;
+			exit_axis = t_far < exit ? axis : exit_axis;
+			exit = t_far < exit ? t_far : exit;
+		}
+		if (enter > exit)
+			return false;
+
+		// The first boundary crossing inside the ray's bounds, the exit when the ray starts inside
+		bool entering = ray_t.surrounds(enter);
+		double t = entering ? enter : exit;
+		if (!ray_t.surrounds(t))
+			return false;
+
+		int axis = entering ? enter_axis : exit_axis;
+		vec3 outward(0, 0, 0);
+		outward[axis] = ((inv_dir[axis] < 0) == entering) ? 1 : -1;
+
+		rec.t = t;
+		rec.p = r.at(t);
+		rec.p[axis] = outward[axis] > 0 ? bbox.axis_interval(axis).max : bbox.axis_interval(axis).min;
+		rec.set_face_normal(r, outward);
+		rec.mat = mat;
+		return true;
+	}
+
+	virtual bool volume_contains(const point3 p) const override
+	{
+		return bbox.contains(p);
+	}
+
+	aabb bounding_box() const override
+	{
+		return bbox;
+	}
+
+  private:
+	aabb bbox;
+	shared_ptr<material> mat;
+};
+
+/*
+ * Box turned to any orientation, an aabb_box around the origin placed by a rotation and a
+ * translation. Rays move into the box's frame, so it keeps the slab test and exact normals.
+ */
+class box : public instance
+{
+  public:
+	/* Box with the given center and half sizes along its own axes, turned by rotation about its center */
+	box(const point3& center, const vec3& half_extents, const affine& rotation, shared_ptr<material> mat)
+		: instance(make_shared<aabb_box>(-half_extents, half_extents, mat), affine::translation(center) * rotation) {}
+};
+
+#endif
@@ -0,0 +1,1336 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <omp.h>
+#include <vector>
+
+/* Flattened BVH node, stored depth first so the left child always follows its parent */
+struct bvh_node
+{
+	aabb bbox;
+	uint32_t first; // First entry in the leaf's index range, or the right child of an interior node
+	uint32_t count; // Primitives in the leaf, 0 for interior nodes
+
+	bool is_leaf() const { return count > 0; }
+};
+
+/*
+ * Built tree read in place, from a bvh_tree's vectors or from a file mapped into memory. Nodes
+ * and indices are plain data with no pointers, so a tree written out byte for byte traverses the
+ * same wherever it is loaded.
+ */
+struct bvh_view
+{
+	const bvh_node* nodes = nullptr;
+	const uint32_t* indices = nullptr; // Primitive indices in leaf order
+	size_t node_count = 0;
+
+	// Deep enough for any tree bvh_tree builds, which halves ranges past a fixed depth
+	static const int stack_size = 128;
+
+	aabb bounds() const
+	{
+		return node_count == 0 ? aabb::empty : nodes[0].bbox;
+	}
+
+	/*
+	 * Visits leaves roughly front to back. test(primitive, ray_t) intersects one primitive
+	 * and returns true on a hit, after narrowing ray_t.max to the hit distance.
+	 */
+	template <typename primitive_test>
+	bool traverse(const ray& r, interval& ray_t, primitive_test&& test) const
+	{
+		return traverse_leaves(r, ray_t, [&](uint32_t first, uint32_t count, interval& t)
+		{
+			bool hit_anything = false;
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				if (test(indices[i], t))
+					hit_anything = true;
+			}
+			return hit_anything;
+		});
+	}
+
+	/* The same, handing test(first, count, ray_t) a leaf's whole range of entries in indices at once */
+	template <typename leaf_test>
+	bool traverse_leaves(const ray& r, interval& ray_t, leaf_test&& test) const
+	{
+		if (node_count == 0)
+			return false;
+
+		const point3& origin = r.origin();
+		const vec3& inv_dir = r.inverse_direction();
+
+		interval root_t = ray_t;
+		if (!nodes[0].bbox.hit(origin, inv_dir, root_t))
+			return false;
+
+		struct entry { uint32_t node; double t; };
+		entry stack[stack_size];
+		int size = 0;
+		uint32_t node = 0;
+		bool hit_anything = false;
+		uint64_t visits = 0, tests = 0;
+
+		while (true)
+		{
+			const bvh_node& current = nodes[node];
+			visits++;
+			if (current.is_leaf())
+			{
+				tests += current.count;
+				if (test(current.first, current.count, ray_t))
+					hit_anything = true;
+			}
+			else
+			{
+				uint32_t left = node + 1, right = current.first;
+				interval left_t = ray_t, right_t = ray_t;
+				bool hit_left = nodes[left].bbox.hit(origin, inv_dir, left_t);
+				bool hit_right = nodes[right].bbox.hit(origin, inv_dir, right_t);
+
+				if (hit_left && hit_right)
+				{
+					// Descend into the nearer child first, the farther one may be culled by then
+					if (right_t.min < left_t.min)
+					{
+						stack[size++] = { left, left_t.min };
+						node = right;
+					}
+					else
+					{
+						stack[size++] = { right, right_t.min };
+						node = left;
+					}
+					continue;
+				}
+				if (hit_left || hit_right)
+				{
+					node = hit_left ? left : right;
+					continue;
+				}
+			}
+
+			// Pop the next subtree that can still hold a closer hit
+			while (size > 0 && stack[size - 1].t > ray_t.max)
+				size--;
+			if (size == 0)
+				break;
+			node = stack[--size].node;
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+		return hit_anything;
+	}
+
+	// Most rays traverse_interleaved keeps in flight
+	static const int max_interleaved = 16;
+
+	/*
+	 * Traverses each active ray like traverse_leaves, with up to lanes of them in flight. A step
+	 * takes one ray one node further and prefetches what its next step reads, then the next ray
+	 * takes its step, so the cache misses of different rays overlap instead of each stalling the
+	 * thread in turn. Descending to a left child, which follows its parent in memory, takes no turn.
+	 * A ray gets a slot from 0 to lanes - 1 for its whole traversal. Reaching a leaf, fetch(first,
+	 * count) prefetches its primitives a turn before test(slot, ray, first, count, ray_t), the leaf
+	 * test of traverse_leaves. done(slot, ray, hit) is called as each ray that reached the root finishes.
+	 */
+	template <typename leaf_test, typename leaf_fetch, typename finish>
+	void traverse_interleaved(const ray* rays, interval* ray_t, const uint8_t* active, size_t count, int lanes,
+							  leaf_test&& test, leaf_fetch&& fetch, finish&& done) const
+	{
+		if (node_count == 0)
+			return;
+
+		struct entry { uint32_t node; double t; };
+		struct state
+		{
+			size_t ray;
+			uint32_t node;
+			int size;
+			bool hit;
+			bool fetched; // Whether the objects of the leaf at node have been prefetched
+			entry stack[stack_size];
+		};
+		lanes = std::clamp(lanes, 1, max_interleaved);
+		state states[max_interleaved];
+		int live[max_interleaved]; // Slots of the rays in flight
+		int live_count = 0;
+		size_t next = 0;
+		uint64_t visits = 0, tests = 0;
+
+		// Moves on to node in s, prefetching the nodes or indices its step will read
+		auto enter = [this](state& s, uint32_t node)
+		{
+			s.node = node;
+			s.fetched = false;
+			const bvh_node& target = nodes[node];
+			if (target.is_leaf())
+				prefetch(&indices[target.first]);
+			else
+			{
+				prefetch(&nodes[node + 1]);
+				prefetch(&nodes[target.first]);
+			}
+		};
+
+		// Starts the next active ray that reaches the root in s, false once there are none left
+		auto start = [&](state& s)
+		{
+			for (; next < count; next++)
+			{
+				interval root_t = ray_t[next];
+				if (!active[next] || !nodes[0].bbox.hit(rays[next].origin(), rays[next].inverse_direction(), root_t))
+					continue;
+				s.ray = next++;
+				s.size = 0;
+				s.hit = false;
+				enter(s, 0);
+				return true;
+			}
+			return false;
+		};
+
+		for (int slot = 0; slot < lanes && start(states[slot]); slot++)
+			live[live_count++] = slot;
+
+		int k = 0;
+		while (live_count > 0)
+		{
+			int slot = live[k];
+			state& s = states[slot];
+			const point3& origin = rays[s.ray].origin();
+			const vec3& inv_dir = rays[s.ray].inverse_direction();
+			interval& t = ray_t[s.ray];
+			const bvh_node& current = nodes[s.node];
+			uint32_t from = s.node;
+			bool moved = false;
+
+			// A leaf takes two turns, the visit is counted on the second as traverse counts it once
+			if (current.is_leaf() && !s.fetched)
+			{
+				fetch(current.first, current.count);
+				s.fetched = true;
+				k = k + 1 < live_count ? k + 1 : 0;
+				continue;
+			}
+			visits++;
+			if (current.is_leaf())
+			{
+				tests += current.count;
+				if (test(slot, s.ray, current.first, current.count, t))
+					s.hit = true;
+			}
+			else
+			{
+				uint32_t left = s.node + 1, right = current.first;
+				interval left_t = t, right_t = t;
+				bool hit_left = nodes[left].bbox.hit(origin, inv_dir, left_t);
+				bool hit_right = nodes[right].bbox.hit(origin, inv_dir, right_t);
+
+				if (hit_left && hit_right)
+				{
+					bool right_first = right_t.min < left_t.min;
+					s.stack[s.size++] = right_first ? entry{ left, left_t.min } : entry{ right, right_t.min };
+					enter(s, right_first ? right : left);
+					moved = true;
+				}
+				else if (hit_left || hit_right)
+				{
+					enter(s, hit_left ? left : right);
+					moved = true;
+				}
+			}
+
+			if (!moved)
+			{
+				while (s.size > 0 && s.stack[s.size - 1].t > t.max)
+					s.size--;
+				if (s.size > 0)
+				{
+					enter(s, s.stack[--s.size].node);
+					moved = true;
+				}
+			}
+
+			if (moved)
+			{
+				// A left child follows its parent in memory, only jumps elsewhere are worth switching rays for
+				if (s.node != from + 1)
+					k = k + 1 < live_count ? k + 1 : 0;
+				continue;
+			}
+
+			// This ray is done, its slot takes the next one or leaves the rotation
+			done(slot, s.ray, s.hit);
+			if (start(s))
+				k = k + 1 < live_count ? k + 1 : 0;
+			else
+			{
+				live[k] = live[--live_count];
+				if (k == live_count)
+					k = 0;
+			}
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+	}
+
+	// Rays in one traversal packet, one bit each in a mask
+	static const int packet_size = 64;
+
+	/*
+	 * Traverses up to packet_size rays together. Each node's box is tested against every ray of the
+	 * mask in SIMD lanes, within the rays' current bounds, and the node is entered by the rays that
+	 * reach it. test(first, count, mask) gets a leaf's range of entries and the rays reaching it, and
+	 * narrows their bounds to any hits. Children go nearest first along the first reaching ray.
+	 */
+	template <typename leaf_test>
+	void traverse_packet(const ray* rays, interval* ray_t, int count, uint64_t mask, leaf_test&& test) const
+	{
+		if (node_count == 0 || mask == 0)
+			return;
+
+		double ox[packet_size], oy[packet_size], oz[packet_size];
+		double ix[packet_size], iy[packet_size], iz[packet_size];
+		double t_min[packet_size], t_max[packet_size];
+		for (int i = 0; i < count; i++)
+		{
+			ox[i] = rays[i].origin().x(); oy[i] = rays[i].origin().y(); oz[i] = rays[i].origin().z();
+			ix[i] = rays[i].inverse_direction().x(); iy[i] = rays[i].inverse_direction().y(); iz[i] = rays[i].inverse_direction().z();
+		}
+
+		struct entry { uint32_t node; uint64_t mask; };
+		entry stack[stack_size];
+		int size = 0;
+		stack[size++] = { 0, mask };
+		uint64_t visits = 0, tests = 0, steps = 0, lanes = 0;
+
+		while (size > 0)
+		{
+			entry e = stack[--size];
+			const bvh_node& current = nodes[e.node];
+			steps++;
+			lanes += std::popcount(e.mask);
+
+			int lo = std::countr_zero(e.mask), hi = packet_size - std::countl_zero(e.mask);
+			for (int i = lo; i < hi; i++)
+			{
+				t_min[i] = ray_t[i].min;
+				t_max[i] = ray_t[i].max;
+			}
+			const aabb& box = current.bbox;
+			uint8_t reach[packet_size];
+			#pragma omp simd
+			for (int i = lo; i < hi; i++)
+			{
+				// The slab test of aabb::hit, lane by lane
+				double x0 = (box.x.min - ox[i]) * ix[i], x1 = (box.x.max - ox[i]) * ix[i];
+				double y0 = (box.y.min - oy[i]) * iy[i], y1 = (box.y.max - oy[i]) * iy[i];
+				double z0 = (box.z.min - oz[i]) * iz[i], z1 = (box.z.max - oz[i]) * iz[i];
+				double near_x = ix[i] < 0 ? x1 : x0, far_x = ix[i] < 0 ? x0 : x1;
+				double near_y = iy[i] < 0 ? y1 : y0, far_y = iy[i] < 0 ? y0 : y1;
+				double near_z = iz[i] < 0 ? z1 : z0, far_z = iz[i] < 0 ? z0 : z1;
+				double enter = t_min[i], exit = t_max[i];
+				enter = near_x > enter ? near_x : enter; exit = far_x < exit ? far_x : exit;
+				enter = near_y > enter ? near_y : enter; exit = far_y < exit ? far_y : exit;
+				enter = near_z > enter ? near_z : enter; exit = far_z < exit ? far_z : exit;
+				reach[i] = enter <= exit;
+			}
+			uint64_t reaching = 0;
+			for (int i = lo; i < hi; i++)
+				reaching |= uint64_t(reach[i]) << i;
+			reaching &= e.mask;
+			if (reaching == 0)
+				continue;
+
+			int entering = std::popcount(reaching);
+			visits += entering;
+			if (current.is_leaf())
+			{
+				tests += uint64_t(entering) * current.count;
+				test(current.first, current.count, reaching);
+				continue;
+			}
+
+			// Push the farther child first, comparing box centers along the first reaching ray
+			uint32_t left = e.node + 1, right = current.first;
+			const aabb& l = nodes[left].bbox;
+			const aabb& r = nodes[right].bbox;
+			const vec3& dir = rays[std::countr_zero(reaching)].direction();
+			double ahead = (r.x.min + r.x.max - l.x.min - l.x.max) * dir.x() + (r.y.min + r.y.max - l.y.min - l.y.max) * dir.y()
+				+ (r.z.min + r.z.max - l.z.min - l.z.max) * dir.z();
+			stack[size++] = { ahead < 0 ? left : right, reaching };
+			stack[size++] = { ahead < 0 ? right : left, reaching };
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+		ray_stats.packet_rays += std::popcount(mask);
+		ray_stats.packet_steps += steps;
+		ray_stats.packet_lanes += lanes;
+	}
+};
+
+/*
+ * Bounding volume hierarchy over primitive boxes, built with a binned surface area heuristic.
+ * It only knows primitives by index, so hittables and mesh triangles can share it. Large
+ * subtrees are built as parallel tasks, giving the same tree as a serial build.
+ *
+ * With a split budget the build also considers spatial splits, which cut through primitives and
+ * reference each clipped part from its own side. Large objects overlapping many small ones then sit
+ * in the leaves around where they actually are, instead of in one box every ray has to visit.
+ */
+class bvh_tree
+{
+  public:
+	std::vector<bvh_node> nodes;
+	std::vector<uint32_t> indices;             // Primitive indices in leaf order
+	std::vector<std::vector<uint32_t>> levels; // Node indices by depth, for bottom-up refits
+
+	int max_leaf_size = 4;
+
+	// Extra references spatial splits may add, as a fraction of the primitive count. 0 builds without them
+	double split_budget = 0;
+
+	// Bounds of the part of a primitive inside a region. Without one, spatial splits clip the primitive's box
+	using clip_function = std::function<aabb(uint32_t primitive, const aabb& region)>;
+
+	// Relative costs the surface area heuristic weighs
+	static constexpr double traversal_cost = 1.0;
+	static constexpr double intersection_cost = 1.0;
+
+	void build(const std::vector<aabb>& boxes, const clip_function& clip = nullptr)
+	{
+		nodes.clear();
+		levels.clear();
+		if (split_budget > 0)
+		{
+			build_spatial(boxes, clip);
+			return;
+		}
+
+		indices.resize(boxes.size());
+		if (boxes.empty())
+			return;
+
+		// Boxes are moved along with the partitions, so every pass over a node reads memory in order
+		std::vector<reference> references(boxes.size());
+		for (uint32_t i = 0; i < references.size(); i++)
+			references[i] = { boxes[i], i };
+
+		// Large subtrees are built as parallel tasks, a few levels deeper than there are threads to even out uneven splits
+		int task_depth = 0;
+		for (int threads = omp_get_max_threads(); threads > 1; threads = (threads + 1) / 2)
+			task_depth++;
+		task_depth += task_depth > 0 ? 2 : 0;
+
+		aabb bbox, centroid_box;
+		for (const auto& ref : references)
+		{
+			point3 centroid = ref.bbox.centroid();
+			bbox = aabb(bbox, ref.bbox);
+			centroid_box = aabb(centroid_box, aabb(centroid, centroid));
+		}
+
+		nodes.reserve(2 * boxes.size() / max_leaf_size + 1);
+		#pragma omp parallel if (task_depth > 0 && !omp_in_parallel())
+		#pragma omp single
+		build_node(references, 0, uint32_t(references.size()), bbox, centroid_box, 0, task_depth);
+		for (size_t i = 0; i < references.size(); i++)
+			indices[i] = references[i].primitive;
+	}
+
+	aabb bounds() const
+	{
+		return nodes.empty() ? aabb::empty : nodes[0].bbox;
+	}
+
+	/*
+	 * Visits leaves roughly front to back. test(primitive, ray_t) intersects one primitive
+	 * and returns true on a hit, after narrowing ray_t.max to the hit distance.
+	 */
+	template <typename primitive_test>
+	bool traverse(const ray& r, interval& ray_t, primitive_test&& test) const
+	{
+		return view().traverse(r, ray_t, test);
+	}
+
+	/* The same, handing test(first, count, ray_t) a leaf's whole range of entries in indices at once */
+	template <typename leaf_test>
+	bool traverse_leaves(const ray& r, interval& ray_t, leaf_test&& test) const
+	{
+		return view().traverse_leaves(r, ray_t, test);
+	}
+
+	/* Traverses a packet of rays together, see bvh_view::traverse_packet */
+	template <typename leaf_test>
+	void traverse_packet(const ray* rays, interval* ray_t, int count, uint64_t mask, leaf_test&& test) const
+	{
+		view().traverse_packet(rays, ray_t, count, mask, test);
+	}
+
+	/* Traverses rays with several in flight at once, see bvh_view::traverse_interleaved */
+	template <typename leaf_test, typename leaf_fetch, typename finish>
+	void traverse_interleaved(const ray* rays, interval* ray_t, const uint8_t* active, size_t count, int lanes,
+							  leaf_test&& test, leaf_fetch&& fetch, finish&& done) const
+	{
+		view().traverse_interleaved(rays, ray_t, active, count, lanes, test, fetch, done);
+	}
+
+	/* The built nodes and indices, for traversing them or writing them out as they are */
+	bvh_view view() const
+	{
+		return bvh_view{ nodes.data(), indices.data(), nodes.size() };
+	}
+
+	/* Calls visit(primitive) for every primitive whose leaf box contains the point */
+	template <typename point_visit>
+	bool any_containing(const point3& p, point_visit&& visit) const
+	{
+		if (nodes.empty())
+			return false;
+
+		uint32_t stack[stack_size];
+		int size = 0;
+		stack[size++] = 0;
+		while (size > 0)
+		{
+			uint32_t node = stack[--size];
+			const bvh_node& current = nodes[node];
+			if (!current.bbox.contains(p))
+				continue;
+			if (current.is_leaf())
+			{
+				for (uint32_t i = current.first; i < current.first + current.count; i++)
+				{
+					if (visit(indices[i]))
+						return true;
+				}
+				continue;
+			}
+			stack[size++] = current.first;
+			stack[size++] = node + 1;
+		}
+		return false;
+	}
+
+	/*
+	 * Recomputes every node box bottom-up from new primitive boxes, keeping the topology.
+	 * Each level is refit in parallel once the level below it is done. Spatially split
+	 * leaves grow back to their primitives' full boxes, which stays correct but loosens them.
+	 */
+	void refit(const std::vector<aabb>& boxes)
+	{
+		for (int depth = int(levels.size()) - 1; depth >= 0; depth--)
+		{
+			const std::vector<uint32_t>& level = levels[depth];
+			#pragma omp parallel for schedule(static) if (level.size() > 256)
+			for (int i = 0; i < int(level.size()); i++)
+			{
+				bvh_node& node = nodes[level[i]];
+				if (node.is_leaf())
+				{
+					aabb bbox;
+					for (uint32_t j = node.first; j < node.first + node.count; j++)
+						bbox = aabb(bbox, boxes[indices[j]]);
+					node.bbox = bbox;
+				}
+				else
+				{
+					node.bbox = aabb(nodes[level[i] + 1].bbox, nodes[node.first].bbox);
+				}
+			}
+		}
+	}
+
+	/* Expected cost of a random ray under the surface area heuristic, relative to one intersection */
+	double sah_cost() const
+	{
+		if (nodes.empty())
+			return 0;
+		double root_area = nodes[0].bbox.surface_area();
+		if (root_area <= 0)
+			return nodes[0].is_leaf() ? nodes[0].count * intersection_cost : traversal_cost;
+
+		double cost = 0;
+		for (const auto& node : nodes)
+		{
+			double weight = node.bbox.surface_area() / root_area;
+			cost += weight * (node.is_leaf() ? node.count * intersection_cost : traversal_cost);
+		}
+		return cost;
+	}
+
+	/*
+	 * Partitions count primitive indices at the cheapest binned split and returns the size of the
+	 * left part. Returns count when a leaf is cheaper, or 0 when the centroids cannot be separated.
+	 */
+	static uint32_t sah_partition(uint32_t* range, uint32_t count, const std::vector<aabb>& boxes,
+								  const std::vector<point3>& centroids, const aabb& bbox, const aabb& centroid_box,
+								  int max_leaf_size)
+	{
+		return sah_partition(range, count, [&](uint32_t i) -> const aabb& { return boxes[i]; },
+			[&](uint32_t i) { return centroids[i]; }, bbox, centroid_box, max_leaf_size);
+	}
+
+	/*
+	 * The same over any items, whose box and centroid are given by box_of(item) and centroid_of(item).
+	 * With child_bounds it also stores the left box, left centroid box, right box and right centroid
+	 * box gathered while partitioning, sparing the children another pass over their items.
+	 */
+	template <typename item, typename box_function, typename centroid_function>
+	static uint32_t sah_partition(item* range, uint32_t count, box_function&& box_of, centroid_function&& centroid_of,
+								  const aabb& bbox, const aabb& centroid_box, int max_leaf_size, aabb* child_bounds = nullptr)
+	{
+		// All three axes are binned in one pass over the items
+		bin bins[3][bin_count];
+		double scale[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double size = centroid_box.axis_interval(axis).size();
+			scale[axis] = size > 0 ? bin_count / size : 0;
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const aabb& box = box_of(range[i]);
+			point3 centroid = centroid_of(range[i]);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (scale[axis] == 0)
+					continue;
+				int b = std::min(bin_count - 1, int((centroid[axis] - centroid_box.axis_interval(axis).min) * scale[axis]));
+				bins[axis][b].count++;
+				bins[axis][b].bbox = aabb(bins[axis][b].bbox, box);
+			}
+		}
+
+		double best_cost = infinity;
+		int best_axis = -1, best_split = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (scale[axis] == 0)
+				continue;
+
+			// Sweep from the right to collect suffix areas, then from the left to price each split
+			double right_area[bin_count];
+			uint32_t right_count[bin_count];
+			aabb right_box;
+			uint32_t right_total = 0;
+			for (int b = bin_count - 1; b > 0; b--)
+			{
+				right_box = aabb(right_box, bins[axis][b].bbox);
+				right_total += bins[axis][b].count;
+				right_area[b] = right_box.surface_area();
+				right_count[b] = right_total;
+			}
+
+			aabb left_box;
+			uint32_t left_total = 0;
+			for (int b = 0; b < bin_count - 1; b++)
+			{
+				left_box = aabb(left_box, bins[axis][b].bbox);
+				left_total += bins[axis][b].count;
+				if (left_total == 0 || right_count[b + 1] == 0)
+					continue;
+				double cost = left_box.surface_area() * left_total + right_area[b + 1] * right_count[b + 1];
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_split = b + 1;
+				}
+			}
+		}
+
+		if (best_axis < 0)
+			return 0;
+
+		double area = bbox.surface_area();
+		double split_cost = traversal_cost + intersection_cost * (area > 0 ? best_cost / area : count);
+		double leaf_cost = intersection_cost * count;
+		if (split_cost >= leaf_cost && count <= uint32_t(4 * max_leaf_size))
+			return count;
+
+		double min = centroid_box.axis_interval(best_axis).min;
+		aabb bounds[4];
+		auto goes_left = [&](const item& i, point3& centroid)
+		{
+			centroid = centroid_of(i);
+			return std::min(bin_count - 1, int((centroid[best_axis] - min) * scale[best_axis])) < best_split;
+		};
+		auto gather = [&](const item& i, const point3& centroid, aabb* side)
+		{
+			side[0] = aabb(side[0], box_of(i));
+			side[1] = aabb(side[1], aabb(centroid, centroid));
+		};
+
+		item* left = range;
+		item* right = range + count;
+		point3 centroid;
+		while (true)
+		{
+			while (left < right && goes_left(*left, centroid))
+				gather(*left++, centroid, bounds);
+			while (left < right && !goes_left(*(right - 1), centroid))
+				gather(*--right, centroid, bounds + 2);
+			if (left == right)
+				break;
+			std::swap(*left, *(right - 1));
+		}
+		if (child_bounds)
+			std::copy(bounds, bounds + 4, child_bounds);
+		return uint32_t(left - range);
+	}
+
+  private:
+	static const int bin_count = 16;
+
+	// Depth past which splits fall back to halving the range, which keeps traversal stacks bounded
+	static const int median_depth = 48;
+	static const int stack_size = 128;
+
+	struct bin
+	{
+		aabb bbox;
+		uint32_t count = 0;
+	};
+
+	// Primitive box carried through the build, or the part of one owned by a spatially split node
+	struct reference
+	{
+		aabb bbox;
+		uint32_t primitive;
+	};
+
+	// Fewest primitives worth handing to another thread
+	static const uint32_t task_grain = 1 << 14;
+
+	/* Builds the subtree over a range whose bounds the parent gathered while partitioning */
+	uint32_t build_node(std::vector<reference>& references, uint32_t begin, uint32_t end,
+						const aabb& bbox, const aabb& centroid_box, int depth, int task_depth)
+	{
+		uint32_t node = uint32_t(nodes.size());
+		nodes.push_back(bvh_node());
+		if (levels.size() <= size_t(depth))
+			levels.resize(depth + 1);
+		levels[depth].push_back(node);
+		nodes[node].bbox = bbox;
+
+		uint32_t count = end - begin;
+		if (count <= uint32_t(max_leaf_size))
+			return make_leaf(node, begin, count);
+
+		aabb child[4];
+		uint32_t split = (depth < median_depth)
+			? sah_partition(references.data() + begin, count, [](const reference& ref) -> const aabb& { return ref.bbox; },
+				[](const reference& ref) { return ref.bbox.centroid(); }, bbox, centroid_box, max_leaf_size, child) : 0;
+		if (split == count)
+			return make_leaf(node, begin, count);
+		uint32_t middle = split ? begin + split : 0;
+		if (middle == 0)
+		{
+			// No useful split plane, halve along the widest centroid spread instead
+			int axis = centroid_box.longest_axis();
+			middle = begin + count / 2;
+			std::nth_element(references.begin() + begin, references.begin() + middle, references.begin() + end,
+				[&](const reference& a, const reference& b) { return a.bbox.centroid()[axis] < b.bbox.centroid()[axis]; });
+			for (int side = 0; side < 2; side++)
+			{
+				child[2 * side] = child[2 * side + 1] = aabb();
+				for (uint32_t i = side ? middle : begin; i < (side ? end : middle); i++)
+				{
+					point3 centroid = references[i].bbox.centroid();
+					child[2 * side] = aabb(child[2 * side], references[i].bbox);
+					child[2 * side + 1] = aabb(child[2 * side + 1], aabb(centroid, centroid));
+				}
+			}
+		}
+
+		uint32_t right;
+		if (task_depth > 0 && count >= task_grain)
+		{
+			// Each side builds into a tree of its own, copied in afterwards so the layout matches a serial build
+			bvh_tree left_tree, right_tree;
+			left_tree.max_leaf_size = right_tree.max_leaf_size = max_leaf_size;
+			#pragma omp task shared(left_tree, references, child)
+			left_tree.build_node(references, begin, middle, child[0], child[1], depth + 1, task_depth - 1);
+			right_tree.build_node(references, middle, end, child[2], child[3], depth + 1, task_depth - 1);
+			#pragma omp taskwait
+			append_subtree(left_tree);
+			right = append_subtree(right_tree);
+		}
+		else
+		{
+			build_node(references, begin, middle, child[0], child[1], depth + 1, task_depth);
+			right = build_node(references, middle, end, child[2], child[3], depth + 1, task_depth);
+		}
+		nodes[node].first = right;
+		nodes[node].count = 0;
+		return node;
+	}
+
+	/* Copies a separately built subtree to the end of the nodes, returning where its root landed */
+	uint32_t append_subtree(const bvh_tree& subtree)
+	{
+		uint32_t offset = uint32_t(nodes.size());
+		for (bvh_node copy : subtree.nodes)
+		{
+			if (!copy.is_leaf())
+				copy.first += offset;
+			nodes.push_back(copy);
+		}
+		if (levels.size() < subtree.levels.size())
+			levels.resize(subtree.levels.size());
+		for (size_t depth = 0; depth < subtree.levels.size(); depth++)
+		{
+			for (uint32_t node : subtree.levels[depth])
+				levels[depth].push_back(node + offset);
+		}
+		return offset;
+	}
+
+	uint32_t make_leaf(uint32_t node, uint32_t begin, uint32_t count)
+	{
+		nodes[node].first = begin;
+		nodes[node].count = count;
+		return node;
+	}
+
+
+	struct split
+	{
+		int axis = -1;
+		double cost = infinity; // Surface area weighted reference counts of both sides
+		double position = 0;    // Plane of a spatial split
+		int bin = 0;            // First right-hand bin of an object split
+		aabb left, right;
+		uint32_t left_count = 0, right_count = 0;
+	};
+
+	struct spatial_context
+	{
+		const clip_function& clip;
+		size_t references;
+		size_t reference_limit;
+		double min_overlap; // Child overlap area below which spatial splits are not worth trying
+	};
+
+	void build_spatial(const std::vector<aabb>& boxes, const clip_function& clip)
+	{
+		indices.clear();
+		std::vector<reference> references;
+		aabb bbox;
+		for (uint32_t i = 0; i < boxes.size(); i++)
+		{
+			if (boxes[i].is_empty())
+				continue;
+			references.push_back({ boxes[i], i });
+			bbox = aabb(bbox, boxes[i]);
+		}
+		if (references.empty())
+			return;
+
+		// Spatial splits only pay off where children overlap noticeably relative to the whole scene
+		spatial_context context{ clip, references.size(), size_t(references.size() * (1 + split_budget)),
+								 1e-5 * bbox.surface_area() };
+		nodes.reserve(2 * context.reference_limit / max_leaf_size + 1);
+		indices.reserve(context.reference_limit);
+		build_spatial_node(context, references, 0);
+	}
+
+	uint32_t build_spatial_node(spatial_context& context, std::vector<reference>& references, int depth)
+	{
+		uint32_t node = uint32_t(nodes.size());
+		nodes.push_back(bvh_node());
+		if (levels.size() <= size_t(depth))
+			levels.resize(depth + 1);
+		levels[depth].push_back(node);
+
+		aabb bbox, centroid_box;
+		for (const auto& ref : references)
+		{
+			bbox = aabb(bbox, ref.bbox);
+			centroid_box = aabb(centroid_box, aabb(ref.bbox.centroid(), ref.bbox.centroid()));
+		}
+		nodes[node].bbox = bbox;
+
+		uint32_t count = uint32_t(references.size());
+		if (count <= uint32_t(max_leaf_size))
+			return make_reference_leaf(node, references);
+
+		std::vector<reference> left, right;
+		split object = (depth < median_depth) ? find_object_split(references, centroid_box) : split();
+		split spatial;
+		if (depth < median_depth && context.references < context.reference_limit && object.axis >= 0
+			&& aabb::intersect(object.left, object.right).surface_area() > context.min_overlap)
+			spatial = find_spatial_split(context, references, bbox);
+
+		double area = bbox.surface_area();
+		double best_cost = std::fmin(object.cost, spatial.cost);
+		double split_cost = traversal_cost + intersection_cost * (area > 0 ? best_cost / area : count);
+		if (best_cost < infinity && split_cost >= intersection_cost * count && count <= uint32_t(4 * max_leaf_size))
+			return make_reference_leaf(node, references);
+
+		if (spatial.cost < object.cost)
+			spatial_partition(context, references, spatial, left, right);
+		else if (object.axis >= 0)
+			object_partition(references, centroid_box, object, left, right);
+
+		if (left.empty() || right.empty())
+		{
+			// No useful split plane, halve along the widest centroid spread instead
+			int axis = centroid_box.longest_axis();
+			auto middle = references.begin() + count / 2;
+			std::nth_element(references.begin(), middle, references.end(), [&](const reference& a, const reference& b)
+				{ return a.bbox.centroid()[axis] < b.bbox.centroid()[axis]; });
+			left.assign(references.begin(), middle);
+			right.assign(middle, references.end());
+		}
+		std::vector<reference>().swap(references); // The children own the references from here on
+
+		build_spatial_node(context, left, depth + 1);
+		uint32_t right_node = build_spatial_node(context, right, depth + 1);
+		nodes[node].first = right_node;
+		nodes[node].count = 0;
+		return node;
+	}
+
+	uint32_t make_reference_leaf(uint32_t node, const std::vector<reference>& references)
+	{
+		uint32_t first = uint32_t(indices.size());
+		for (const auto& ref : references)
+			indices.push_back(ref.primitive);
+		return make_leaf(node, first, uint32_t(references.size()));
+	}
+
+	split find_object_split(const std::vector<reference>& references, const aabb& centroid_box) const
+	{
+		split best;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const interval& extent = centroid_box.axis_interval(axis);
+			if (!(extent.size() > 0))
+				continue;
+
+			bin bins[bin_count];
+			double scale = bin_count / extent.size();
+			for (const auto& ref : references)
+			{
+				int b = std::min(bin_count - 1, int((ref.bbox.centroid()[axis] - extent.min) * scale));
+				bins[b].count++;
+				bins[b].bbox = aabb(bins[b].bbox, ref.bbox);
+			}
+			sweep_bins(bins, bins, bins, axis, best, [&](int b) { best.bin = b; });
+		}
+		return best;
+	}
+
+	/* Bins clipped reference parts along each axis, counting each reference where it enters and where it leaves */
+	split find_spatial_split(spatial_context& context, const std::vector<reference>& references, const aabb& bbox) const
+	{
+		split best;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const interval& extent = bbox.axis_interval(axis);
+			if (!(extent.size() > 0))
+				continue;
+
+			bin parts[bin_count], entries[bin_count], exits[bin_count];
+			double width = extent.size() / bin_count;
+			for (const auto& ref : references)
+			{
+				const interval& range = ref.bbox.axis_interval(axis);
+				int first = std::clamp(int((range.min - extent.min) / width), 0, bin_count - 1);
+				int last = std::clamp(int((range.max - extent.min) / width), first, bin_count - 1);
+				for (int b = first; b <= last; b++)
+				{
+					aabb part = clip_reference(context, ref, axis,
+						interval(extent.min + b * width, b == bin_count - 1 ? extent.max : extent.min + (b + 1) * width));
+					parts[b].bbox = aabb(parts[b].bbox, part);
+				}
+				entries[first].count++;
+				exits[last].count++;
+			}
+			sweep_bins(parts, entries, exits, axis, best, [&](int b) { best.position = extent.min + b * width; });
+		}
+		return best;
+	}
+
+	/*
+	 * Prices every plane between bins, taking the left count from entries and the right count from
+	 * exits, which for object splits are both the plain bins. Records an improvement through found(bin).
+	 */
+	template <typename on_found>
+	static void sweep_bins(const bin* boxes, const bin* entries, const bin* exits, int axis, split& best, on_found&& found)
+	{
+		aabb right_box[bin_count];
+		uint32_t right_count[bin_count];
+		aabb box;
+		uint32_t total = 0;
+		for (int b = bin_count - 1; b > 0; b--)
+		{
+			box = aabb(box, boxes[b].bbox);
+			total += exits[b].count;
+			right_box[b] = box;
+			right_count[b] = total;
+		}
+
+		aabb left_box;
+		uint32_t left_total = 0;
+		for (int b = 0; b < bin_count - 1; b++)
+		{
+			left_box = aabb(left_box, boxes[b].bbox);
+			left_total += entries[b].count;
+			if (left_total == 0 || right_count[b + 1] == 0)
+				continue;
+			double cost = left_box.surface_area() * left_total + right_box[b + 1].surface_area() * right_count[b + 1];
+			if (cost < best.cost)
+			{
+				best.cost = cost;
+				best.axis = axis;
+				best.left = left_box;
+				best.right = right_box[b + 1];
+				best.left_count = left_total;
+				best.right_count = right_count[b + 1];
+				found(b + 1);
+			}
+		}
+	}
+
+	void object_partition(const std::vector<reference>& references, const aabb& centroid_box, const split& chosen,
+						  std::vector<reference>& left, std::vector<reference>& right) const
+	{
+		const interval& extent = centroid_box.axis_interval(chosen.axis);
+		double scale = bin_count / extent.size();
+		for (const auto& ref : references)
+		{
+			int b = std::min(bin_count - 1, int((ref.bbox.centroid()[chosen.axis] - extent.min) * scale));
+			(b < chosen.bin ? left : right).push_back(ref);
+		}
+	}
+
+	/*
+	 * Sends references to the side of the plane they lie on and splits the ones straddling it,
+	 * unless keeping one whole on a single side is cheaper or the duplication budget has run out.
+	 */
+	void spatial_partition(spatial_context& context, const std::vector<reference>& references, const split& chosen,
+						   std::vector<reference>& left, std::vector<reference>& right) const
+	{
+		int axis = chosen.axis;
+		double plane = chosen.position;
+		aabb left_box = chosen.left, right_box = chosen.right;
+		double left_count = chosen.left_count, right_count = chosen.right_count;
+
+		for (const auto& ref : references)
+		{
+			const interval& range = ref.bbox.axis_interval(axis);
+			if (range.max <= plane)
+			{
+				left.push_back(ref);
+				continue;
+			}
+			if (range.min >= plane)
+			{
+				right.push_back(ref);
+				continue;
+			}
+
+			aabb left_part = clip_reference(context, ref, axis, interval(range.min, plane));
+			aabb right_part = clip_reference(context, ref, axis, interval(plane, range.max));
+			if (right_part.is_empty())
+			{
+				left.push_back({ left_part, ref.primitive });
+				continue;
+			}
+			if (left_part.is_empty())
+			{
+				right.push_back({ right_part, ref.primitive });
+				continue;
+			}
+
+			double whole_left = aabb(left_box, ref.bbox).surface_area() * left_count + right_box.surface_area() * (right_count - 1);
+			double whole_right = left_box.surface_area() * (left_count - 1) + aabb(right_box, ref.bbox).surface_area() * right_count;
+			double duplicated = context.references < context.reference_limit
+				? left_box.surface_area() * left_count + right_box.surface_area() * right_count : infinity;
+
+			if (duplicated <= whole_left && duplicated <= whole_right)
+			{
+				left.push_back({ left_part, ref.primitive });
+				right.push_back({ right_part, ref.primitive });
+				context.references++;
+			}
+			else if (whole_left <= whole_right)
+			{
+				left.push_back(ref);
+				left_box = aabb(left_box, ref.bbox);
+				right_count--;
+			}
+			else
+			{
+				right.push_back(ref);
+				right_box = aabb(right_box, ref.bbox);
+				left_count--;
+			}
+		}
+	}
+
+	/* Part of a reference within a slab along one axis */
+	static aabb clip_reference(const spatial_context& context, const reference& ref, int axis, const interval& slab)
+	{
+		aabb region = ref.bbox;
+		interval& range = (axis == 0) ? region.x : (axis == 1) ? region.y : region.z;
+		range = interval(std::fmax(range.min, slab.min), std::fmin(range.max, slab.max));
+		if (region.is_empty() || !context.clip)
+			return region;
+		return aabb::intersect(context.clip(ref.primitive, region), region);
+	}
+};
+
+/*
+ * Hittable container that accelerates its objects with a bvh_tree. Unbounded objects,
+ * like planes, cannot be placed in the tree and are tested on every ray instead.
+ */
+class bvh : public hittable
+{
+  public:
+	bvh(const hittable_list& list, double split_budget = 0) : bvh(list.objects, split_budget) {}
+
+	/* A split budget above 0 lets the build split large objects across nodes, see bvh_tree */
+	bvh(const std::vector<shared_ptr<hittable>>& objects, double split_budget = 0)
+	{
+		for (const auto& object : objects)
+		{
+			if (object->bounding_box().is_bounded())
+				bounded.push_back(object);
+			else
+				unbounded.push_back(object);
+		}
+		tree.split_budget = split_budget;
+		build();
+	}
+
+	// Refits rebuild instead once the SAH cost grows past this multiple of the cost at the last build
+	double rebuild_threshold = 1.25;
+
+	// What the last update() did
+	struct update_report
+	{
+		bool rebuilt = false;
+		double seconds = 0;
+		double sah_ratio = 1; // SAH cost against the cost at the last build
+	};
+
+	/* Rebuilds the tree from the objects' current bounds */
+	void build()
+	{
+		tree.build(object_boxes(), [this](uint32_t i, const aabb& region) { return bounded[i]->clipped_box(region); });
+		built_cost = tree.sah_cost();
+	}
+
+	/*
+	 * Brings the tree up to date after objects moved: a parallel refit, or a full
+	 * rebuild when the refit tree has degraded past rebuild_threshold.
+	 */
+	update_report update()
+	{
+		auto start = std::chrono::steady_clock::now();
+		update_report report;
+
+		tree.refit(object_boxes());
+		report.sah_ratio = built_cost > 0 ? tree.sah_cost() / built_cost : 1;
+		if (report.sah_ratio > rebuild_threshold)
+		{
+			build();
+			report.rebuilt = true;
+		}
+		report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return report;
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		bool hit_anything = false;
+		for (const auto& object : unbounded)
+		{
+			if (object->hit(r, ray_t, rec))
+			{
+				hit_anything = true;
+				ray_t.max = rec.t;
+			}
+		}
+
+		hit_anything |= tree.traverse(r, ray_t, [&](uint32_t i, interval& t)
+		{
+			if (!bounded[i]->hit(r, t, rec))
+				return false;
+			t.max = rec.t;
+			return true;
+		});
+		return hit_anything;
+	}
+
+	/*
+	 * Unbounded objects take the whole stream, then the tree is traversed by packets of consecutive
+	 * rays. Each object of a leaf gets the packet's rays reaching the leaf as one stream. Packets
+	 * only pay off when their rays take the same paths, so a packet whose rays head into different
+	 * octants goes through the tree one ray at a time instead, or interleaved with the other such
+	 * rays of the stream when the thread's interleaving asks for it.
+	 */
+	void hit_stream(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+					std::span<const uint8_t> active, std::span<uint8_t> hits) const override
+	{
+		for (const auto& object : unbounded)
+			object->hit_stream(rays, ray_t, recs, active, hits);
+
+		const int packet_size = bvh_view::packet_size;
+		bool interleave = interleaving.rays > 1;
+		std::vector<uint8_t> loose(interleave ? rays.size() : 0); // Rays left to the interleaved traversal
+		for (size_t first = 0; first < rays.size(); first += packet_size)
+		{
+			int count = int(std::min<size_t>(packet_size, rays.size() - first));
+			uint64_t mask = 0;
+			int octants = 0;
+			vec3 heading(0, 0, 0);
+			for (int i = 0; i < count; i++)
+			{
+				if (!active[first + i])
+					continue;
+				mask |= uint64_t(1) << i;
+				octants |= 1 << octant(rays[first + i].direction());
+				heading += unit_vector(rays[first + i].direction());
+			}
+
+			// Rays sharing an octant can still fan out too far to share many nodes
+			if (std::popcount(unsigned(octants)) > 1 || heading.length() < packet_spread * std::popcount(mask))
+			{
+				for (int i = 0; i < count; i++)
+				{
+					if (interleave)
+						loose[first + i] = active[first + i];
+					else if (active[first + i])
+						hit_tree(rays[first + i], ray_t[first + i], recs[first + i], hits[first + i]);
+				}
+				continue;
+			}
+
+			uint8_t reaching[packet_size];
+			tree.traverse_packet(&rays[first], &ray_t[first], count, mask, [&](uint32_t begin, uint32_t size, uint64_t leaf_mask)
+			{
+				// Only the span from the first to the last reaching ray is handed on
+				size_t lo = std::countr_zero(leaf_mask), hi = packet_size - std::countl_zero(leaf_mask);
+				for (size_t i = lo; i < hi; i++)
+					reaching[i] = (leaf_mask >> i) & 1;
+				size_t at = first + lo, n = hi - lo;
+				for (uint32_t k = begin; k < begin + size; k++)
+					bounded[tree.indices[k]]->hit_stream(rays.subspan(at, n), ray_t.subspan(at, n), recs.subspan(at, n),
+						std::span<const uint8_t>(reaching + lo, n), hits.subspan(at, n));
+			});
+		}
+
+		if (interleave)
+		{
+			hit_record temp_recs[bvh_view::max_interleaved];
+			tree.traverse_interleaved(rays.data(), ray_t.data(), loose.data(), rays.size(), interleaving.rays,
+				[&](int slot, size_t r, uint32_t begin, uint32_t size, interval& t)
+				{
+					bool hit_anything = false;
+					for (uint32_t k = begin; k < begin + size; k++)
+					{
+						if (bounded[tree.indices[k]]->hit(rays[r], t, temp_recs[slot]))
+						{
+							t.max = temp_recs[slot].t;
+							hit_anything = true;
+						}
+					}
+					return hit_anything;
+				},
+				[&](uint32_t begin, uint32_t size)
+				{
+					for (uint32_t k = begin; k < begin + size; k++)
+						prefetch(bounded[tree.indices[k]].get());
+				},
+				[&](int slot, size_t r, bool hit)
+				{
+					if (!hit)
+						return;
+					recs[r] = temp_recs[slot];
+					hits[r] = 1;
+				});
+		}
+	}
+
+	/* Treated as the union of its objects */
+	bool volume_contains(const point3 p) const override
+	{
+		for (const auto& object : unbounded)
+		{
+			if (object->volume_contains(p))
+				return true;
+		}
+		return tree.any_containing(p, [&](uint32_t i) { return bounded[i]->volume_contains(p); });
+	}
+
+	aabb bounding_box() const override
+	{
+		return unbounded.empty() ? tree.bounds() : aabb::universe;
+	}
+
+	const bvh_tree& hierarchy() const { return tree; }
+
+  protected:
+	std::vector<shared_ptr<hittable>> bounded;
+	std::vector<shared_ptr<hittable>> unbounded;
+	bvh_tree tree;
+	double built_cost = 0;
+
+	// Least length of a packet's mean unit direction for it to be traversed as a packet
+	static constexpr double packet_spread = 0.9;
+
+	// Index of the direction's sign pattern, from 0 to 7
+	static int octant(const vec3& direction)
+	{
+		return (direction.x() < 0) | (direction.y() < 0) << 1 | (direction.z() < 0) << 2;
+	}
+
+	/* Single ray traversal of the tree for hit_stream, recording a hit the way a stream does */
+	void hit_tree(const ray& r, interval& ray_t, hit_record& rec, uint8_t& hit) const
+	{
+		hit_record temp_rec;
+		bool found = tree.traverse(r, ray_t, [&](uint32_t i, interval& t)
+		{
+			if (!bounded[i]->hit(r, t, temp_rec))
+				return false;
+			t.max = temp_rec.t;
+			return true;
+		});
+		if (found)
+		{
+			rec = temp_rec;
+			hit = 1;
+		}
+	}
+
+	std::vector<aabb> object_boxes() const
+	{
+		std::vector<aabb> boxes(bounded.size());
+		#pragma omp parallel for schedule(static) if (boxes.size() > 1024)
+		for (int i = 0; i < int(bounded.size()); i++)
+			boxes[i] = bounded[i]->bounding_box();
+		return boxes;
+	}
+};
+
+#endif
@@ -10,7 +10,15 @@
 #include "hittable.h"
 #include "hittable_list.h"
 #include "material.h"
+#include "ray_order.h"
+#include "stats.h"
 #include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 class camera
@@ -30,48 +38,189 @@ class camera
     double defocus_angle = 0; // Variation angle of rays through each pixel
     double focus_dist = 10;   // Distance from camera lookfrom point to plane of perfect focus
 
-    // Render the image
+    int samples_per_pass = 0;      // Samples per pixel in each full-frame pass, 0 takes every sample in one pass
+    double time_budget = 0;        // Wall-clock limit in seconds, 0 renders until samples_per_pixel is reached
+    double snapshot_interval = 0;  // Seconds between intermediate writes of the output image, 0 disables
+    int snapshot_passes = 0;       // Passes between intermediate writes of the output image, 0 disables
+    std::string output_file = "image.png";
+
+    uint64_t seed = 0;                // Base seed of the per-sample random streams
+    std::string checkpoint_file = ""; // Accumulation checkpoint path, empty disables checkpoints
+    double checkpoint_interval = 60;  // Seconds between checkpoints
+    bool resume = false;              // Continue from checkpoint_file when it was written for this scene
+
+    bool background_output = false;   // Encode the final image on another thread so the next render can start
+    bool wavefront = false;           // Trace each row's samples a bounce at a time through hit_stream
+    bool reorder_rays = false;        // In wavefront renders, sort bounce rays by direction and origin before tracing them
+    int interleaved_rays = 0;         // In wavefront renders, rays each thread keeps in flight through acceleration structures
+
+    // Wall-clock seconds spent in each stage of the last render
+    struct render_timings
+    {
+        double setup = 0;  // View, buffers, scene hash and checkpoint loading
+        double trace = 0;  // Sample passes, including snapshots and checkpoints
+        double output = 0; // Encoding the image, or waiting for the previous background encode
+        double stall = 0;  // Part of trace spent waiting for geometry that deferred samples
+        double reorder = 0; // Part of trace spent sorting bounce rays, summed over threads
+    } timings;
+
+    ray_statistics statistics; // Work counters of the last render, summed over its threads
+    uint64_t deferred_samples = 0; // Samples of the last render traced again after geometry deferred them
+
+    virtual ~camera()
+    {
+        finish_output();
+        if (checkpoint_writer.joinable())
+            checkpoint_writer.join();
+    }
+
+    // Render the image progressively, one full-frame pass at a time
     void render(const hittable& scene)
     {
+        auto setup_start = std::chrono::steady_clock::now();
         initialize();
+        uint64_t hash = scene_hash(scene);
+        statistics = ray_statistics();
+        deferred_samples = 0;
+        timings.stall = 0;
+        timings.reorder = 0;
+        if (resume && !checkpoint_file.empty())
+            read_checkpoint(hash);
         std::clog << "Computing...\n";
-        
-        // Dynamically paralellize rays in chunks of rows
-        #pragma omp parallel for shared(scene) schedule(dynamic)
-        for (int line = 0; line < image_height; line++)
+
+        int pass_size = (samples_per_pass > 0) ? samples_per_pass : samples_per_pixel;
+        auto start = std::chrono::steady_clock::now();
+        timings.setup = seconds_between(setup_start, start);
+        auto last_snapshot = start;
+        auto last_checkpoint = start;
+        double last_pass_seconds = 0;
+        int pass = 0;
+
+        while (samples_taken < samples_per_pixel)
         {
-            for (int p = 0; p < image_width; p++){
-                shade_pixel(line, p, scene);
+            int count = std::min(pass_size, samples_per_pixel - samples_taken);
+            auto pass_start = std::chrono::steady_clock::now();
+            render_pass(scene, count);
+            pass++;
+
+            auto now = std::chrono::steady_clock::now();
+            last_pass_seconds = seconds_between(pass_start, now);
+            double elapsed = seconds_between(start, now);
+
+            if (samples_taken >= samples_per_pixel)
+                break;
+
+            // Stop before a pass that would overrun the budget, every pixel keeps the same sample count
+            if (time_budget > 0 && elapsed + last_pass_seconds > time_budget)
+            {
+                std::clog << "\rTime budget reached after " << samples_taken << " samples per pixel.\n";
+                break;
             }
 
-            if (omp_get_thread_num() == 0)
-                std::clog << "\rPercent complete: " << (int) (100.0 * line / image_height) << "%" << std::flush;    
+            bool snapshot_due = (snapshot_passes > 0 && pass % snapshot_passes == 0)
+                || (snapshot_interval > 0 && seconds_between(last_snapshot, now) >= snapshot_interval);
+            if (snapshot_due)
+            {
+                write_png(output_file);
+                last_snapshot = now;
+            }
+
+            if (!checkpoint_file.empty() && seconds_between(last_checkpoint, now) >= checkpoint_interval)
+            {
+                write_checkpoint(hash);
+                last_checkpoint = now;
+            }
         }
         std::clog << "\rPercent complete: " << "100%" << std::flush;
-        write_png((char *) "image.png");
-        std::clog << "\rDone.                 \n";
+        auto output_start = std::chrono::steady_clock::now();
+        timings.trace = seconds_between(start, output_start);
+        if (!checkpoint_file.empty())
+            write_checkpoint(hash);
+
+        if (background_output)
+        {
+            // Hand the buffers to the encoder, the next initialize() allocates fresh ones
+            finish_output();
+            image_writer = std::thread(
+                [filename = output_file, width = image_width, height = image_height,
+                 counts = std::move(sample_counts), sums = std::move(color_buffer)]()
+                {
+                    encode_png(filename, width, height, counts, sums);
+                });
+        }
+        else
+        {
+            write_png(output_file);
+        }
+        if (checkpoint_writer.joinable())
+            checkpoint_writer.join();
+        timings.output = seconds_between(output_start, std::chrono::steady_clock::now());
+        std::clog << "\rDone.                                        \n";
+        print_statistics();
     }
 
-private:
-    double pixel_samples_scale; // Color scale factor for a sum of pixel samples
-    point3 center;              // Camera center
-    point3 pixel00_loc;         // Location of pixel 0, 0
-    vec3 pixel_delta_u;         // Offset to pixel to the right
-    vec3 pixel_delta_v;         // Offset to pixel below
-    vec3 u, v, w;               // Camera frame basis vectors
-    vec3 defocus_disk_u;        // Defocus disk horizontal radius
-    vec3 defocus_disk_v;        // Defocus disk vertical radius
-    std::vector<color> color_buffer; // Color buffer for parallelization
+    /* Waits for a background image encode to finish */
+    void finish_output()
+    {
+        if (image_writer.joinable())
+            image_writer.join();
+    }
+
+    /* Fingerprint of the view and of what the scene shows through it, guards checkpoints against scene edits */
+    uint64_t scene_hash(const hittable& scene) const
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        auto mix = [&hash](const void* data, size_t size)
+        {
+            auto bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+                hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+        };
+        auto mix_vec = [&mix](const vec3& v) { mix(v.e, sizeof(v.e)); };
+
+        mix(&image_width, sizeof(image_width));
+        mix(&image_height, sizeof(image_height));
+        mix(&max_depth, sizeof(max_depth));
+        mix(&vfov, sizeof(vfov));
+        mix(&defocus_angle, sizeof(defocus_angle));
+        mix(&focus_dist, sizeof(focus_dist));
+        mix(&seed, sizeof(seed));
+        mix_vec(lookfrom);
+        mix_vec(lookat);
+        mix_vec(vup);
+
+        // Probe the scene with a grid of pinhole rays through pixel centers
+        const int probes = 16;
+        for (int j = 0; j < probes; j++)
+        {
+            for (int i = 0; i < probes; i++)
+            {
+                auto pixel = pixel00_loc + ((i + 0.5) * image_width / probes) * pixel_delta_u
+                    + ((j + 0.5) * image_height / probes) * pixel_delta_v;
+                hit_record rec;
+                bool hit = scene.hit(ray(center, pixel - center), interval(0.001, infinity), rec);
+                mix(&hit, sizeof(hit));
+                if (hit)
+                {
+                    mix(&rec.t, sizeof(rec.t));
+                    mix_vec(rec.normal);
+                    mix(&rec.front_face, sizeof(rec.front_face));
+                }
+            }
+        }
+        return hash;
+    }
 
-    void initialize()
+    /* Computes the view and allocates empty image buffers, render() calls this itself */
+    virtual void initialize()
     {
         /* Ensure height and width are >= 1, and initialize color buffer with dimensions */
         image_width = (image_width < 1) ? 1 : image_width;
         image_height = (image_height < 1) ? 1 : image_height;
         color_buffer = std::vector<color>(image_height * image_width, color(0, 0, 0));
+        sample_counts = std::vector<int>(image_height * image_width, 0);
+        samples_taken = 0;
 
-        /* Predivide ratio for averaging, because iterated division is slow */
-        pixel_samples_scale = 1.0 / samples_per_pixel;
         center = lookfrom;
 
         /* Determine viewport dimensions */
@@ -103,6 +252,70 @@ private:
         defocus_disk_v = v * defocus_radius;
     }
 
+    // Pixel rectangle [x0, x1) x [y0, y1)
+    struct tile
+    {
+        int x0, y0, x1, y1;
+        int pixel_count() const { return (x1 - x0) * (y1 - y0); }
+    };
+
+    /* Traces samples [first_sample, first_sample + count) of every tile pixel, writing RGB sums row-major */
+    void trace_tile(const hittable& scene, const tile& t, int first_sample, int count, float* sums) const
+    {
+        #pragma omp parallel for shared(scene) schedule(dynamic)
+        for (int line = t.y0; line < t.y1; line++)
+        {
+            for (int p = t.x0; p < t.x1; p++)
+            {
+                color sum(0, 0, 0);
+                for (int sample = first_sample; sample < first_sample + count; sample++)
+                    sum += sample_color(line, p, scene, sample);
+
+                float* out = sums + 3 * ((line - t.y0) * (t.x1 - t.x0) + (p - t.x0));
+                out[0] = float(sum.x());
+                out[1] = float(sum.y());
+                out[2] = float(sum.z());
+            }
+        }
+    }
+
+    /* Adds RGB sums of count samples per pixel, as produced by trace_tile, to the image */
+    void accumulate_tile(const tile& t, int count, const float* sums)
+    {
+        for (int line = t.y0; line < t.y1; line++)
+        {
+            for (int p = t.x0; p < t.x1; p++)
+            {
+                const float* in = sums + 3 * ((line - t.y0) * (t.x1 - t.x0) + (p - t.x0));
+                color_buffer[line * image_width + p] += color(in[0], in[1], in[2]);
+                sample_counts[line * image_width + p] += count;
+            }
+        }
+    }
+
+    /*
+     * Writes output_file from the samples accumulated so far. After a render with background_output
+     * the samples went to its encoder, so this waits for that encode and writes nothing more.
+     */
+    void write_image()
+    {
+        finish_output();
+        write_png(output_file);
+    }
+
+private:
+    point3 center;              // Camera center
+    point3 pixel00_loc;         // Location of pixel 0, 0
+    vec3 pixel_delta_u;         // Offset to pixel to the right
+    vec3 pixel_delta_v;         // Offset to pixel below
+    vec3 u, v, w;               // Camera frame basis vectors
+    vec3 defocus_disk_u;        // Defocus disk horizontal radius
+    vec3 defocus_disk_v;        // Defocus disk vertical radius
+    std::vector<color> color_buffer; // Accumulated sample sums for each pixel
+    std::vector<int> sample_counts;  // Number of samples accumulated in each pixel
+    int samples_taken;               // Samples per pixel completed by every pass so far
+    std::thread checkpoint_writer;   // Background writer of the latest checkpoint
+    std::thread image_writer;        // Background encoder of the last finished image
 
     // Construct a camera ray originating from the defocus disk and directed at
     // a randomly sampled point around the pixel location i, j
@@ -119,15 +332,281 @@ private:
         return ray(ray_origin, ray_direction);
     }
 
-    /* Shades a pixel in a pixel buffer */
-    void shade_pixel(int line, int p, const hittable& scene)
+    // Sample of a pixel whose geometry was not ready, traced again at the end of the pass
+    struct deferred_sample
+    {
+        int pixel;
+        int sample;
+    };
+
+    /* Adds count samples of every pixel to the accumulation buffer */
+    void render_pass(const hittable& scene, int count)
+    {
+        std::vector<deferred_sample> deferred;
+        #pragma omp parallel shared(scene)
+        {
+            ray_stats = ray_statistics();
+            std::vector<deferred_sample> own_deferred;
+            ray_order sorter;
+            double own_reorder = 0;
+            interleaving.rays = interleaved_rays;
+
+            // Dynamically paralellize rays in chunks of rows
+            #pragma omp for schedule(dynamic)
+            for (int line = 0; line < image_height; line++)
+            {
+                if (wavefront)
+                    own_reorder += shade_row(line, scene, count, sorter);
+                else
+                    for (int p = 0; p < image_width; p++){
+                        shade_pixel(line, p, scene, count, own_deferred);
+                    }
+
+                if (omp_get_thread_num() == 0)
+                    std::clog << "\rPercent complete: "
+                        << (int) (100.0 * (samples_taken + count * double(line) / image_height) / samples_per_pixel)
+                        << "%" << std::flush;
+            }
+
+            #pragma omp critical
+            {
+                statistics += ray_stats;
+                timings.reorder += own_reorder;
+                deferred.insert(deferred.end(), own_deferred.begin(), own_deferred.end());
+            }
+            interleaving.rays = 0;
+        }
+        retry_deferred(scene, deferred);
+        samples_taken += count;
+    }
+
+    /* Accumulates count samples of a pixel into the pixel buffer, setting aside those the scene deferred */
+    void shade_pixel(int line, int p, const hittable& scene, int count, std::vector<deferred_sample>& deferred)
+    {
+        int pixel = line * image_width + p;
+        int first = sample_counts[pixel];
+        for (int sample = first; sample < first + count; sample++)
+        {
+            color c;
+            if (try_sample(line, p, scene, sample, c))
+                color_buffer[pixel] += c;
+            else
+                deferred.push_back({ pixel, sample });
+        }
+        sample_counts[pixel] += count;
+    }
+
+    /*
+     * Accumulates count samples of every pixel of a row, all paths at once, tracing each bounce of
+     * the live paths with one hit_stream call. Paths carry their random streams between bounces, so
+     * they follow the same paths as ray_color and differ only in the rounding of the products.
+     * Geometry cannot defer these rays, streamed geometry makes them wait for its loads instead.
+     * With reorder_rays, sorter orders each bounce before it is traced. Returns the seconds sorting took.
+     */
+    double shade_row(int line, const hittable& scene, int count, ray_order& sorter)
+    {
+        struct path
+        {
+            int slot; // Index of the sample in results
+            rng random;
+            color throughput;
+        };
+        size_t total = size_t(image_width) * count;
+        std::vector<path> paths;
+        std::vector<ray> rays;
+        std::vector<color> results(total, color(0, 0, 0));
+        paths.reserve(total);
+        rays.reserve(total);
+        for (int p = 0; p < image_width; p++)
+        {
+            int pixel = line * image_width + p;
+            for (int s = 0; s < count; s++)
+            {
+                thread_rng = rng(sample_seed(pixel, sample_counts[pixel] + s));
+                rays.push_back(get_ray(line, p));
+                paths.push_back({ p * count + s, thread_rng, color(1, 1, 1) });
+            }
+        }
+
+        std::vector<interval> ray_t;
+        std::vector<hit_record> recs(total);
+        std::vector<uint8_t> active, hits;
+        std::vector<uint32_t> order;
+        std::vector<path> sorted_paths;
+        std::vector<ray> sorted_rays;
+        double reorder_seconds = 0;
+        for (int depth = max_depth; depth > 0 && !paths.empty(); depth--)
+        {
+            size_t n = paths.size();
+
+            // Camera rays are coherent already, bounces leave in every direction
+            if (reorder_rays && depth < max_depth)
+            {
+                auto sort_start = std::chrono::steady_clock::now();
+                sorter.sort(rays, order);
+                sorted_paths.resize(n);
+                sorted_rays.resize(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    sorted_paths[i] = paths[order[i]];
+                    sorted_rays[i] = rays[order[i]];
+                }
+                paths.swap(sorted_paths);
+                rays.swap(sorted_rays);
+                reorder_seconds += seconds_between(sort_start, std::chrono::steady_clock::now());
+            }
+
+            ray_t.assign(n, interval(0.001, infinity));
+            active.assign(n, 1);
+            hits.assign(n, 0);
+            ray_stats.rays += n;
+            scene.hit_stream(rays, ray_t, std::span<hit_record>(recs.data(), n), active, hits);
+
+            // Finished paths leave, the rest move down over them in order
+            size_t live = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                const path& current = paths[i];
+                if (!hits[i])
+                {
+                    results[current.slot] = current.throughput * background(rays[i]);
+                    continue;
+                }
+                thread_rng = current.random;
+                ray scattered;
+                color attenuation;
+                if (!recs[i].mat->scatter(rays[i], recs[i], attenuation, scattered))
+                    continue;
+                paths[live] = { current.slot, thread_rng, current.throughput * attenuation };
+                rays[live] = scattered;
+                live++;
+            }
+            paths.resize(live);
+            rays.resize(live);
+        }
+
+        for (int p = 0; p < image_width; p++)
+        {
+            int pixel = line * image_width + p;
+            for (int s = 0; s < count; s++)
+                color_buffer[pixel] += results[p * count + s];
+            sample_counts[pixel] += count;
+        }
+        return reorder_seconds;
+    }
+
+    /* Traces one numbered sample, false when the scene deferred it */
+    bool try_sample(int line, int p, const hittable& scene, int sample, color& c) const
     {
-        for (int sample = 0; sample < samples_per_pixel; sample++)
+        deferral.allowed = true;
+        deferral.deferred = false;
+        c = sample_color(line, p, scene, sample);
+        deferral.allowed = false;
+        return !deferral.deferred;
+    }
+
+    /*
+     * Traces deferred samples again until every one completes. Samples own their random streams,
+     * so a retry follows the same path. After a round that completes nothing, for instance when a
+     * path needs more chunks than the memory budget holds, the rest wait for their loads instead.
+     */
+    void retry_deferred(const hittable& scene, std::vector<deferred_sample>& pending)
+    {
+        bool blocking = false;
+        while (!pending.empty())
         {
-            ray r = get_ray(line, p);
-            color_buffer[line * image_width + p] += ray_color(r, max_depth, scene);
+            auto round_start = std::chrono::steady_clock::now();
+            deferred_samples += pending.size();
+
+            // Samples of one pixel stay on one thread, they add into the same sum
+            std::sort(pending.begin(), pending.end(), [](const deferred_sample& a, const deferred_sample& b)
+            {
+                return a.pixel < b.pixel || (a.pixel == b.pixel && a.sample < b.sample);
+            });
+            std::vector<size_t> starts;
+            for (size_t i = 0; i < pending.size(); i++)
+                if (i == 0 || pending[i].pixel != pending[i - 1].pixel)
+                    starts.push_back(i);
+            starts.push_back(pending.size());
+
+            std::vector<deferred_sample> remaining;
+            #pragma omp parallel shared(scene)
+            {
+                ray_stats = ray_statistics();
+                std::vector<deferred_sample> own_remaining;
+
+                #pragma omp for schedule(dynamic)
+                for (long group = 0; group < long(starts.size()) - 1; group++)
+                {
+                    for (size_t i = starts[group]; i < starts[group + 1]; i++)
+                    {
+                        const deferred_sample& d = pending[i];
+                        color c;
+                        if (blocking)
+                            color_buffer[d.pixel] += sample_color(d.pixel / image_width, d.pixel % image_width, scene, d.sample);
+                        else if (try_sample(d.pixel / image_width, d.pixel % image_width, scene, d.sample, c))
+                            color_buffer[d.pixel] += c;
+                        else
+                            own_remaining.push_back(d);
+                    }
+                }
+
+                #pragma omp critical
+                {
+                    statistics += ray_stats;
+                    remaining.insert(remaining.end(), own_remaining.begin(), own_remaining.end());
+                }
+            }
+
+            if (blocking)
+                timings.stall += seconds_between(round_start, std::chrono::steady_clock::now());
+            blocking = remaining.size() == pending.size();
+            pending.swap(remaining);
         }
-        color_buffer[line * image_width + p] = pixel_samples_scale * color_buffer[line * image_width + p];
+    }
+
+    /* Traces one numbered sample of a pixel */
+    color sample_color(int line, int p, const hittable& scene, int sample) const
+    {
+        // Every sample owns a random stream, so results do not depend on threads, passes, restarts or machines
+        thread_rng = rng(sample_seed(line * image_width + p, sample));
+        ray r = get_ray(line, p);
+        return ray_color(r, max_depth, scene);
+    }
+
+    uint64_t sample_seed(int pixel, int sample) const
+    {
+        rng mixer(seed ^ ((uint64_t(pixel) << 32) | uint32_t(sample)));
+        return mixer.next();
+    }
+
+    /* Per-ray work of the last render, with the sphere tracing cost when distance fields were marched */
+    void print_statistics() const
+    {
+        if (statistics.rays == 0)
+            return;
+        double rays = double(statistics.rays);
+        std::clog << "Rays: " << statistics.rays;
+        if (statistics.node_visits > 0)
+            std::clog << ", " << statistics.node_visits / rays << " nodes and " << statistics.primitive_tests / rays << " tests per ray";
+        std::clog << "\n";
+        if (statistics.marched_rays > 0)
+            std::clog << "Sphere tracing: " << statistics.marched_rays << " marches, "
+                << double(statistics.march_steps) / statistics.marched_rays << " steps per march, "
+                << statistics.march_steps / rays << " per ray\n";
+        if (statistics.chunk_visits > 0)
+            std::clog << "Streaming: " << 100.0 * (statistics.chunk_visits - statistics.chunk_misses) / statistics.chunk_visits
+                << "% of chunk visits resident, " << deferred_samples << " samples deferred, "
+                << timings.stall << " s stalled\n";
+        if (statistics.packet_steps > 0)
+            std::clog << "Packets: " << 100.0 * statistics.packet_rays / statistics.rays << "% of rays, "
+                << double(statistics.packet_lanes) / statistics.packet_steps << " rays per node test"
+                << (reorder_rays ? ", " + std::to_string(timings.reorder) + " s sorting" : "") << "\n";
+    }
+
+    static double seconds_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b)
+    {
+        return std::chrono::duration<double>(b - a).count();
     }
 
     // Returns the vector to a random point in the [-.5,-.5],[+.5,+.5] unit square
@@ -143,15 +622,22 @@ private:
         return center + (p[0] * defocus_disk_u) + (p[1] * defocus_disk_v);
     }
 
-    color ray_color(const ray& r, int depth, const hittable& world)
+    color ray_color(const ray& r, int depth, const hittable& world) const
     {
         // If we've exceeded the ray bounce limit, no more light is gathered
         if (depth <= 0)
             return color(0, 0, 0);
 
         hit_record rec;
+        ray_stats.rays++;
 
-        if (world.hit(r, interval(0.001, infinity), rec))
+        bool hit = world.hit(r, interval(0.001, infinity), rec);
+
+        // A deferred sample is traced again later, the rest of this path would be thrown away
+        if (deferral.deferred)
+            return color(0, 0, 0);
+
+        if (hit)
         {
             ray scattered;
             color attenuation;
@@ -166,19 +652,123 @@ private:
             return color(0, 0, 0);
         }
 
+        return background(r);
+    }
+
+    // Sky gradient seen by rays that leave the scene
+    static color background(const ray& r)
+    {
         vec3 unit_direction = unit_vector(r.direction());
         auto a = 0.5 * (unit_direction.y() + 1.0);
         return ((1.0 - a) * color(1.0, 1.0, 1.0) + a * color(0.5, 0.7, 1.0));
     }
 
-    void write_png(char *filename)
+    /*
+     * Checkpoint layout, native endianness:
+     * "RTCK", version, width, height, seed, scene hash, samples taken,
+     * then a sample count and an RGB sum per pixel, row-major
+     */
+    static constexpr uint32_t checkpoint_version = 1;
+
+    /* Snapshots the accumulation buffers and writes them in the background, replacing the file atomically */
+    void write_checkpoint(uint64_t hash)
+    {
+        if (checkpoint_writer.joinable())
+            checkpoint_writer.join();
+
+        checkpoint_writer = std::thread(
+            [filename = checkpoint_file, width = image_width, height = image_height, seed = seed, hash,
+             taken = samples_taken, counts = sample_counts, sums = color_buffer]()
+            {
+                std::string temp_file = filename + ".tmp";
+                {
+                    std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+                    uint32_t header[3] = { checkpoint_version, uint32_t(width), uint32_t(height) };
+                    out.write("RTCK", 4);
+                    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+                    out.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+                    out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+                    out.write(reinterpret_cast<const char*>(&taken), sizeof(taken));
+                    out.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(int));
+                    out.write(reinterpret_cast<const char*>(sums.data()), sums.size() * sizeof(color));
+                    if (!out)
+                    {
+                        std::cerr << "Could not write checkpoint " << temp_file << "\n";
+                        return;
+                    }
+                }
+                std::error_code error;
+                std::filesystem::rename(temp_file, filename, error);
+                if (error)
+                    std::cerr << "Could not write checkpoint " << filename << ": " << error.message() << "\n";
+            });
+    }
+
+    /* Restores the accumulation buffers when the checkpoint matches this render, otherwise starts fresh */
+    void read_checkpoint(uint64_t hash)
+    {
+        std::ifstream in(checkpoint_file, std::ios::binary);
+        if (!in)
+        {
+            std::clog << "No checkpoint at " << checkpoint_file << ", starting fresh.\n";
+            return;
+        }
+
+        char magic[4];
+        uint32_t header[3];
+        uint64_t file_seed, file_hash;
+        int taken;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        in.read(reinterpret_cast<char*>(&file_seed), sizeof(file_seed));
+        in.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+        in.read(reinterpret_cast<char*>(&taken), sizeof(taken));
+
+        if (!in || std::string(magic, 4) != "RTCK" || header[0] != checkpoint_version
+            || int(header[1]) != image_width || int(header[2]) != image_height
+            || file_seed != seed || file_hash != hash)
+        {
+            std::clog << "Checkpoint " << checkpoint_file << " is from a different render, starting fresh.\n";
+            return;
+        }
+
+        std::vector<int> counts(sample_counts.size());
+        std::vector<color> sums(color_buffer.size());
+        in.read(reinterpret_cast<char*>(counts.data()), counts.size() * sizeof(int));
+        in.read(reinterpret_cast<char*>(sums.data()), sums.size() * sizeof(color));
+        if (!in)
+        {
+            std::clog << "Checkpoint " << checkpoint_file << " is truncated, starting fresh.\n";
+            return;
+        }
+
+        sample_counts = std::move(counts);
+        color_buffer = std::move(sums);
+        samples_taken = taken;
+        std::clog << "Resuming from " << samples_taken << " samples per pixel.\n";
+    }
+
+    void write_png(const std::string& filename)
+    {
+        if (color_buffer.size() != size_t(image_width) * image_height)
+        {
+            std::cerr << "No samples to write to " << filename << ", they went to the background encode of the last render\n";
+            return;
+        }
+        encode_png(filename, image_width, image_height, sample_counts, color_buffer);
+    }
+
+    /* Writes the average of the accumulated samples, through a temporary file so the image is never partial */
+    static void encode_png(const std::string& filename, int image_width, int image_height,
+                           const std::vector<int>& sample_counts, const std::vector<color>& color_buffer)
     {
         std::vector<unsigned char> out = std::vector<unsigned char>(image_height * image_width * 3, 0);
         for (int i = 0; i < image_height * image_width; i++)
         {
-            double r = color_buffer[i].x();
-            double g = color_buffer[i].y();
-            double b = color_buffer[i].z();
+            double scale = (sample_counts[i] > 0) ? 1.0 / sample_counts[i] : 0.0;
+            double r = scale * color_buffer[i].x();
+            double g = scale * color_buffer[i].y();
+            double b = scale * color_buffer[i].z();
 
             r = linear_to_gamma(r);
             g = linear_to_gamma(g);
@@ -190,7 +780,12 @@ private:
             out[i * 3 + 1] = int(255.99 * intensity.clamp(g));
             out[i * 3 + 2] = int(255.99 * intensity.clamp(b));
         }
-        stbi_write_png(filename, image_width, image_height, 3, out.data(), sizeof(char) * 3 * image_width);
+        std::string temp_file = filename + ".tmp";
+        stbi_write_png(temp_file.c_str(), image_width, image_height, 3, out.data(), sizeof(char) * 3 * image_width);
+        std::error_code error;
+        std::filesystem::rename(temp_file, filename, error);
+        if (error)
+            std::cerr << "Could not write " << filename << ": " << error.message() << "\n";
     }
 };
 
@@ -201,11 +796,11 @@ public:
     double aspect_ratio = 1.0;
     bool auto_height = false; // Whether or not to use aspect ratio to determine height
 
-    void render(const hittable& scene)
+    void initialize() override
     {
         if (auto_height)
             image_height = int(image_width / aspect_ratio);
-        camera::render(scene);
+        camera::initialize();
     }
 
     void set_dimensions(int width, int height)
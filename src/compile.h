@@ -0,0 +1,101 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef COMPILE_H
+#define COMPILE_H
+
+#include "box.h"
+#include "convex_polyhedron.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "plane.h"
+
+#include <typeinfo>
+#include <vector>
+
+/*
+ * Rewrites scene graphs into cheaper equivalents before acceleration structures are built.
+ * Objects that cannot be improved are returned as they are, so unchanged subtrees stay shared.
+ */
+inline shared_ptr<hittable> simplify(const shared_ptr<hittable>& object);
+
+inline std::vector<shared_ptr<hittable>> simplify(const std::vector<shared_ptr<hittable>>& objects)
+{
+	std::vector<shared_ptr<hittable>> result;
+	result.reserve(objects.size());
+	for (const auto& object : objects)
+		result.push_back(simplify(object));
+	return result;
+}
+
+// The polyhedron as an aabb_box when its faces allow, otherwise the polyhedron itself
+inline shared_ptr<hittable> simplify_solid(const shared_ptr<convex_polyhedron>& solid)
+{
+	aabb box;
+	shared_ptr<material> mat;
+	if (solid->as_axis_aligned_box(box, mat))
+		return make_shared<aabb_box>(point3(box.x.min, box.y.min, box.z.min), point3(box.x.max, box.y.max, box.z.max), mat);
+	return solid;
+}
+
+/*
+ * Intersections fold their planes into one convex_polyhedron, which replaces the node outright when only
+ * planes remain. Polyhedra that are axis-aligned boxes become aabb_boxes.
+ */
+inline shared_ptr<hittable> simplify(const shared_ptr<hittable>& object)
+{
+	if (auto solid = std::dynamic_pointer_cast<convex_polyhedron>(object))
+		return simplify_solid(solid);
+	if (auto intersection = std::dynamic_pointer_cast<hittable_intersection>(object))
+	{
+		auto solid = make_shared<convex_polyhedron>();
+		std::vector<shared_ptr<hittable>> others;
+		std::vector<shared_ptr<hittable>> children; // In their order, for when there is nothing to fold
+		for (const auto& child : intersection->objects)
+		{
+			if (auto p = std::dynamic_pointer_cast<plane>(child))
+			{
+				solid->add(p->point(), p->outward_normal(), p->surface_material());
+				children.push_back(child);
+			}
+			else
+			{
+				others.push_back(simplify(child));
+				children.push_back(others.back());
+			}
+		}
+		if (solid->face_count() < 2)
+		{
+			// A lone plane stays as it is, but the other children may still have been rewritten
+			if (children == intersection->objects)
+				return object;
+			auto rewritten = make_shared<hittable_intersection>();
+			for (const auto& child : children)
+				rewritten->add(child);
+			return rewritten;
+		}
+		if (others.empty())
+			return simplify_solid(solid);
+
+		auto rewritten = make_shared<hittable_intersection>();
+		for (const auto& child : others)
+			rewritten->add(child);
+		rewritten->add(simplify_solid(solid));
+		return rewritten;
+	}
+	// Plain unions only, subclasses such as intersections give their children other meanings
+	auto list = std::dynamic_pointer_cast<hittable_list>(object);
+	if (list && typeid(*object) == typeid(hittable_list))
+	{
+		std::vector<shared_ptr<hittable>> children = simplify(list->objects);
+		if (children == list->objects)
+			return object;
+		auto rewritten = make_shared<hittable_list>();
+		rewritten->objects = std::move(children);
+		return rewritten;
+	}
+	return object;
+}
+
+#endif
@@ -0,0 +1,314 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef COMPRESSED_BVH_H
+#define COMPRESSED_BVH_H
+
+#include "bvh.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "stats.h"
+
+#include <cmath>
+#include <vector>
+
+/*
+ * Four-wide BVH node in one 64 byte cache line. Child boxes are stored as 8-bit offsets
+ * on a per-axis power-of-two grid anchored at the float origin of the parent box, rounded
+ * outwards so a decoded box always encloses the child.
+ */
+struct alignas(64) wide_node
+{
+	static const uint32_t leaf_flag = 0x80000000u;
+
+	float origin[3];
+	int8_t exponent[3]; // Grid step along each axis is 2^exponent
+	uint8_t child_count;
+	uint8_t lo[3][4];
+	uint8_t hi[3][4];
+	uint32_t child[4];  // Child node index, or leaf_flag | first primitive of a leaf
+	uint8_t count[4];   // Primitives in a leaf child
+	uint8_t padding[4];
+
+	bool is_leaf(int i) const { return child[i] & leaf_flag; }
+	uint32_t first(int i) const { return child[i] & ~leaf_flag; }
+
+	double step(int axis) const { return std::ldexp(1.0, exponent[axis]); }
+
+	/* Decoded box of child i, exact in double precision */
+	aabb child_box(int i) const
+	{
+		interval axes[3];
+		for (int axis = 0; axis < 3; axis++)
+			axes[axis] = interval(origin[axis] + lo[axis][i] * step(axis), origin[axis] + hi[axis][i] * step(axis));
+		return aabb(axes[0], axes[1], axes[2]);
+	}
+};
+
+static_assert(sizeof(wide_node) == 64, "wide_node must fill exactly one cache line");
+
+/*
+ * Read-only hittable container with a quantized four-wide hierarchy, for scenes whose
+ * hierarchy no longer fits in cache. Built by collapsing a binary SAH bvh_tree, with leaf
+ * objects copied into leaf order so each leaf reads one contiguous run of pointers.
+ */
+class compressed_bvh : public hittable
+{
+  public:
+	compressed_bvh(const hittable_list& list) : compressed_bvh(list.objects) {}
+
+	compressed_bvh(const std::vector<shared_ptr<hittable>>& objects) : objects(objects)
+	{
+		std::vector<aabb> boxes;
+		std::vector<uint32_t> bounded;
+		for (uint32_t i = 0; i < objects.size(); i++)
+		{
+			aabb box = objects[i]->bounding_box();
+			if (box.is_bounded())
+			{
+				bounded.push_back(i);
+				boxes.push_back(box);
+			}
+			else
+			{
+				unbounded.push_back(objects[i].get());
+			}
+		}
+		if (boxes.empty())
+			return;
+
+		bvh_tree tree;
+		tree.build(boxes);
+		bbox = tree.bounds();
+		nodes.reserve(tree.nodes.size() / 2 + 1);
+		primitives.reserve(boxes.size());
+		collapse(tree, bounded, { 0 });
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		bool hit_anything = false;
+		for (const hittable* object : unbounded)
+		{
+			if (object->hit(r, ray_t, rec))
+			{
+				hit_anything = true;
+				ray_t.max = rec.t;
+			}
+		}
+		if (nodes.empty())
+			return hit_anything;
+
+		const point3& origin = r.origin();
+		const vec3& inv_dir = r.inverse_direction();
+
+		struct entry { uint32_t child; uint32_t count; double t; };
+		entry stack[stack_size];
+		int size = 0;
+		stack[size++] = { 0, 0, ray_t.min };
+		uint64_t visits = 0, tests = 0;
+
+		while (size > 0)
+		{
+			entry current = stack[--size];
+			if (current.t > ray_t.max)
+				continue;
+
+			if (current.child & wide_node::leaf_flag)
+			{
+				uint32_t first = current.child & ~wide_node::leaf_flag;
+				tests += current.count;
+				for (uint32_t i = first; i < first + current.count; i++)
+				{
+					if (primitives[i]->hit(r, ray_t, rec))
+					{
+						hit_anything = true;
+						ray_t.max = rec.t;
+					}
+				}
+				continue;
+			}
+
+			const wide_node& node = nodes[current.child];
+			visits++;
+			double step[3] = { node.step(0), node.step(1), node.step(2) };
+			entry hits[4];
+			int hit_count = 0;
+			for (int i = 0; i < node.child_count; i++)
+			{
+				aabb box(interval(node.origin[0] + node.lo[0][i] * step[0], node.origin[0] + node.hi[0][i] * step[0]),
+						 interval(node.origin[1] + node.lo[1][i] * step[1], node.origin[1] + node.hi[1][i] * step[1]),
+						 interval(node.origin[2] + node.lo[2][i] * step[2], node.origin[2] + node.hi[2][i] * step[2]));
+				interval child_t = ray_t;
+				if (!box.hit(origin, inv_dir, child_t))
+					continue;
+
+				// Insert by descending entry distance so the nearest child is pushed last and popped first
+				entry e = { node.child[i], node.count[i], child_t.min };
+				int j = hit_count++;
+				while (j > 0 && hits[j - 1].t < e.t)
+				{
+					hits[j] = hits[j - 1];
+					j--;
+				}
+				hits[j] = e;
+			}
+			for (int i = 0; i < hit_count; i++)
+				stack[size++] = hits[i];
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+		return hit_anything;
+	}
+
+	/* Treated as the union of its objects */
+	bool volume_contains(const point3 p) const override
+	{
+		for (const hittable* object : unbounded)
+		{
+			if (object->volume_contains(p))
+				return true;
+		}
+		if (nodes.empty())
+			return false;
+
+		uint32_t stack[stack_size];
+		int size = 0;
+		stack[size++] = 0;
+		while (size > 0)
+		{
+			const wide_node& node = nodes[stack[--size]];
+			for (int i = 0; i < node.child_count; i++)
+			{
+				if (!node.child_box(i).contains(p))
+					continue;
+				if (!node.is_leaf(i))
+				{
+					stack[size++] = node.child[i];
+					continue;
+				}
+				for (uint32_t j = node.first(i); j < node.first(i) + node.count[i]; j++)
+				{
+					if (primitives[j]->volume_contains(p))
+						return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		return unbounded.empty() ? bbox : aabb::universe;
+	}
+
+	/* Bytes a traversal reads: the nodes and the leaf-ordered object pointers */
+	size_t footprint() const
+	{
+		return nodes.size() * sizeof(wide_node) + primitives.size() * sizeof(const hittable*);
+	}
+
+	size_t node_count() const { return nodes.size(); }
+
+  private:
+	static const int stack_size = 256;
+
+	std::vector<shared_ptr<hittable>> objects; // Keeps the objects alive, traversal only uses the raw pointers
+	std::vector<const hittable*> unbounded;
+	std::vector<const hittable*> primitives;   // Bounded objects in leaf order
+	std::vector<wide_node> nodes;
+	aabb bbox;
+
+	/*
+	 * Emits one wide node over the given binary nodes, first opening the interior
+	 * slot with the largest surface area until four slots are filled or only leaves remain.
+	 */
+	uint32_t collapse(const bvh_tree& tree, const std::vector<uint32_t>& bounded, std::vector<uint32_t> slots)
+	{
+		while (slots.size() < 4)
+		{
+			int widest = -1;
+			double widest_area = -1;
+			for (int i = 0; i < int(slots.size()); i++)
+			{
+				const bvh_node& candidate = tree.nodes[slots[i]];
+				if (!candidate.is_leaf() && candidate.bbox.surface_area() > widest_area)
+				{
+					widest = i;
+					widest_area = candidate.bbox.surface_area();
+				}
+			}
+			if (widest < 0)
+				break;
+			uint32_t opened = slots[widest];
+			slots[widest] = opened + 1;
+			slots.push_back(tree.nodes[opened].first);
+		}
+
+		uint32_t index = uint32_t(nodes.size());
+		nodes.push_back(wide_node());
+		aabb parent, boxes[4];
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			boxes[i] = tree.nodes[slots[i]].bbox;
+			parent = aabb(parent, boxes[i]);
+		}
+
+		wide_node node = {};
+		node.child_count = uint8_t(slots.size());
+		quantize(parent, boxes, int(slots.size()), node);
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			const bvh_node& binary = tree.nodes[slots[i]];
+			if (binary.is_leaf())
+			{
+				node.child[i] = wide_node::leaf_flag | uint32_t(primitives.size());
+				node.count[i] = uint8_t(binary.count);
+				for (uint32_t j = binary.first; j < binary.first + binary.count; j++)
+					primitives.push_back(objects[bounded[tree.indices[j]]].get());
+			}
+			else
+			{
+				node.child[i] = collapse(tree, bounded, { slots[i] + 1, binary.first });
+			}
+		}
+		nodes[index] = node; // Written last, the recursion above may have reallocated the node array
+		return index;
+	}
+
+	/* Picks each axis grid so 255 steps span the parent, then rounds child bounds outwards onto it */
+	static void quantize(const aabb& parent, const aabb* boxes, int count, wide_node& node)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const interval& range = parent.axis_interval(axis);
+			float origin = float(range.min);
+			if (origin > range.min)
+				origin = std::nextafter(origin, -std::numeric_limits<float>::infinity());
+
+			double extent = range.max - origin;
+			int exponent = extent > 0 ? std::clamp(int(std::ceil(std::log2(extent / 255))), -128, 127) : -128;
+			while (exponent < 127 && origin + 255 * std::ldexp(1.0, exponent) < range.max)
+				exponent++;
+			double step = std::ldexp(1.0, exponent);
+
+			node.origin[axis] = origin;
+			node.exponent[axis] = int8_t(exponent);
+			for (int i = 0; i < count; i++)
+			{
+				const interval& child = boxes[i].axis_interval(axis);
+				int lo = std::clamp(int(std::floor((child.min - origin) / step)), 0, 255);
+				int hi = std::clamp(int(std::ceil((child.max - origin) / step)), 0, 255);
+				while (lo > 0 && origin + lo * step > child.min)
+					lo--;
+				while (hi < 255 && origin + hi * step < child.max)
+					hi++;
+				node.lo[axis][i] = uint8_t(lo);
+				node.hi[axis][i] = uint8_t(hi);
+			}
+		}
+	}
+};
+
+#endif
@@ -7,4 +7,175 @@
 
 #include "hittable.h"
 
-#endif
\ No newline at end of file
+/* Finite right circular cone from an apex to a base disk, optionally closed by that disk */
+class cone : public hittable
+{
+  public:
+	cone(const point3& apex, const point3& base_center, double radius, shared_ptr<material> mat, bool capped = true)
+		: apex(apex), axis(unit_vector(base_center - apex)), height((base_center - apex).length()), radius(radius),
+		  mat(mat), capped(capped)
+	{
+		double slant = std::sqrt(height * height + radius * radius);
+		cos_angle = height / slant;
+		sin_angle = radius / slant;
+	}
+
+	/* Cone opening along the axis at a half-angle in degrees, cut off at the given height */
+	cone(const point3& apex, const vec3& axis, double angle, double height, shared_ptr<material> mat, bool capped = true)
+		: cone(apex, apex + height * unit_vector(axis), height * std::tan(degrees_to_radians(angle)), mat, capped) {}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		vec3 apex_to_origin = r.origin() - apex;
+		double dir_axis = dot(r.direction(), axis);
+		double origin_axis = dot(apex_to_origin, axis);
+		double cos_sqr = cos_angle * cos_angle;
+
+		// Points on the double cone satisfy dot(p - apex, axis)^2 = cos^2 |p - apex|^2
+		double a = dir_axis * dir_axis - cos_sqr * r.direction().length_squared();
+		double half_b = dir_axis * origin_axis - cos_sqr * dot(apex_to_origin, r.direction());
+		double c = origin_axis * origin_axis - cos_sqr * apex_to_origin.length_squared();
+
+		bool hit_side = false;
+		double discriminant = half_b * half_b - a * c;
+		if (discriminant >= 0 && std::fabs(a) > epsilon * epsilon)
+		{
+			double sqrtd = std::sqrt(discriminant);
+			double roots[2] = { (-half_b - sqrtd) / a, (-half_b + sqrtd) / a };
+			if (roots[0] > roots[1])
+				std::swap(roots[0], roots[1]);
+
+			// The nearer root may fall on the mirrored cone or past the base while the farther one is on the side
+			for (double t : roots)
+			{
+				double along = origin_axis + t * dir_axis;
+				if (ray_t.surrounds(t) && along >= 0 && along <= height)
+				{
+					ray_t.max = t;
+					hit_side = true;
+					break;
+				}
+			}
+		}
+		if (hit_side)
+		{
+			rec.t = ray_t.max;
+			rec.p = r.at(rec.t);
+			vec3 from_apex = rec.p - apex;
+			vec3 radial = from_apex - dot(from_apex, axis) * axis;
+			double radial_length = radial.length();
+			vec3 outward = radial_length > 0 ? (cos_angle / radial_length) * radial - sin_angle * axis : -axis;
+			rec.set_face_normal(r, outward);
+			rec.mat = mat;
+		}
+
+		if (capped && std::fabs(dir_axis) > 0)
+		{
+			double t = (height - origin_axis) / dir_axis;
+			if (ray_t.surrounds(t))
+			{
+				point3 p = r.at(t);
+				if ((p - (apex + height * axis)).length_squared() <= radius * radius)
+				{
+					rec.t = t;
+					rec.p = p;
+					rec.set_face_normal(r, axis);
+					rec.mat = mat;
+					return true;
+				}
+			}
+		}
+		return hit_side;
+	}
+
+	/* The same side and cap tests as hit for a chunk of rays at a time in SIMD lanes, part 1 marks cap hits */
+	void hit_stream(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+					std::span<const uint8_t> active, std::span<uint8_t> hits) const override
+	{
+		const double ax = axis.x(), ay = axis.y(), az = axis.z();
+		const double cos_sqr = cos_angle * cos_angle, radius_sqr = radius * radius;
+		const point3 base = apex + height * axis;
+		auto kernel = [&](const ray_lanes& l, double* nearest, uint8_t* part)
+		{
+			#pragma omp simd
+			for (int i = 0; i < ray_lanes::chunk; i++)
+			{
+				double vx = l.ox[i] - apex.x(), vy = l.oy[i] - apex.y(), vz = l.oz[i] - apex.z();
+				double dir_axis = l.dx[i] * ax + l.dy[i] * ay + l.dz[i] * az;
+				double origin_axis = vx * ax + vy * ay + vz * az;
+				double a = dir_axis * dir_axis - cos_sqr * (l.dx[i] * l.dx[i] + l.dy[i] * l.dy[i] + l.dz[i] * l.dz[i]);
+				double half_b = dir_axis * origin_axis - cos_sqr * (vx * l.dx[i] + vy * l.dy[i] + vz * l.dz[i]);
+				double c = origin_axis * origin_axis - cos_sqr * (vx * vx + vy * vy + vz * vz);
+
+				double discriminant = half_b * half_b - a * c;
+				bool real = discriminant >= 0 && std::fabs(a) > epsilon * epsilon;
+				double sqrtd = std::sqrt(real ? discriminant : 0.0);
+				double r0 = (-half_b - sqrtd) / a, r1 = (-half_b + sqrtd) / a;
+				double near_root = r0 > r1 ? r1 : r0, far_root = r0 > r1 ? r0 : r1;
+				double near_along = origin_axis + near_root * dir_axis, far_along = origin_axis + far_root * dir_axis;
+				bool near_side = l.t_min[i] < near_root && near_root < l.t_max[i] && near_along >= 0 && near_along <= height;
+				bool far_side = l.t_min[i] < far_root && far_root < l.t_max[i] && far_along >= 0 && far_along <= height;
+				double side = !real ? infinity : near_side ? near_root : far_side ? far_root : infinity;
+
+				// The cap only counts in front of the side hit
+				bool crosses = capped && std::fabs(dir_axis) > 0;
+				double t = (height - origin_axis) / (crosses ? dir_axis : 1.0);
+				double px = l.ox[i] + t * l.dx[i] - base.x(), py = l.oy[i] + t * l.dy[i] - base.y(), pz = l.oz[i] + t * l.dz[i] - base.z();
+				bool cap = crosses && l.t_min[i] < t && t < (side == infinity ? l.t_max[i] : side)
+					&& px * px + py * py + pz * pz <= radius_sqr;
+				nearest[i] = cap ? t : side;
+				part[i] = cap;
+			}
+		};
+		stream_lanes(rays, ray_t, recs, active, hits, kernel, [&](const ray& r, double t, uint8_t on_cap, hit_record& rec)
+		{
+			rec.t = t;
+			rec.p = r.at(t);
+			if (on_cap)
+			{
+				rec.set_face_normal(r, axis);
+			}
+			else
+			{
+				vec3 from_apex = rec.p - apex;
+				vec3 radial = from_apex - dot(from_apex, axis) * axis;
+				double radial_length = radial.length();
+				vec3 outward = radial_length > 0 ? (cos_angle / radial_length) * radial - sin_angle * axis : -axis;
+				rec.set_face_normal(r, outward);
+			}
+			rec.mat = mat;
+		});
+	}
+
+	// Solid between the apex and the base, open cones still enclose the same volume
+	bool volume_contains(const point3 p) const override
+	{
+		vec3 from_apex = p - apex;
+		double along = dot(from_apex, axis);
+		if (along < 0 || along > height)
+			return false;
+		double allowed = along * radius / height;
+		return (from_apex - along * axis).length_squared() <= allowed * allowed;
+	}
+
+	/* The apex together with the base disk, whose extent along each axis shrinks as the disk tilts towards it */
+	aabb bounding_box() const override
+	{
+		point3 base = apex + height * axis;
+		vec3 reach(radius * std::sqrt(std::fmax(0.0, 1 - axis.x() * axis.x())),
+				   radius * std::sqrt(std::fmax(0.0, 1 - axis.y() * axis.y())),
+				   radius * std::sqrt(std::fmax(0.0, 1 - axis.z() * axis.z())));
+		return aabb(aabb(apex, apex), aabb(base - reach, base + reach));
+	}
+
+  private:
+	point3 apex;
+	vec3 axis; // Unit vector from the apex to the base center
+	double height;
+	double radius;
+	double cos_angle, sin_angle;
+	shared_ptr<material> mat;
+	bool capped;
+};
+
+#endif
@@ -0,0 +1,206 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef CONVEX_POLYHEDRON_H
+#define CONVEX_POLYHEDRON_H
+
+#include "hittable.h"
+
+#include <mutex>
+#include <vector>
+
+/*
+ * Intersection of half-spaces dot(normal, p) <= offset, the same volume as a hittable_intersection
+ * of planes. A ray is clipped against every plane in one pass, keeping the latest entry and the
+ * earliest exit, so the cost is one dot product pair per plane instead of a test per plane plus
+ * a containment check per plane pair. Planes are stored as separate arrays so the pass vectorizes.
+ */
+class convex_polyhedron : public hittable
+{
+  public:
+	convex_polyhedron() {}
+
+	/*
+	 * Adds the half-space below a plane through the point, the normal points out of the solid.
+	 * Faces go in before the solid is first asked for its bounding box.
+	 */
+	void add(const point3& point, const vec3& normal, shared_ptr<material> mat)
+	{
+		vec3 n = unit_vector(normal);
+		nx.push_back(n.x());
+		ny.push_back(n.y());
+		nz.push_back(n.z());
+		offset.push_back(dot(n, point));
+		mats.push_back(mat);
+	}
+
+	size_t face_count() const { return offset.size(); }
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		const point3& o = r.origin();
+		const vec3& d = r.direction();
+		const double* px = nx.data(), * py = ny.data(), * pz = nz.data(), * pd = offset.data();
+		int count = int(offset.size());
+
+		// Entering planes face the ray, exiting planes face away. A parallel ray outside any plane misses
+		double enter = -infinity, exit = infinity;
+		#pragma omp simd reduction(max : enter) reduction(min : exit)
+		for (int i = 0; i < count; i++)
+		{
+			double facing = px[i] * d[0] + py[i] * d[1] + pz[i] * d[2];
+			double distance = pd[i] - (px[i] * o[0] + py[i] * o[1] + pz[i] * o[2]);
+			double t = (facing == 0) ? (distance >= 0 ? infinity : -infinity) : distance / facing;
+			enter = (facing < 0 && t > enter) ? t : enter;
+			exit = (facing >= 0 && t < exit) ? t : exit;
+		}
+		if (enter > exit)
+			return false;
+
+		// The first boundary crossing inside the ray's bounds, the exit when the ray starts inside
+		bool entering = ray_t.surrounds(enter);
+		double t = entering ? enter : exit;
+		if (!ray_t.surrounds(t))
+			return false;
+
+		int face = 0;
+		double best = infinity;
+		for (int i = 0; i < count; i++)
+		{
+			double facing = px[i] * d[0] + py[i] * d[1] + pz[i] * d[2];
+			if ((facing < 0) != entering || facing == 0)
+				continue;
+			double distance = std::fabs((pd[i] - (px[i] * o[0] + py[i] * o[1] + pz[i] * o[2])) / facing - t);
+			if (distance < best)
+			{
+				best = distance;
+				face = i;
+			}
+		}
+
+		rec.t = t;
+		rec.p = r.at(t);
+		rec.set_face_normal(r, vec3(px[face], py[face], pz[face]));
+		rec.mat = mats[face];
+		return true;
+	}
+
+	bool volume_contains(const point3 p) const override
+	{
+		for (size_t i = 0; i < offset.size(); i++)
+		{
+			if (nx[i] * p.x() + ny[i] * p.y() + nz[i] * p.z() > offset[i])
+				return false;
+		}
+		return true;
+	}
+
+	/* Computed on the first call, after the faces are in, so adding faces stays cheap */
+	aabb bounding_box() const override
+	{
+		std::call_once(bounds_computed, [this] { bbox = compute_bounds(); });
+		return bbox;
+	}
+
+	/* Whether the faces are the six sides of an axis-aligned box in one material, which a slab test handles faster */
+	bool as_axis_aligned_box(aabb& box, shared_ptr<material>& mat) const
+	{
+		if (offset.size() != 6)
+			return false;
+		double side[3][2];
+		bool seen[3][2] = {};
+		for (size_t i = 0; i < offset.size(); i++)
+		{
+			vec3 n(nx[i], ny[i], nz[i]);
+			int axis = std::fabs(n.x()) == 1 ? 0 : std::fabs(n.y()) == 1 ? 1 : std::fabs(n.z()) == 1 ? 2 : -1;
+			if (axis < 0 || mats[i] != mats[0])
+				return false;
+			int upper = n[axis] > 0;
+			if (seen[axis][upper])
+				return false;
+			seen[axis][upper] = true;
+			side[axis][upper] = upper ? offset[i] : -offset[i];
+		}
+		box = aabb(interval(side[0][0], side[0][1]), interval(side[1][0], side[1][1]), interval(side[2][0], side[2][1]));
+		mat = mats[0];
+		return !box.is_empty();
+	}
+
+  private:
+	std::vector<double> nx, ny, nz, offset;
+	std::vector<shared_ptr<material>> mats;
+	mutable aabb bbox = aabb::universe;
+	mutable std::once_flag bounds_computed;
+
+	/*
+	 * Box around the vertices when the solid is closed. It is open exactly when some direction
+	 * leaves it forever, and such a direction lies along the crossing of two planes or the normals
+	 * do not span space. An empty solid gets the empty box.
+	 */
+	aabb compute_bounds() const
+	{
+		size_t count = offset.size();
+		auto normal = [&](size_t i) { return vec3(nx[i], ny[i], nz[i]); };
+		auto escapes = [&](const vec3& direction)
+		{
+			for (size_t k = 0; k < count; k++)
+			{
+				if (dot(normal(k), direction) > 1e-9)
+					return false;
+			}
+			return true;
+		};
+
+		bool spans = false;
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t j = i + 1; j < count; j++)
+			{
+				vec3 edge = cross(normal(i), normal(j));
+				if (edge.length_squared() < 1e-18)
+					continue;
+				edge = unit_vector(edge);
+				if (escapes(edge) || escapes(-edge))
+					return aabb::universe;
+				for (size_t k = j + 1; k < count && !spans; k++)
+					spans = std::fabs(dot(edge, normal(k))) > 1e-9;
+			}
+		}
+		if (!spans)
+			return aabb::universe;
+
+		// Every vertex is where three planes meet and no other plane cuts it off
+		aabb box = aabb::empty;
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t j = i + 1; j < count; j++)
+			{
+				for (size_t k = j + 1; k < count; k++)
+				{
+					vec3 jk = cross(normal(j), normal(k));
+					double det = dot(normal(i), jk);
+					if (std::fabs(det) < 1e-12)
+						continue;
+					point3 vertex = (offset[i] * jk + offset[j] * cross(normal(k), normal(i))
+									 + offset[k] * cross(normal(i), normal(j))) / det;
+					if (contains_within(vertex, 1e-9 * (1 + vertex.length())))
+						box = aabb(box, aabb(vertex, vertex));
+				}
+			}
+		}
+		return box;
+	}
+
+	bool contains_within(const point3& p, double tolerance) const
+	{
+		for (size_t i = 0; i < offset.size(); i++)
+		{
+			if (nx[i] * p.x() + ny[i] * p.y() + nz[i] * p.z() > offset[i] + tolerance)
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,155 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef CSG_H
+#define CSG_H
+
+#include "hittable.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Boolean combination of two solids. The surface of the result is the parts of each child's
+ * surface that the operation keeps, so a hit on one child is accepted or rejected by asking
+ * the other whether it contains the point, and rejected hits are stepped past.
+ *
+ * The children's boxes are kept, so rays and points that miss a child's box never reach it.
+ * Nesting nodes builds trees where each query only descends where the boxes allow.
+ */
+class csg_node : public hittable
+{
+  protected:
+	csg_node(shared_ptr<hittable> a, shared_ptr<hittable> b)
+		: a(a), b(b), box_a(a->bounding_box()), box_b(b->bounding_box()) {}
+
+	shared_ptr<hittable> a, b;
+	aabb box_a, box_b;
+
+	bool inside_a(const point3& p) const { return box_a.contains(p) && a->volume_contains(p); }
+	bool inside_b(const point3& p) const { return box_b.contains(p) && b->volume_contains(p); }
+
+	// Where the ray is inside a child's box, only the far end narrows the search so children still see where rays start
+	static bool reaches(const aabb& box, const ray& r, interval ray_t, double& end)
+	{
+		if (!box.hit(r.origin(), r.inverse_direction(), ray_t))
+			return false;
+		end = ray_t.max;
+		return true;
+	}
+};
+
+/* Everything inside either child, without the surfaces buried inside the other */
+class csg_union : public csg_node
+{
+  public:
+	csg_union(shared_ptr<hittable> a, shared_ptr<hittable> b) : csg_node(a, b) {}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		bool hit_anything = false;
+		double end;
+		if (reaches(box_a, r, ray_t, end)
+			&& filtered_hit(*a, r, interval(ray_t.min, end), rec, [&](const hit_record& h) { return !inside_b(h.p); }))
+		{
+			hit_anything = true;
+			ray_t.max = rec.t;
+		}
+		hit_record temp;
+		if (reaches(box_b, r, ray_t, end)
+			&& filtered_hit(*b, r, interval(ray_t.min, end), temp, [&](const hit_record& h) { return !inside_a(h.p); }))
+		{
+			hit_anything = true;
+			rec = temp;
+		}
+		return hit_anything;
+	}
+
+	virtual bool volume_contains(const point3 p) const override
+	{
+		return inside_a(p) || inside_b(p);
+	}
+
+	aabb bounding_box() const override
+	{
+		return aabb(box_a, box_b);
+	}
+
+	/* Union of many solids as a balanced tree split along the longest spread of their centers, so queries cull by halves */
+	static shared_ptr<hittable> balanced(std::vector<shared_ptr<hittable>> objects)
+	{
+		if (objects.empty())
+			return nullptr;
+		return build(objects.begin(), objects.end());
+	}
+
+  private:
+	using iterator = std::vector<shared_ptr<hittable>>::iterator;
+
+	static shared_ptr<hittable> build(iterator begin, iterator end)
+	{
+		if (end - begin == 1)
+			return *begin;
+		aabb centers;
+		for (auto it = begin; it != end; it++)
+		{
+			point3 c = (*it)->bounding_box().centroid();
+			centers = aabb(centers, aabb(c, c));
+		}
+		int axis = centers.longest_axis();
+		iterator middle = begin + (end - begin) / 2;
+		std::nth_element(begin, middle, end, [axis](const shared_ptr<hittable>& x, const shared_ptr<hittable>& y)
+		{
+			return x->bounding_box().centroid()[axis] < y->bounding_box().centroid()[axis];
+		});
+		return make_shared<csg_union>(build(begin, middle), build(middle, end));
+	}
+};
+
+/*
+ * The first child with the second carved out of it. Where the cut shows, the surface is the
+ * second child's seen from inside, so its hits report the opposite face for refraction.
+ */
+class csg_difference : public csg_node
+{
+  public:
+	csg_difference(shared_ptr<hittable> a, shared_ptr<hittable> b) : csg_node(a, b) {}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		// Nothing of the result lies outside the first child
+		double end;
+		if (!reaches(box_a, r, ray_t, end))
+			return false;
+		ray_t.max = end;
+
+		bool hit_anything = false;
+		if (filtered_hit(*a, r, ray_t, rec, [&](const hit_record& h) { return !inside_b(h.p); }))
+		{
+			hit_anything = true;
+			ray_t.max = rec.t;
+		}
+		hit_record temp;
+		if (reaches(box_b, r, ray_t, end)
+			&& filtered_hit(*b, r, interval(ray_t.min, end), temp, [&](const hit_record& h) { return inside_a(h.p); }))
+		{
+			temp.front_face = !temp.front_face;
+			hit_anything = true;
+			rec = temp;
+		}
+		return hit_anything;
+	}
+
+	virtual bool volume_contains(const point3 p) const override
+	{
+		return inside_a(p) && !inside_b(p);
+	}
+
+	aabb bounding_box() const override
+	{
+		return box_a;
+	}
+};
+
+#endif
@@ -0,0 +1,631 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "camera.h"
+#include "hittable.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+using socket_handle = SOCKET;
+const socket_handle invalid_socket = INVALID_SOCKET;
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <spawn.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using socket_handle = int;
+const socket_handle invalid_socket = -1;
+extern char** environ;
+#endif
+
+/*
+ * Stream socket over TCP ("tcp:host:port", "host:port") or a Unix domain socket ("unix:/path").
+ * Move-only, closes itself.
+ */
+class net_socket
+{
+  public:
+	net_socket() {}
+	explicit net_socket(socket_handle handle) : handle(handle) {}
+	net_socket(net_socket&& other) noexcept : handle(other.handle) { other.handle = invalid_socket; }
+	net_socket& operator=(net_socket&& other) noexcept
+	{
+		if (this != &other)
+		{
+			close();
+			handle = other.handle;
+			other.handle = invalid_socket;
+		}
+		return *this;
+	}
+	net_socket(const net_socket&) = delete;
+	net_socket& operator=(const net_socket&) = delete;
+	~net_socket() { close(); }
+
+	bool valid() const { return handle != invalid_socket; }
+
+	void close()
+	{
+		if (!valid())
+			return;
+#ifdef _WIN32
+		closesocket(handle);
+#else
+		::close(handle);
+#endif
+		handle = invalid_socket;
+	}
+
+	bool send_all(const void* data, size_t size)
+	{
+		auto bytes = static_cast<const char*>(data);
+		while (size > 0)
+		{
+			auto sent = ::send(handle, bytes, int(size), send_flags);
+			if (sent <= 0)
+				return false;
+			bytes += sent;
+			size -= size_t(sent);
+		}
+		return true;
+	}
+
+	bool recv_all(void* data, size_t size)
+	{
+		auto bytes = static_cast<char*>(data);
+		while (size > 0)
+		{
+			auto received = ::recv(handle, bytes, int(size), 0);
+			if (received <= 0)
+				return false;
+			bytes += received;
+			size -= size_t(received);
+		}
+		return true;
+	}
+
+	/* Receives fail after this many seconds of silence, 0 waits forever */
+	void set_timeout(double seconds)
+	{
+#ifdef _WIN32
+		DWORD ms = DWORD(seconds * 1000);
+		setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&ms), sizeof(ms));
+#else
+		timeval tv;
+		tv.tv_sec = long(seconds);
+		tv.tv_usec = long((seconds - double(tv.tv_sec)) * 1e6);
+		setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+	}
+
+	/* Waits up to timeout seconds for a connection, returns an invalid socket if none arrived */
+	net_socket accept_connection(double timeout)
+	{
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(handle, &readable);
+		timeval tv;
+		tv.tv_sec = long(timeout);
+		tv.tv_usec = long((timeout - double(tv.tv_sec)) * 1e6);
+		if (select(int(handle) + 1, &readable, nullptr, nullptr, &tv) <= 0)
+			return net_socket();
+
+		net_socket client(::accept(handle, nullptr, nullptr));
+		client.disable_delay();
+		return client;
+	}
+
+	static net_socket listen_on(const std::string& endpoint)
+	{
+		startup();
+#ifndef _WIN32
+		if (endpoint.rfind("unix:", 0) == 0)
+		{
+			std::string path = endpoint.substr(5);
+			sockaddr_un address = unix_address(path);
+			::unlink(path.c_str());
+			net_socket server(::socket(AF_UNIX, SOCK_STREAM, 0));
+			if (!server.valid()
+				|| ::bind(server.handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+				|| ::listen(server.handle, 64) != 0)
+				return net_socket();
+			return server;
+		}
+#endif
+		std::string host, port;
+		split_tcp(endpoint, host, port);
+		addrinfo* found = resolve(host.empty() ? nullptr : host.c_str(), port, true);
+		if (found == nullptr)
+			return net_socket();
+
+		net_socket server(::socket(found->ai_family, found->ai_socktype, found->ai_protocol));
+		int reuse = 1;
+		setsockopt(server.handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+		bool ok = server.valid()
+			&& ::bind(server.handle, found->ai_addr, int(found->ai_addrlen)) == 0
+			&& ::listen(server.handle, 64) == 0;
+		freeaddrinfo(found);
+		return ok ? std::move(server) : net_socket();
+	}
+
+	static net_socket connect_to(const std::string& endpoint)
+	{
+		startup();
+#ifndef _WIN32
+		if (endpoint.rfind("unix:", 0) == 0)
+		{
+			sockaddr_un address = unix_address(endpoint.substr(5));
+			net_socket client(::socket(AF_UNIX, SOCK_STREAM, 0));
+			if (!client.valid() || ::connect(client.handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+				return net_socket();
+			return client;
+		}
+#endif
+		std::string host, port;
+		split_tcp(endpoint, host, port);
+		addrinfo* found = resolve(host.empty() ? "127.0.0.1" : host.c_str(), port, false);
+		if (found == nullptr)
+			return net_socket();
+
+		net_socket client(::socket(found->ai_family, found->ai_socktype, found->ai_protocol));
+		bool ok = client.valid() && ::connect(client.handle, found->ai_addr, int(found->ai_addrlen)) == 0;
+		freeaddrinfo(found);
+		if (!ok)
+			return net_socket();
+		client.disable_delay();
+		return client;
+	}
+
+  private:
+	socket_handle handle = invalid_socket;
+
+#ifdef MSG_NOSIGNAL
+	static const int send_flags = MSG_NOSIGNAL; // A vanished peer is an error, not a SIGPIPE
+#else
+	static const int send_flags = 0;
+#endif
+
+	static void startup()
+	{
+#ifdef _WIN32
+		static bool started = false;
+		if (!started)
+		{
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+			started = true;
+		}
+#endif
+	}
+
+	void disable_delay()
+	{
+		if (!valid())
+			return;
+		int on = 1;
+		setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+	}
+
+	/* "tcp:host:port", "host:port" or "port" */
+	static void split_tcp(std::string endpoint, std::string& host, std::string& port)
+	{
+		if (endpoint.rfind("tcp:", 0) == 0)
+			endpoint = endpoint.substr(4);
+		auto colon = endpoint.rfind(':');
+		host = (colon == std::string::npos) ? "" : endpoint.substr(0, colon);
+		port = (colon == std::string::npos) ? endpoint : endpoint.substr(colon + 1);
+	}
+
+	static addrinfo* resolve(const char* host, const std::string& port, bool passive)
+	{
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = passive ? AI_PASSIVE : 0;
+		addrinfo* found = nullptr;
+		if (getaddrinfo(host, port.c_str(), &hints, &found) != 0)
+			return nullptr;
+		return found;
+	}
+
+#ifndef _WIN32
+	static sockaddr_un unix_address(const std::string& path)
+	{
+		sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		return address;
+	}
+#endif
+};
+
+/*
+ * Wire protocol, native endianness (little-endian on every supported target):
+ * each message is a message_header followed by its payload.
+ *   hello   worker -> coordinator  uint64 scene hash
+ *   job     coordinator -> worker  render_job
+ *   result  worker -> coordinator  uint32 job id, then 3 floats per tile pixel
+ *   bye     coordinator -> worker  no payload, the worker exits
+ */
+enum class message_type : uint32_t { hello = 1, job = 2, result = 3, bye = 4 };
+
+struct message_header
+{
+	uint32_t magic = 0x57445452; // "RTDW"
+	message_type type;
+	uint32_t size; // Payload bytes
+};
+
+struct render_job
+{
+	uint32_t id;
+	camera::tile area;
+	int first_sample;
+	int sample_count;
+};
+
+inline bool send_message(net_socket& socket, message_type type, const void* payload, size_t size)
+{
+	message_header header;
+	header.type = type;
+	header.size = uint32_t(size);
+	return socket.send_all(&header, sizeof(header)) && (size == 0 || socket.send_all(payload, size));
+}
+
+inline bool recv_header(net_socket& socket, message_header& header)
+{
+	return socket.recv_all(&header, sizeof(header)) && header.magic == message_header().magic;
+}
+
+/*
+ * Splits a frame into tile x sample-range jobs, hands them to workers as they ask,
+ * and merges the returned float sums into the camera's image. A job whose worker
+ * disconnects or times out goes back on the queue for someone else.
+ */
+class render_coordinator
+{
+  public:
+	std::string endpoint = "tcp:0.0.0.0:7171";
+	int tile_size = 64;
+	int samples_per_job = 8;
+	double job_timeout = 300; // Seconds a worker may stay silent on a job before it is considered lost
+
+	int local_workers = 0;                // Worker processes to launch on this machine
+	std::vector<std::string> worker_args; // Command line of a worker process, argv[0] first, without --worker
+
+	void render(camera& cam, const hittable& scene)
+	{
+		cam.initialize();
+		scene_hash = cam.scene_hash(scene);
+		make_jobs(cam);
+
+		net_socket server = net_socket::listen_on(endpoint);
+		if (!server.valid())
+		{
+			std::cerr << "Could not listen on " << endpoint << "\n";
+			return;
+		}
+		std::clog << "Coordinating " << jobs.size() << " jobs on " << endpoint << "\n";
+		launch_local_workers();
+		bool local_only = local_workers > 0;
+		stopped = false;
+
+		std::vector<std::thread> handlers;
+		auto last_report = std::chrono::steady_clock::now();
+		while (!finished())
+		{
+			net_socket client = server.accept_connection(0.2);
+			if (client.valid())
+				handlers.emplace_back(&render_coordinator::serve_worker, this, std::move(client), std::ref(cam));
+
+			// Local workers that all exited or were rejected leave nobody to finish the jobs
+			if (local_only && active_workers == 0 && running_local_workers() == 0 && !finished())
+			{
+				std::cerr << "\nEvery local worker exited with " << jobs.size() - completed << " jobs left, giving up\n";
+				stop();
+				break;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (now - last_report > std::chrono::seconds(1))
+			{
+				std::clog << "\rJobs complete: " << completed << "/" << jobs.size()
+					<< ", workers: " << active_workers << ", reissued: " << reissued << "   " << std::flush;
+				last_report = now;
+			}
+		}
+		work_ready.notify_all();
+		for (auto& handler : handlers)
+			handler.join();
+		reap_local_workers();
+		if (stopped)
+			return;
+
+		std::clog << "\rJobs complete: " << completed << "/" << jobs.size() << ", reissued: " << reissued
+			<< "                \n";
+		cam.write_image();
+		std::clog << "Done.\n";
+	}
+
+  private:
+	std::vector<render_job> jobs;
+	std::deque<uint32_t> pending;
+	std::mutex lock;
+	std::condition_variable work_ready;
+	size_t completed = 0;
+	std::atomic<int> active_workers = 0;
+	std::atomic<int> reissued = 0;
+	uint64_t scene_hash = 0;
+	bool stopped = false; // Set under lock when the render is abandoned with jobs left
+
+#ifdef _WIN32
+	std::vector<PROCESS_INFORMATION> processes;
+#else
+	std::vector<pid_t> processes;
+#endif
+
+	bool finished()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		return completed == jobs.size();
+	}
+
+	void make_jobs(const camera& cam)
+	{
+		jobs.clear();
+		pending.clear();
+		completed = 0;
+		int per_job = samples_per_job > 0 ? samples_per_job : cam.samples_per_pixel;
+		for (int first = 0; first < cam.samples_per_pixel; first += per_job)
+		{
+			for (int y = 0; y < cam.image_height; y += tile_size)
+			{
+				for (int x = 0; x < cam.image_width; x += tile_size)
+				{
+					render_job job;
+					job.id = uint32_t(jobs.size());
+					job.area = { x, y, std::min(x + tile_size, cam.image_width), std::min(y + tile_size, cam.image_height) };
+					job.first_sample = first;
+					job.sample_count = std::min(per_job, cam.samples_per_pixel - first);
+					jobs.push_back(job);
+					pending.push_back(job.id);
+				}
+			}
+		}
+	}
+
+	/* Next job for a worker, false once every job is complete */
+	bool take_job(uint32_t& id)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		work_ready.wait(guard, [this] { return !pending.empty() || completed == jobs.size() || stopped; });
+		if (pending.empty() || stopped)
+			return false;
+		id = pending.front();
+		pending.pop_front();
+		return true;
+	}
+
+	void requeue(uint32_t id)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			pending.push_front(id);
+		}
+		reissued++;
+		work_ready.notify_one();
+	}
+
+	void serve_worker(net_socket socket, camera& cam)
+	{
+		socket.set_timeout(job_timeout);
+		message_header header;
+		uint64_t worker_hash = 0;
+		if (!recv_header(socket, header) || header.type != message_type::hello || header.size != sizeof(worker_hash)
+			|| !socket.recv_all(&worker_hash, sizeof(worker_hash)))
+			return;
+		if (worker_hash != scene_hash)
+		{
+			std::cerr << "\nRejected a worker rendering a different scene\n";
+			send_message(socket, message_type::bye, nullptr, 0);
+			return;
+		}
+
+		active_workers++;
+		std::vector<float> sums;
+		uint32_t id;
+		while (take_job(id))
+		{
+			const render_job& job = jobs[id];
+			sums.resize(3 * size_t(job.area.pixel_count()));
+
+			uint32_t result_id = 0;
+			bool ok = send_message(socket, message_type::job, &job, sizeof(job))
+				&& recv_header(socket, header)
+				&& header.type == message_type::result
+				&& header.size == sizeof(result_id) + sums.size() * sizeof(float)
+				&& socket.recv_all(&result_id, sizeof(result_id))
+				&& result_id == id
+				&& socket.recv_all(sums.data(), sums.size() * sizeof(float));
+			if (!ok)
+			{
+				requeue(id);
+				break;
+			}
+
+			std::lock_guard<std::mutex> guard(lock);
+			cam.accumulate_tile(job.area, job.sample_count, sums.data());
+			completed++;
+			if (completed == jobs.size())
+				work_ready.notify_all();
+		}
+		active_workers--;
+		send_message(socket, message_type::bye, nullptr, 0);
+	}
+
+	void launch_local_workers()
+	{
+		if (local_workers <= 0 || worker_args.empty())
+			return;
+
+		std::string connect = endpoint;
+		if (connect.rfind("unix:", 0) != 0)
+		{
+			auto colon = connect.rfind(':');
+			connect = "tcp:127.0.0.1:" + connect.substr(colon == std::string::npos ? 0 : colon + 1);
+		}
+		std::vector<std::string> args = worker_args;
+		args.push_back("--worker");
+		args.push_back(connect);
+
+#ifdef _WIN32
+		std::string command;
+		for (const auto& arg : args)
+			command += "\"" + arg + "\" ";
+		for (int i = 0; i < local_workers; i++)
+		{
+			STARTUPINFOA startup;
+			PROCESS_INFORMATION process;
+			std::memset(&startup, 0, sizeof(startup));
+			startup.cb = sizeof(startup);
+			if (CreateProcessA(nullptr, command.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &process))
+				processes.push_back(process);
+		}
+#else
+		std::vector<char*> argv;
+		for (auto& arg : args)
+			argv.push_back(arg.data());
+		argv.push_back(nullptr);
+		for (int i = 0; i < local_workers; i++)
+		{
+			pid_t pid;
+			if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) == 0)
+				processes.push_back(pid);
+			else
+				std::cerr << "Could not launch worker " << argv[0] << "\n";
+		}
+#endif
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopped = true;
+		}
+		work_ready.notify_all();
+	}
+
+	/* Local worker processes still running, the ones that exited are reaped and forgotten */
+	int running_local_workers()
+	{
+#ifdef _WIN32
+		std::erase_if(processes, [](PROCESS_INFORMATION& process)
+		{
+			if (WaitForSingleObject(process.hProcess, 0) == WAIT_TIMEOUT)
+				return false;
+			CloseHandle(process.hProcess);
+			CloseHandle(process.hThread);
+			return true;
+		});
+#else
+		std::erase_if(processes, [](pid_t pid) { return waitpid(pid, nullptr, WNOHANG) != 0; });
+#endif
+		return int(processes.size());
+	}
+
+	void reap_local_workers()
+	{
+#ifdef _WIN32
+		for (auto& process : processes)
+		{
+			WaitForSingleObject(process.hProcess, 5000);
+			CloseHandle(process.hProcess);
+			CloseHandle(process.hThread);
+		}
+#else
+		for (pid_t pid : processes)
+			waitpid(pid, nullptr, 0);
+#endif
+		processes.clear();
+	}
+};
+
+/* Connects to a coordinator and renders the jobs it hands out until told to stop */
+class render_worker
+{
+  public:
+	std::string endpoint = "tcp:127.0.0.1:7171";
+	double connect_timeout = 30; // Seconds to keep retrying while the coordinator starts up
+
+	void serve(camera& cam, const hittable& scene)
+	{
+		cam.initialize();
+		uint64_t hash = cam.scene_hash(scene);
+
+		net_socket socket;
+		auto start = std::chrono::steady_clock::now();
+		while (!(socket = net_socket::connect_to(endpoint)).valid())
+		{
+			if (std::chrono::steady_clock::now() - start > std::chrono::duration<double>(connect_timeout))
+			{
+				std::cerr << "Could not reach coordinator at " << endpoint << "\n";
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		}
+		if (!send_message(socket, message_type::hello, &hash, sizeof(hash)))
+			return;
+
+		int jobs_done = 0;
+		std::vector<float> sums;
+		message_header header;
+		render_job job;
+		while (recv_header(socket, header) && header.type == message_type::job && header.size == sizeof(job)
+			&& socket.recv_all(&job, sizeof(job)))
+		{
+			sums.resize(3 * size_t(job.area.pixel_count()));
+			cam.trace_tile(scene, job.area, job.first_sample, job.sample_count, sums.data());
+
+			message_header reply;
+			reply.type = message_type::result;
+			reply.size = uint32_t(sizeof(job.id) + sums.size() * sizeof(float));
+			if (!socket.send_all(&reply, sizeof(reply)) || !socket.send_all(&job.id, sizeof(job.id))
+				|| !socket.send_all(sums.data(), sums.size() * sizeof(float)))
+				break;
+			jobs_done++;
+		}
+		std::clog << "Worker finished " << jobs_done << " jobs.\n";
+	}
+};
+
+#endif
@@ -0,0 +1,217 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef GRID_H
+#define GRID_H
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Uniform grid over object bounds, walked cell by cell with a 3D-DDA.
+ * Builds in O(n) and beats a BVH when similar-sized objects are spread evenly.
+ * Cells store object indices in one flat array, cell i owning [cell_start[i], cell_start[i + 1]).
+ */
+class grid_accel : public hittable
+{
+  public:
+	grid_accel(const hittable_list& list, double density = 2.0) : grid_accel(list.objects, density) {}
+
+	/* density is the number of cells per object, spread over the bounds in proportion to their shape */
+	grid_accel(const std::vector<shared_ptr<hittable>>& objects, double density = 2.0)
+	{
+		std::vector<aabb> boxes;
+		for (const auto& object : objects)
+		{
+			aabb box = object->bounding_box();
+			if (box.is_bounded())
+			{
+				bounded.push_back(object);
+				boxes.push_back(box);
+				bounds = aabb(bounds, box);
+			}
+			else
+			{
+				unbounded.push_back(object);
+			}
+		}
+		if (bounded.empty())
+			return;
+
+		// Pad flat bounds so every axis has some thickness to divide
+		double pad = 1e-4 * std::max({ bounds.x.size(), bounds.y.size(), bounds.z.size(), 1e-4 });
+		bounds = aabb(bounds.x.expand(pad), bounds.y.expand(pad), bounds.z.expand(pad));
+
+		vec3 size(bounds.x.size(), bounds.y.size(), bounds.z.size());
+		double cells_per_unit = std::cbrt(density * bounded.size() / (size.x() * size.y() * size.z()));
+		for (int axis = 0; axis < 3; axis++)
+		{
+			resolution[axis] = std::clamp(int(size[axis] * cells_per_unit), 1, max_resolution);
+			cell_size[axis] = size[axis] / resolution[axis];
+			inv_cell_size[axis] = 1.0 / cell_size[axis];
+		}
+
+		// Count the cells each object overlaps, prefix sum the counts, then scatter the indices
+		size_t cells = size_t(resolution[0]) * resolution[1] * resolution[2];
+		cell_start.assign(cells + 1, 0);
+		for (const auto& box : boxes)
+			for_each_cell(box, [&](size_t cell) { cell_start[cell + 1]++; });
+		for (size_t i = 0; i < cells; i++)
+			cell_start[i + 1] += cell_start[i];
+
+		cell_items.resize(cell_start[cells]);
+		std::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+		for (uint32_t i = 0; i < boxes.size(); i++)
+			for_each_cell(boxes[i], [&](size_t cell) { cell_items[fill[cell]++] = i; });
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		bool hit_anything = false;
+		for (const auto& object : unbounded)
+		{
+			if (object->hit(r, ray_t, rec))
+			{
+				hit_anything = true;
+				ray_t.max = rec.t;
+			}
+		}
+		if (bounded.empty())
+			return hit_anything;
+
+		const point3& origin = r.origin();
+		const vec3& d = r.direction();
+		const vec3& inv_dir = r.inverse_direction();
+		interval grid_t = ray_t;
+		if (!bounds.hit(origin, inv_dir, grid_t))
+			return hit_anything;
+
+		// Set up the walk from the cell where the ray enters the grid
+		point3 entry = r.at(grid_t.min);
+		int cell[3], step[3], stop[3];
+		double next_t[3], delta_t[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double offset = entry[axis] - bounds.axis_interval(axis).min;
+			cell[axis] = std::clamp(int(offset * inv_cell_size[axis]), 0, resolution[axis] - 1);
+			if (d[axis] > 0)
+			{
+				step[axis] = 1;
+				stop[axis] = resolution[axis];
+				next_t[axis] = grid_t.min + ((cell[axis] + 1) * cell_size[axis] - offset) * inv_dir[axis];
+				delta_t[axis] = cell_size[axis] * inv_dir[axis];
+			}
+			else if (d[axis] < 0)
+			{
+				step[axis] = -1;
+				stop[axis] = -1;
+				next_t[axis] = grid_t.min + (cell[axis] * cell_size[axis] - offset) * inv_dir[axis];
+				delta_t[axis] = -cell_size[axis] * inv_dir[axis];
+			}
+			else
+			{
+				step[axis] = 0;
+				stop[axis] = -1;
+				next_t[axis] = infinity;
+				delta_t[axis] = infinity;
+			}
+		}
+
+		uint64_t visits = 0, tests = 0;
+		while (true)
+		{
+			size_t index = (size_t(cell[2]) * resolution[1] + cell[1]) * resolution[0] + cell[0];
+			visits++;
+			tests += cell_start[index + 1] - cell_start[index];
+			for (uint32_t i = cell_start[index]; i < cell_start[index + 1]; i++)
+			{
+				if (bounded[cell_items[i]]->hit(r, ray_t, rec))
+				{
+					hit_anything = true;
+					ray_t.max = rec.t;
+				}
+			}
+
+			// Objects span cells, so a hit only ends the walk once no later cell can beat it
+			int axis = (next_t[0] < next_t[1]) ? (next_t[0] < next_t[2] ? 0 : 2) : (next_t[1] < next_t[2] ? 1 : 2);
+			if (ray_t.max <= next_t[axis] || next_t[axis] > grid_t.max)
+				break;
+			cell[axis] += step[axis];
+			if (cell[axis] == stop[axis])
+				break;
+			next_t[axis] += delta_t[axis];
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+		return hit_anything;
+	}
+
+	/* Treated as the union of its objects */
+	bool volume_contains(const point3 p) const override
+	{
+		for (const auto& object : unbounded)
+		{
+			if (object->volume_contains(p))
+				return true;
+		}
+		if (bounded.empty() || !bounds.contains(p))
+			return false;
+
+		size_t index = 0;
+		for (int axis = 2; axis >= 0; axis--)
+		{
+			int c = std::clamp(int((p[axis] - bounds.axis_interval(axis).min) * inv_cell_size[axis]), 0, resolution[axis] - 1);
+			index = index * resolution[axis] + c;
+		}
+		for (uint32_t i = cell_start[index]; i < cell_start[index + 1]; i++)
+		{
+			if (bounded[cell_items[i]]->volume_contains(p))
+				return true;
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		return unbounded.empty() ? bounds : aabb::universe;
+	}
+
+	size_t cell_count() const { return cell_start.empty() ? 0 : cell_start.size() - 1; }
+	size_t reference_count() const { return cell_items.size(); }
+
+  private:
+	static const int max_resolution = 512;
+
+	std::vector<shared_ptr<hittable>> bounded;
+	std::vector<shared_ptr<hittable>> unbounded;
+	aabb bounds;
+	int resolution[3] = { 0, 0, 0 };
+	vec3 cell_size;
+	vec3 inv_cell_size;
+	std::vector<uint32_t> cell_start;
+	std::vector<uint32_t> cell_items;
+
+	template <typename cell_visit>
+	void for_each_cell(const aabb& box, cell_visit&& visit) const
+	{
+		int lo[3], hi[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const interval& range = box.axis_interval(axis);
+			double origin = bounds.axis_interval(axis).min;
+			lo[axis] = std::clamp(int((range.min - origin) * inv_cell_size[axis]), 0, resolution[axis] - 1);
+			hi[axis] = std::clamp(int((range.max - origin) * inv_cell_size[axis]), 0, resolution[axis] - 1);
+		}
+		for (int z = lo[2]; z <= hi[2]; z++)
+			for (int y = lo[1]; y <= hi[1]; y++)
+				for (int x = lo[0]; x <= hi[0]; x++)
+					visit((size_t(z) * resolution[1] + y) * resolution[0] + x);
+	}
+};
+
+#endif
@@ -5,6 +5,9 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
+#include <algorithm>
+#include <span>
+
 class material;
 
 class hit_record
@@ -14,6 +17,7 @@ class hit_record
 	vec3 normal;
 	shared_ptr<material> mat;
 	double t;
+	double u = 0, v = 0; // Surface coordinates, set by primitives that parameterize their surface
 	bool front_face;
 
 	/* Sets the hit record's normal vector, assumes normalized */
@@ -33,8 +37,146 @@ class hittable {
 
 	/* Whether or not the volume contains the point, useful for boolean geometry operations */
 	virtual bool volume_contains(const point3 p) const = 0;
+
+	/* Bounds of the surface and of any volume it encloses, the universe box when unbounded */
+	virtual aabb bounding_box() const = 0;
+
+	/* Bounds of the part inside a region, for splitting large objects across several BVH nodes */
+	virtual aabb clipped_box(const aabb& region) const
+	{
+		return aabb::intersect(bounding_box(), region);
+	}
+
+	/*
+	 * Batched hit for a stream of rays. Every ray whose active flag is set and that hits within its
+	 * bounds gets its record, its bounds narrowed to the hit and its hits flag set. Other rays are
+	 * left alone, so a stream passes through several objects in turn like a ray through a list.
+	 * Containers and simple primitives override this to amortize dispatch and test rays in SIMD
+	 * lanes, the default tests the rays one at a time.
+	 */
+	virtual void hit_stream(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+							std::span<const uint8_t> active, std::span<uint8_t> hits) const
+	{
+		hit_record rec;
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			if (active[i] && hit(rays[i], ray_t[i], rec))
+			{
+				recs[i] = rec;
+				ray_t[i].max = rec.t;
+				hits[i] = 1;
+			}
+		}
+	}
+};
+
+/* Rays of a stream copied out a chunk at a time into one array per component, for testing in SIMD lanes */
+struct ray_lanes
+{
+	static const int chunk = 8;
+
+	double ox[chunk], oy[chunk], oz[chunk];
+	double dx[chunk], dy[chunk], dz[chunk];
+	double t_min[chunk], t_max[chunk]; // Bounds of each ray, empty for inactive rays
+	int count = 0;                     // Rays loaded, the rest of the lanes are padding
+
+	void load(std::span<const ray> rays, std::span<const interval> ray_t, std::span<const uint8_t> active, size_t first)
+	{
+		count = int(std::min<size_t>(chunk, rays.size() - first));
+		for (int i = 0; i < count; i++)
+		{
+			const ray& r = rays[first + i];
+			ox[i] = r.origin().x(); oy[i] = r.origin().y(); oz[i] = r.origin().z();
+			dx[i] = r.direction().x(); dy[i] = r.direction().y(); dz[i] = r.direction().z();
+			t_min[i] = ray_t[first + i].min;
+			t_max[i] = active[first + i] ? ray_t[first + i].max : t_min[i];
+		}
+
+		// A short last chunk repeats its first ray with empty bounds, kernels always run every lane
+		for (int i = count; i < chunk; i++)
+		{
+			ox[i] = ox[0]; oy[i] = oy[0]; oz[i] = oz[0];
+			dx[i] = dx[0]; dy[i] = dy[0]; dz[i] = dz[0];
+			t_min[i] = t_max[i] = t_min[0];
+		}
+	}
 };
 
+/*
+ * hit_stream for a primitive with a lane kernel. kernel(lanes, nearest, part) writes each lane's hit
+ * distance inside its bounds, or infinity, and which part of the surface it hit. record(r, t, part, rec)
+ * then fills in the record of each hit, one ray at a time.
+ */
+template <typename lane_kernel, typename hit_recorder>
+void stream_lanes(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+				  std::span<const uint8_t> active, std::span<uint8_t> hits, lane_kernel&& kernel, hit_recorder&& record)
+{
+	ray_lanes lanes;
+	for (size_t first = 0; first < rays.size(); first += ray_lanes::chunk)
+	{
+		lanes.load(rays, ray_t, active, first);
+		double nearest[ray_lanes::chunk];
+		uint8_t part[ray_lanes::chunk] = {};
+		kernel(lanes, nearest, part);
+		for (int i = 0; i < lanes.count; i++)
+		{
+			if (nearest[i] == infinity)
+				continue;
+			size_t k = first + i;
+			record(rays[k], nearest[i], part[i], recs[k]);
+			ray_t[k].max = nearest[i];
+			hits[k] = 1;
+		}
+	}
+}
+
+/*
+ * Lets geometry give up on a ray instead of waiting, for data that is still being paged in.
+ * While the tracing thread allows it, geometry that cannot answer yet sets deferred and reports
+ * a miss, and the caller throws the result away and traces the same ray again later.
+ */
+struct ray_deferral
+{
+	bool allowed = false;  // Set by callers able to trace again later
+	bool deferred = false; // Set by geometry that gave up on a ray
+};
+
+inline thread_local ray_deferral deferral;
+
+/*
+ * How acceleration structures trace the rays of a stream that do not travel together as packets.
+ * With more than one ray in flight, each ray is taken one node further in turn, after prefetching
+ * the node it reads next, so the memory loads of one ray overlap the work of the others.
+ */
+struct ray_interleaving
+{
+	int rays = 0; // Rays each thread keeps in flight, 0 or 1 to trace them one after another
+};
+
+inline thread_local ray_interleaving interleaving;
+
+/*
+ * Nearest hit of an object in the ray's bounds that keep(rec) accepts. Rejected hits are
+ * stepped past one at a time, so boolean geometry finds the surfaces behind cut-away ones.
+ * They never reach rec, which callers may still hold an earlier hit in.
+ */
+template <typename hit_filter>
+bool filtered_hit(const hittable& object, const ray& r, interval ray_t, hit_record& rec, hit_filter&& keep)
+{
+	const int max_retries = 64; // Enough crossings for any sensible solid, and a stop for degenerate ones
+	hit_record candidate;
+	for (int attempt = 0; attempt < max_retries && object.hit(r, ray_t, candidate); attempt++)
+	{
+		if (keep(candidate))
+		{
+			rec = candidate;
+			return true;
+		}
+		ray_t.min = std::nextafter(candidate.t, infinity);
+	}
+	return false;
+}
+
 /* Solves the quadratic equation for t given an a, b, and c, returns the first hit in the ray's bounds*/
 bool solve_quadratic(const ray& ray, interval ray_bounds, hit_record& record, double a, double b, double c)
 {
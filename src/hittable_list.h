@@ -42,9 +42,31 @@ class hittable_list : public hittable
 		return hit_anything;
 	}
 
+	/* The whole stream goes through each object in turn, one call per object rather than per ray */
+	void hit_stream(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+					std::span<const uint8_t> active, std::span<uint8_t> hits) const override
+	{
+		for (const auto& object : objects)
+			object->hit_stream(rays, ray_t, recs, active, hits);
+	}
+
+	/* A list is the union of its objects */
 	virtual bool volume_contains(const point3 p) const override
 	{
-		return true;
+		for (const auto& object : objects)
+		{
+			if (object->volume_contains(p))
+				return true;
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		aabb bbox;
+		for (const auto& object : objects)
+			bbox = aabb(bbox, object->bounding_box());
+		return bbox;
 	}
 };
 
@@ -53,6 +75,7 @@ class hittable_intersection : public hittable_list
 {
 public:
 
+	/* Each child's nearest hit inside all the others, stepping past its hits that are cut away */
 	bool hit(const ray& ray, interval ray_bounds, hit_record& record) const override
 	{
 		hit_record temp_rec;
@@ -61,26 +84,32 @@ public:
 
 		for (const auto& object : objects)
 		{
-			if (object->hit(ray, interval(ray_bounds.min, closest_so_far), temp_rec))
+			auto inside_others = [&](const hit_record& rec)
 			{
-				bool intersecting = true;
-				for (const auto& object2 : objects)
+				for (const auto& other : objects)
 				{
-					if (object != object2 && !object2->volume_contains(temp_rec.p))
-						intersecting = false;
-				}
-				if (intersecting)
-				{
-					hit_anything = true;
-					closest_so_far = temp_rec.t;
-					record = temp_rec;
+					if (other != object && !other->volume_contains(rec.p))
+						return false;
 				}
+				return true;
+			};
+			if (filtered_hit(*object, ray, interval(ray_bounds.min, closest_so_far), temp_rec, inside_others))
+			{
+				hit_anything = true;
+				closest_so_far = temp_rec.t;
+				record = temp_rec;
 			}
 		}
 
 		return hit_anything;
 	}
 
+	// Hits depend on the other children, so rays go through hit one at a time rather than through the list's stream
+	void hit_stream(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+					std::span<const uint8_t> active, std::span<uint8_t> hits) const override
+	{
+		hittable::hit_stream(rays, ray_t, recs, active, hits);
+	}
 
 	virtual bool volume_contains(const point3 p) const override
 	{
@@ -92,6 +121,17 @@ public:
 		}
 		return all_contain;
 	}
+
+	/* Every child bounds the shared volume, so the overlap of their boxes does too */
+	aabb bounding_box() const override
+	{
+		if (objects.empty())
+			return aabb::empty;
+		aabb overlap = aabb::universe;
+		for (const auto& object : objects)
+			overlap = aabb::intersect(overlap, object->bounding_box());
+		return overlap;
+	}
 };
 
 #endif
\ No newline at end of file
@@ -49,6 +49,11 @@ public:
 		return dot(unit_vector(p - center), unit_vector(axis)) > cos(degrees_to_radians(angle));
 	}
 
+	aabb bounding_box() const override
+	{
+		return aabb::universe;
+	}
+
 private:
 	point3 center;
 	vec3 axis;
@@ -0,0 +1,55 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "hittable.h"
+#include "transform.h"
+
+/*
+ * Places a shared object, usually a prebuilt bvh, in the world under an affine transform.
+ * Rays move into object space on entry, so a million instances share one copy of the geometry.
+ * A bvh over instances forms the top level of a two-level hierarchy.
+ */
+class instance : public hittable
+{
+  public:
+	instance(shared_ptr<hittable> object, const affine& object_to_world, shared_ptr<material> mat = nullptr)
+		: object(object), to_object(object_to_world.inverse()), mat(mat),
+		  bbox(object_to_world.bounds(object->bounding_box())) {}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		// Directions keep their scale, so hit distances mean the same in both spaces
+		ray local(to_object.point(r.origin()), to_object.vector(r.direction()));
+		if (!object->hit(local, ray_t, rec))
+			return false;
+
+		vec3 outward = rec.front_face ? rec.normal : -rec.normal;
+		rec.p = r.at(rec.t);
+		rec.set_face_normal(r, unit_vector(to_object.transpose_vector(outward)));
+		if (mat)
+			rec.mat = mat;
+		return true;
+	}
+
+	bool volume_contains(const point3 p) const override
+	{
+		return object->volume_contains(to_object.point(p));
+	}
+
+	aabb bounding_box() const override
+	{
+		return bbox;
+	}
+
+  private:
+	shared_ptr<hittable> object;
+	affine to_object;          // World to object space, the forward transform is never needed on a hit
+	shared_ptr<material> mat;  // Replaces the object's materials when set
+	aabb bbox;
+};
+
+#endif
@@ -12,6 +12,10 @@ public:
 	interval() : min(+infinity), max(-infinity) {} // Default interval is empty.
 	interval(double min, double max) : min(min), max(max) {}
 
+	// Tightest interval enclosing both intervals
+	interval(const interval& a, const interval& b)
+		: min(a.min <= b.min ? a.min : b.min), max(a.max >= b.max ? a.max : b.max) {}
+
 	double size() const
 	{
 		return max - min;
@@ -29,6 +33,13 @@ public:
 		return min < x && x < max;
 	}
 
+	// Pads the interval by delta on both ends
+	interval expand(double delta) const
+	{
+		auto padding = delta / 2;
+		return interval(min - padding, max + padding);
+	}
+
 	double clamp(double x) const
 	{
 		if (x < min) return min;
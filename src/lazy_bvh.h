@@ -0,0 +1,304 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef LAZY_BVH_H
+#define LAZY_BVH_H
+
+#include "bvh.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * BVH that splits nodes the first time a ray reaches them, for previews of huge scenes
+ * where a full build would cost more than the few samples traced. Subtrees no ray enters
+ * stay as unsplit primitive ranges.
+ *
+ * Rendering threads build it between them without locks. The first thread to reach an
+ * unbuilt node claims it by swapping its state to building, splits it, and publishes the
+ * children with a release store. Threads arriving meanwhile yield until the split lands.
+ */
+class lazy_bvh : public hittable
+{
+  public:
+	int max_leaf_size = 4;
+
+	lazy_bvh(const hittable_list& list) : lazy_bvh(list.objects) {}
+
+	lazy_bvh(const std::vector<shared_ptr<hittable>>& objects)
+	{
+		for (const auto& object : objects)
+		{
+			aabb box = object->bounding_box();
+			if (box.is_bounded())
+			{
+				bounded.push_back(object);
+				boxes.push_back(box);
+			}
+			else
+			{
+				unbounded.push_back(object);
+			}
+		}
+		if (bounded.empty())
+			return;
+
+		centroids.resize(boxes.size());
+		indices.resize(boxes.size());
+		aabb bbox;
+		for (uint32_t i = 0; i < boxes.size(); i++)
+		{
+			centroids[i] = boxes[i].centroid();
+			indices[i] = i;
+			bbox = aabb(bbox, boxes[i]);
+		}
+
+		// A binary tree over n primitives never needs more than 2n - 1 nodes, the chunks covering them are allocated on first use
+		chunks = std::vector<std::atomic<lazy_node*>>((2 * boxes.size() >> chunk_bits) + 1);
+		lazy_node& root = node_at(0);
+		root.bbox = bbox;
+		root.begin = 0;
+		root.end = uint32_t(boxes.size());
+		node_total = 2; // Index 1 is skipped so sibling pairs never straddle a chunk
+	}
+
+	~lazy_bvh()
+	{
+		for (auto& chunk : chunks)
+			delete[] chunk.load();
+	}
+
+	lazy_bvh(const lazy_bvh&) = delete;
+	lazy_bvh& operator=(const lazy_bvh&) = delete;
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		bool hit_anything = false;
+		for (const auto& object : unbounded)
+		{
+			if (object->hit(r, ray_t, rec))
+			{
+				hit_anything = true;
+				ray_t.max = rec.t;
+			}
+		}
+		if (bounded.empty())
+			return hit_anything;
+
+		const point3& origin = r.origin();
+		const vec3& inv_dir = r.inverse_direction();
+		interval root_t = ray_t;
+		if (!node_at(0).bbox.hit(origin, inv_dir, root_t))
+			return hit_anything;
+
+		struct entry { uint32_t node; double t; };
+		entry stack[stack_size];
+		int size = 0;
+		uint32_t node = 0;
+		uint64_t visits = 0, tests = 0;
+
+		while (true)
+		{
+			visits++;
+			lazy_node& current = node_at(node);
+			if (resolve(current) == leaf)
+			{
+				tests += current.end - current.begin;
+				for (uint32_t i = current.begin; i < current.end; i++)
+				{
+					if (bounded[indices[i]]->hit(r, ray_t, rec))
+					{
+						hit_anything = true;
+						ray_t.max = rec.t;
+					}
+				}
+			}
+			else
+			{
+				uint32_t left = current.left, right = current.left + 1;
+				interval left_t = ray_t, right_t = ray_t;
+				bool hit_left = node_at(left).bbox.hit(origin, inv_dir, left_t);
+				bool hit_right = node_at(right).bbox.hit(origin, inv_dir, right_t);
+
+				if (hit_left && hit_right)
+				{
+					bool right_first = right_t.min < left_t.min;
+					stack[size++] = right_first ? entry{ left, left_t.min } : entry{ right, right_t.min };
+					node = right_first ? right : left;
+					continue;
+				}
+				if (hit_left || hit_right)
+				{
+					node = hit_left ? left : right;
+					continue;
+				}
+			}
+
+			while (size > 0 && stack[size - 1].t > ray_t.max)
+				size--;
+			if (size == 0)
+				break;
+			node = stack[--size].node;
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+		return hit_anything;
+	}
+
+	/* Treated as the union of its objects, building the nodes around the point as it goes */
+	bool volume_contains(const point3 p) const override
+	{
+		for (const auto& object : unbounded)
+		{
+			if (object->volume_contains(p))
+				return true;
+		}
+		if (bounded.empty())
+			return false;
+
+		uint32_t stack[stack_size];
+		int size = 0;
+		stack[size++] = 0;
+		while (size > 0)
+		{
+			lazy_node& current = node_at(stack[--size]);
+			if (!current.bbox.contains(p))
+				continue;
+			if (resolve(current) == leaf)
+			{
+				for (uint32_t i = current.begin; i < current.end; i++)
+				{
+					if (bounded[indices[i]]->volume_contains(p))
+						return true;
+				}
+				continue;
+			}
+			stack[size++] = current.left + 1;
+			stack[size++] = current.left;
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		if (!unbounded.empty())
+			return aabb::universe;
+		return bounded.empty() ? aabb::empty : node_at(0).bbox;
+	}
+
+	/* Nodes created so far, against the 2n - 1 of a full build */
+	size_t built_nodes() const { return node_total.load(std::memory_order_relaxed) - 1; }
+
+  private:
+	enum node_state : uint8_t { unbuilt, building, leaf, interior };
+
+	// Depth past which splits fall back to halving the range, as in bvh_tree
+	static const int median_depth = 48;
+	static const int stack_size = 128;
+	static const int chunk_bits = 12;
+
+	struct lazy_node
+	{
+		aabb bbox;
+		uint32_t begin = 0, end = 0; // Primitive range, split between the children once built
+		uint32_t left = 0;           // Left child of an interior node, the right child follows it
+		uint32_t depth = 0;
+		std::atomic<uint8_t> state{ unbuilt };
+	};
+
+	std::vector<shared_ptr<hittable>> bounded;
+	std::vector<shared_ptr<hittable>> unbounded;
+	std::vector<aabb> boxes;
+	std::vector<point3> centroids;
+
+	// Built during const traversals. A node's range is only reordered by the thread that claimed it
+	mutable std::vector<uint32_t> indices;
+	mutable std::vector<std::atomic<lazy_node*>> chunks;
+	mutable std::atomic<uint32_t> node_total{ 0 };
+
+	/* Node by index, allocating its chunk if this is the first node in it. Racing allocations keep the first */
+	lazy_node& node_at(uint32_t node) const
+	{
+		std::atomic<lazy_node*>& slot = chunks[node >> chunk_bits];
+		lazy_node* chunk = slot.load(std::memory_order_acquire);
+		if (!chunk)
+		{
+			lazy_node* fresh = new lazy_node[size_t(1) << chunk_bits];
+			if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel))
+				chunk = fresh;
+			else
+				delete[] fresh;
+		}
+		return chunk[node & ((1u << chunk_bits) - 1)];
+	}
+
+	/* The node's final state, splitting it first if no thread has yet */
+	node_state resolve(lazy_node& current) const
+	{
+		uint8_t state = current.state.load(std::memory_order_acquire);
+		if (state >= leaf)
+			return node_state(state);
+		if (state == unbuilt && current.state.compare_exchange_strong(state, building, std::memory_order_acquire))
+		{
+			node_state built = split(current);
+			current.state.store(built, std::memory_order_release);
+			return built;
+		}
+		while ((state = current.state.load(std::memory_order_acquire)) == building)
+			std::this_thread::yield();
+		return node_state(state);
+	}
+
+	node_state split(lazy_node& current) const
+	{
+		uint32_t count = current.end - current.begin;
+		if (count <= uint32_t(max_leaf_size))
+			return leaf;
+
+		uint32_t* range = indices.data() + current.begin;
+		aabb centroid_box;
+		for (uint32_t i = 0; i < count; i++)
+			centroid_box = aabb(centroid_box, aabb(centroids[range[i]], centroids[range[i]]));
+
+		uint32_t middle = (current.depth < median_depth)
+			? bvh_tree::sah_partition(range, count, boxes, centroids, current.bbox, centroid_box, max_leaf_size) : 0;
+		if (middle == count)
+			return leaf;
+		if (middle == 0)
+		{
+			int axis = centroid_box.longest_axis();
+			middle = count / 2;
+			std::nth_element(range, range + middle, range + count,
+				[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+		}
+
+		uint32_t left = node_total.fetch_add(2, std::memory_order_relaxed);
+		aabb left_box, right_box;
+		for (uint32_t i = 0; i < middle; i++)
+			left_box = aabb(left_box, boxes[range[i]]);
+		for (uint32_t i = middle; i < count; i++)
+			right_box = aabb(right_box, boxes[range[i]]);
+
+		// Children are only reachable once the caller publishes this node, so plain writes suffice
+		lazy_node& left_node = node_at(left);
+		left_node.bbox = left_box;
+		left_node.begin = current.begin;
+		left_node.end = current.begin + middle;
+		left_node.depth = current.depth + 1;
+		lazy_node& right_node = node_at(left + 1);
+		right_node.bbox = right_box;
+		right_node.begin = current.begin + middle;
+		right_node.end = current.end;
+		right_node.depth = current.depth + 1;
+		current.left = left;
+		return interior;
+	}
+};
+
+#endif
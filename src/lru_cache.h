@@ -0,0 +1,138 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/* Lookup counts of a cache, summed over its shards */
+struct cache_statistics
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	size_t resident = 0; // Entries held right now
+	size_t cost = 0;     // Their summed cost
+
+	double hit_rate() const
+	{
+		uint64_t lookups = hits + misses;
+		return lookups ? double(hits) / lookups : 0.0;
+	}
+};
+
+/*
+ * Least recently used cache of immutable values, shared by rendering threads. Keys are spread
+ * over independently locked shards, so threads looking up different keys rarely wait on each
+ * other, and each shard evicts its own least recently used entries once it holds more than its
+ * share of the capacity. Capacity is counted in whatever cost the caller gives each value.
+ *
+ * Values are handed out as shared pointers, so an entry evicted while a thread still uses it
+ * stays alive until that thread lets go.
+ */
+template <typename value>
+class lru_cache
+{
+  public:
+	lru_cache(size_t capacity, size_t shard_count = 64) : shards(shard_count)
+	{
+		shard_capacity = std::max<size_t>(1, capacity / shard_count);
+	}
+
+	/*
+	 * The value cached for key, made by make() on a miss. make runs outside the shard's lock,
+	 * so two threads missing the same key at once may both make it, the first one stored wins.
+	 * make must return a shared_ptr<const value>, cost_of gives its cost.
+	 */
+	template <typename value_maker, typename value_cost>
+	shared_ptr<const value> get(uint64_t key, value_maker&& make, value_cost&& cost_of)
+	{
+		shard& s = shard_for(key);
+		{
+			std::lock_guard<std::mutex> guard(s.lock);
+			auto found = s.index.find(key);
+			if (found != s.index.end())
+			{
+				s.hits++;
+				s.order.splice(s.order.begin(), s.order, found->second);
+				return found->second->item;
+			}
+			s.misses++;
+		}
+
+		shared_ptr<const value> made = make();
+		size_t cost = cost_of(*made);
+
+		std::lock_guard<std::mutex> guard(s.lock);
+		auto found = s.index.find(key);
+		if (found != s.index.end())
+			return found->second->item;
+		s.order.push_front(entry{ key, made, cost });
+		s.index.emplace(key, s.order.begin());
+		s.cost += cost;
+
+		// The newest entry always stays, so a value costlier than the shard's share is still usable
+		while (s.cost > shard_capacity && s.order.size() > 1)
+		{
+			entry& oldest = s.order.back();
+			s.cost -= oldest.cost;
+			s.index.erase(oldest.key);
+			s.order.pop_back();
+			s.evictions++;
+		}
+		return made;
+	}
+
+	cache_statistics statistics()
+	{
+		cache_statistics total;
+		for (shard& s : shards)
+		{
+			std::lock_guard<std::mutex> guard(s.lock);
+			total.hits += s.hits;
+			total.misses += s.misses;
+			total.evictions += s.evictions;
+			total.resident += s.order.size();
+			total.cost += s.cost;
+		}
+		return total;
+	}
+
+  private:
+	struct entry
+	{
+		uint64_t key;
+		shared_ptr<const value> item;
+		size_t cost;
+	};
+
+	// Aligned apart so threads locking neighbouring shards do not share a cache line
+	struct alignas(64) shard
+	{
+		std::mutex lock;
+		std::list<entry> order; // Most recently used first
+		std::unordered_map<uint64_t, typename std::list<entry>::iterator> index;
+		size_t cost = 0;
+		uint64_t hits = 0, misses = 0, evictions = 0;
+	};
+
+	std::vector<shard> shards;
+	size_t shard_capacity;
+
+	shard& shard_for(uint64_t key)
+	{
+		// Neighbouring keys land in different shards, rays walking a row of cells spread their locks
+		uint64_t h = key * 0x9e3779b97f4a7c15ULL;
+		return shards[(h >> 32) % shards.size()];
+	}
+};
+
+#endif
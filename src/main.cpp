@@ -11,18 +11,252 @@
 #include "sphere.h"
 #include "plane.h"
 #include "infinite_cone.h"
+#include "cone.h"
+#include "box.h"
+#include "convex_polyhedron.h"
+#include "csg.h"
+#include "mesh.h"
+#include "obj_loader.h"
+#include "ply_loader.h"
+#include "procedural.h"
+#include "sdf.h"
+#include "streamed_mesh.h"
+#include "snapshot.h"
+#include "scene_file.h"
+#include "bvh.h"
+#include "compressed_bvh.h"
+#include "lazy_bvh.h"
+#include "grid.h"
+#include "accelerator.h"
+#include "instance.h"
+#include "animation.h"
+#include "distributed.h"
+#include "bench.h"
 
 #include <omp.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 #include <windows.h>
 
+/* Render options from the command line, applied to every scene's camera */
+struct render_settings
+{
+	int samples_per_pass = 4;
+	double time_budget = 0;
+	std::string checkpoint_file = ""; // Empty writes no checkpoints, --resume alone uses image.ckpt
+	double checkpoint_interval = 60;
+	bool resume = false;
+	bool wavefront = false; // Trace whole bounces through hit_stream
+	bool reorder_rays = false; // Sort each wavefront bounce by direction and origin
+	int interleaved_rays = 0; // Rays each thread keeps in flight through a BVH
+
+	std::string scene = "intersection";
+	int frames = 48;
+	int instances = 1000000;
+	std::string mesh_file = "bench_mesh.obj"; // Model for the mesh scene and benchmark
+	size_t memory_budget_mb = 256;            // Loaded chunks allowed to the streamed scene
+	std::string snapshot_file = "";           // Written by the weekend and mesh scenes, rendered by the snapshot scene
+	std::string scene_file = "";              // Scene description rendered by the file scene
+	std::string coordinator_endpoint = ""; // Distribute the render to workers from this endpoint
+	int local_workers = 0;
+	std::string worker_endpoint = "";      // Render jobs for the coordinator at this endpoint
+	std::vector<std::string> worker_args;
+	std::string bench = "";                // Run a benchmark instead of rendering
+};
+
+render_settings settings;
+
+void render_scene(camera&, const hittable&);
 void intersection_geometry_scene(void);
 void cone_scene(void);
+void rt_one_weekend_final_scene(void);
+hittable_list rt_one_weekend_world(void);
+hittable_list rt_one_weekend_objects(void);
+void turntable_animation(void);
+void bouncing_animation(void);
+void instancing_scene(void);
+void mesh_scene(void);
+void sdf_scene(void);
+void csg_scene(void);
+void landscape_scene(void);
+void streamed_scene(void);
+void snapshot_scene(void);
+void file_scene(void);
+bool save_snapshot(const hittable_list&, const camera&);
 void csv_ray_distribution(int);
 
-int main()
+int main(int argc, char* argv[])
 {
-	//cone_scene();
-	intersection_geometry_scene();
+	settings.worker_args = { argv[0] };
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		int first = i;
+		if (arg == "--scene" && has_value)
+			settings.scene = argv[++i];
+		else if (arg == "--coordinator" && has_value)
+			settings.coordinator_endpoint = argv[++i];
+		else if (arg == "--workers" && has_value)
+			settings.local_workers = std::stoi(argv[++i]);
+		else if (arg == "--worker" && has_value)
+			settings.worker_endpoint = argv[++i];
+		else if (arg == "--frames" && has_value)
+			settings.frames = std::stoi(argv[++i]);
+		else if (arg == "--instances" && has_value)
+			settings.instances = std::stoi(argv[++i]);
+		else if (arg == "--mesh" && has_value)
+			settings.mesh_file = argv[++i];
+		else if (arg == "--memory-budget" && has_value)
+			settings.memory_budget_mb = std::stoul(argv[++i]);
+		else if (arg == "--snapshot" && has_value)
+			settings.snapshot_file = argv[++i];
+		else if (arg == "--scene-file" && has_value)
+		{
+			settings.scene_file = argv[++i];
+			settings.scene = "file";
+		}
+		else if (arg == "--bench" && has_value)
+			settings.bench = argv[++i];
+		else if (arg == "--resume")
+			settings.resume = true;
+		else if (arg == "--wavefront")
+			settings.wavefront = true;
+		else if (arg == "--reorder")
+			settings.wavefront = settings.reorder_rays = true;
+		else if (arg == "--interleave" && has_value)
+		{
+			settings.wavefront = true;
+			settings.interleaved_rays = std::stoi(argv[++i]);
+		}
+		else if (arg == "--checkpoint" && has_value)
+			settings.checkpoint_file = argv[++i];
+		else if (arg == "--checkpoint-interval" && has_value)
+			settings.checkpoint_interval = std::stod(argv[++i]);
+		else if (arg == "--spp-per-pass" && has_value)
+			settings.samples_per_pass = std::stoi(argv[++i]);
+		else if (arg == "--time-budget" && has_value)
+			settings.time_budget = std::stod(argv[++i]);
+		else
+		{
+			std::cerr << "Unknown option " << arg << "\n"
+				<< "Usage: " << argv[0] << " [--scene cone|intersection|weekend|turntable|bouncing|instances|mesh|sdf|csg|landscape|streamed|snapshot] [--scene-file file.scene]"
+				<< " [--frames n] [--instances n] [--mesh file.obj|file.ply] [--memory-budget MB] [--snapshot file]"
+				<< " [--resume] [--checkpoint file] [--checkpoint-interval seconds]"
+				<< " [--spp-per-pass n] [--time-budget seconds] [--wavefront] [--reorder] [--interleave n]"
+				<< " [--coordinator endpoint [--workers n] | --worker endpoint]"
+				<< " [--bench accel|sbvh|compressed|lazy|mesh|ply|quadric|sdf|csg|box|procedural|stream|snapshot|scene|batch|reorder|interleave]\n";
+			return 1;
+		}
+
+		// Local workers build the same scene with the same options, all but this process's role and files
+		static const std::vector<std::string> coordinator_only = { "--coordinator", "--workers", "--worker", "--bench",
+			"--resume", "--checkpoint", "--checkpoint-interval", "--time-budget" };
+		if (std::find(coordinator_only.begin(), coordinator_only.end(), arg) == coordinator_only.end())
+			settings.worker_args.insert(settings.worker_args.end(), argv + first, argv + i + 1);
+	}
+	if (settings.resume && settings.checkpoint_file.empty())
+		settings.checkpoint_file = "image.ckpt";
+
+
+	if (settings.bench == "accel")
+		accelerator_benchmark().run_all();
+	else if (settings.bench == "compressed")
+		accelerator_benchmark().compare_layouts();
+	else if (settings.bench == "lazy")
+		accelerator_benchmark().compare_lazy();
+	else if (settings.bench == "mesh")
+		accelerator_benchmark().load_mesh(settings.mesh_file);
+	else if (settings.bench == "ply")
+		accelerator_benchmark().load_ply(".");
+	else if (settings.bench == "quadric")
+		accelerator_benchmark().compare_quadrics();
+	else if (settings.bench == "sdf")
+		accelerator_benchmark().compare_marching();
+	else if (settings.bench == "csg")
+		accelerator_benchmark().compare_csg();
+	else if (settings.bench == "box")
+		accelerator_benchmark().compare_boxes();
+	else if (settings.bench == "procedural")
+		accelerator_benchmark().compare_procedural();
+	else if (settings.bench == "stream")
+		accelerator_benchmark().compare_streaming();
+	else if (settings.bench == "snapshot")
+		accelerator_benchmark().compare_snapshot();
+	else if (settings.bench == "scene")
+		accelerator_benchmark().parse_scene();
+	else if (settings.bench == "batch")
+		accelerator_benchmark().compare_batches();
+	else if (settings.bench == "reorder")
+		accelerator_benchmark().compare_reordering();
+	else if (settings.bench == "interleave")
+		accelerator_benchmark().compare_interleaving();
+	else if (settings.bench == "sbvh")
+	{
+		accelerator_benchmark bench;
+		bench.compare_splits("one weekend", rt_one_weekend_objects().objects, point3(13, 2, 3), point3(0, 0, 0), 11);
+		bench.compare_splits("boulders in a sphere field", bench.boulder_field(), point3(60, 20, 15), point3(0, 5, 0), 40);
+	}
+	else if (settings.scene == "cone")
+		cone_scene();
+	else if (settings.scene == "weekend")
+		rt_one_weekend_final_scene();
+	else if (settings.scene == "turntable")
+		turntable_animation();
+	else if (settings.scene == "bouncing")
+		bouncing_animation();
+	else if (settings.scene == "instances")
+		instancing_scene();
+	else if (settings.scene == "mesh")
+		mesh_scene();
+	else if (settings.scene == "sdf")
+		sdf_scene();
+	else if (settings.scene == "csg")
+		csg_scene();
+	else if (settings.scene == "landscape")
+		landscape_scene();
+	else if (settings.scene == "streamed")
+		streamed_scene();
+	else if (settings.scene == "snapshot")
+		snapshot_scene();
+	else if (settings.scene == "file")
+		file_scene();
+	else
+		intersection_geometry_scene();
+}
+
+/* Renders locally, or as the coordinator or a worker of a distributed render */
+void render_scene(camera& cam, const hittable& scene)
+{
+	cam.samples_per_pass = settings.samples_per_pass;
+	cam.time_budget = settings.time_budget;
+	cam.checkpoint_file = settings.checkpoint_file;
+	cam.checkpoint_interval = settings.checkpoint_interval;
+	cam.resume = settings.resume;
+	cam.wavefront = settings.wavefront;
+	cam.reorder_rays = settings.reorder_rays;
+	cam.interleaved_rays = settings.interleaved_rays;
+
+	if (!settings.worker_endpoint.empty())
+	{
+		render_worker worker;
+		worker.endpoint = settings.worker_endpoint;
+		worker.serve(cam, scene);
+	}
+	else if (!settings.coordinator_endpoint.empty())
+	{
+		render_coordinator coordinator;
+		coordinator.endpoint = settings.coordinator_endpoint;
+		coordinator.samples_per_job = settings.samples_per_pass;
+		coordinator.local_workers = settings.local_workers;
+		coordinator.worker_args = settings.worker_args;
+		coordinator.render(cam, scene);
+	}
+	else
+	{
+		cam.render(scene);
+	}
 }
 
 void cone_scene()
@@ -35,13 +269,11 @@ void cone_scene()
 	for (int i = 0; i < 3; i++)
 	{
 		double z = i * 2.1 - 2.1;
-		double angle = i * 20 + 20;
-		shared_ptr<hittable_intersection> inter = make_shared<hittable_intersection>();
+		double angle = degrees_to_radians(i * 20 + 20);
 		auto cone_mat_shiny = make_shared<lambertian>(color(0.9, 0.1, 0.1));
-		inter->add(make_shared<infinite_cone>(point3(0.0, 0.0, z), vec3(0, 1, 0), angle, cone_mat_shiny));
-		inter->add(make_shared<infinite_cone>(point3(0.0, 0.01, z), vec3(0, -1, 0), 180 - angle, cone_mat_shiny));
-		inter->add(make_shared<sphere>(point3(0.0, 1.0, z), 1.0, cone_mat_shiny));
-		scene.add(inter);
+		// Open cup whose rim touches the unit sphere around it, standing on its apex
+		double height = 2 * std::cos(angle) * std::cos(angle);
+		scene.add(make_shared<cone>(point3(0.0, 0.0, z), point3(0.0, height, z), std::sin(2 * angle), cone_mat_shiny, false));
 
 		auto mat1 = make_shared<dielectric>(1.0001);
 		scene.add(make_shared<sphere>(point3(0, 1, z), 1.001, mat1));
@@ -60,21 +292,16 @@ void cone_scene()
 
 	cam.defocus_angle = 0.0;
 	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
-	cam.render(scene);
+	render_scene(cam, scene);
 }
 
 void intersection_geometry_scene()
 {
 	hittable_list scene;
 
-	auto hill = make_shared<hittable_intersection>();
+	// Raised platform, its underside is below the ground plane
 	auto ground_mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
-	hill->add(make_shared<plane>(point3(0, 0, 3), vec3(0, 1, 0), ground_mat));
-	hill->add(make_shared<plane>(point3(0, 0, 12), vec3(0, 0, 1), ground_mat));
-	hill->add(make_shared<plane>(point3(12, 0, 0), vec3(1, 0, 0), ground_mat));
-	hill->add(make_shared<plane>(point3(0, 0, -12), vec3(0, 0, -1), ground_mat));
-	hill->add(make_shared<plane>(point3(-12, 0, 0), vec3(-1, 0, 0), ground_mat));
-	scene.add(hill);
+	scene.add(make_shared<aabb_box>(point3(-12, -2, -12), point3(12, 0, 12), ground_mat));
 
 	scene.add(make_shared<plane>(point3(0, -1, 0), vec3(0, 1, 0), ground_mat));
 
@@ -136,6 +363,8 @@ void intersection_geometry_scene()
 	auto mat3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
 	scene.add(make_shared<sphere>(point3(4, 1, 0), 1.0, mat3));
 
+	scene = hittable_list(build_accelerator(scene));
+
 	standard_camera cam;
 
 	cam.setLD();
@@ -151,10 +380,15 @@ void intersection_geometry_scene()
 
 	cam.defocus_angle = 0.0;
 	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
-	cam.render(scene);
+	render_scene(cam, scene);
 }
 
-void rt_one_weekend_final_scene() {
+hittable_list rt_one_weekend_world() {
+	return hittable_list(build_accelerator(rt_one_weekend_objects()));
+}
+
+/* The one weekend spheres without an acceleration structure */
+hittable_list rt_one_weekend_objects() {
 	hittable_list world;
 
 	auto ground_material = make_shared<lambertian>(color(0.5, 0.5, 0.5));
@@ -199,6 +433,12 @@ void rt_one_weekend_final_scene() {
 	auto material3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
 	world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
 
+	return world;
+}
+
+void rt_one_weekend_final_scene() {
+	hittable_list objects = rt_one_weekend_objects();
+
 	camera cam;
 
 	cam.image_height = 675;
@@ -214,9 +454,398 @@ void rt_one_weekend_final_scene() {
 	cam.defocus_angle = 0.6;
 	cam.focus_dist = 10.0;
 
-	cam.render(world);
+	if (save_snapshot(objects, cam))
+		return;
+	hittable_list world(build_accelerator(objects));
+	render_scene(cam, world);
+}
+
+
+/* Orbits the one weekend scene once, keeping the scene and its BVH resident across frames */
+void turntable_animation()
+{
+	auto build_start = std::chrono::steady_clock::now();
+	hittable_list world = rt_one_weekend_world();
+	double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+	standard_camera cam;
+	cam.setHD();
+	cam.samples_per_pixel = 32;
+	cam.max_depth = 20;
+	cam.defocus_angle = 0.3;
+
+	animation anim;
+	anim.frame_count = settings.frames;
+	anim.scene_build_seconds = build_seconds;
+
+	camera_path path;
+	double duration = anim.frame_count / anim.frames_per_second;
+	for (int i = 0; i <= 8; i++)
+	{
+		double angle = 2 * pi * i / 8;
+		point3 lookfrom(13 * std::cos(angle), 2.5 + 0.5 * std::sin(2 * angle), 13 * std::sin(angle));
+		path.add({ duration * i / 8, lookfrom, point3(0, 0.5, 0), 22, lookfrom.length() });
+	}
+	anim.render(cam, world, path);
 }
 
+/* Grid spheres bounce and swirl at radius-dependent speeds, so the BVH is refit every frame and rebuilt as it degrades */
+void bouncing_animation()
+{
+	auto build_start = std::chrono::steady_clock::now();
+	hittable_list world;
+	// A plane stays outside the tree, so the SAH monitor only sees the moving spheres
+	auto ground_material = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+	world.add(make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), ground_material));
+
+	struct bouncer
+	{
+		shared_ptr<sphere> ball;
+		point3 rest;
+		double phase;
+	};
+	std::vector<bouncer> bouncers;
+	for (int a = -11; a < 11; a++)
+	{
+		for (int b = -11; b < 11; b++)
+		{
+			point3 rest(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
+			auto albedo = color::random() * color::random();
+			auto ball = make_shared<sphere>(rest, 0.2, make_shared<lambertian>(albedo));
+			bouncers.push_back({ ball, rest, 2 * pi * random_double() });
+			world.add(ball);
+		}
+	}
+	auto accelerator = make_shared<bvh>(world);
+	double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+	standard_camera cam;
+	cam.setSD();
+	cam.samples_per_pixel = 16;
+	cam.max_depth = 10;
+	cam.vfov = 25;
+	cam.lookfrom = point3(13, 4, 3);
+	cam.lookat = point3(0, 0, 0);
+	cam.focus_dist = 10;
+
+	animation anim;
+	anim.frame_count = settings.frames;
+	anim.scene_build_seconds = build_seconds;
+	anim.accelerators.push_back(accelerator);
+	anim.update = [&bouncers](int, double time)
+	{
+		for (auto& b : bouncers)
+		{
+			double radius = std::sqrt(b.rest.x() * b.rest.x() + b.rest.z() * b.rest.z());
+			double angle = time * 0.8 / (1 + 0.3 * radius);
+			double height = 0.2 + 1.5 * std::fabs(std::sin(3 * time + b.phase));
+			b.ball->move_to(point3(b.rest.x() * std::cos(angle) - b.rest.z() * std::sin(angle), height,
+								   b.rest.x() * std::sin(angle) + b.rest.z() * std::cos(angle)));
+		}
+	};
+	anim.render(cam, hittable_list(accelerator), camera_path());
+}
+
+/* Scatters copies of one CSG cone cup over a plane, every copy sharing the same geometry */
+void instancing_scene()
+{
+	auto build_start = std::chrono::steady_clock::now();
+
+	// Bottom level: the cone cup of cone_scene(), built once
+	auto cup_mat = make_shared<lambertian>(color(0.9, 0.1, 0.1));
+	auto cup = make_shared<hittable_intersection>();
+	cup->add(make_shared<infinite_cone>(point3(0.0, 0.0, 0.0), vec3(0, 1, 0), 40, cup_mat));
+	cup->add(make_shared<infinite_cone>(point3(0.0, 0.01, 0.0), vec3(0, -1, 0), 140, cup_mat));
+	cup->add(make_shared<sphere>(point3(0.0, 1.0, 0.0), 1.0, cup_mat));
+
+	std::vector<shared_ptr<material>> palette;
+	for (int i = 0; i < 16; i++)
+		palette.push_back(make_shared<lambertian>(color::random(0.1, 0.9)));
+	palette.push_back(make_shared<metal>(color(0.8, 0.8, 0.8), 0.05));
+
+	// Top level: a BVH over instances, spread so the density stays constant as the count grows
+	std::vector<shared_ptr<hittable>> instances;
+	instances.reserve(settings.instances);
+	double extent = 2.0 * std::sqrt(double(settings.instances));
+	for (int i = 0; i < settings.instances; i++)
+	{
+		double scale = random_double(0.15, 0.6);
+		affine placement = affine::translation(vec3(random_double(-extent, extent), 0, random_double(-extent, extent)))
+			* affine::rotation(vec3(random_double(-0.3, 0.3), 1, random_double(-0.3, 0.3)), random_double(0, 360))
+			* affine::scaling(scale);
+		instances.push_back(make_shared<instance>(cup, placement, palette[i % palette.size()]));
+	}
+
+	hittable_list world;
+	world.add(make_shared<bvh>(instances));
+	world.add(make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+	double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+	std::clog << settings.instances << " instances built in " << build_seconds << " s, "
+		<< sizeof(instance) << " bytes per instance object plus its BVH share, one shared cone cup\n";
+
+	standard_camera cam;
+	cam.setHD();
+	cam.samples_per_pixel = 32;
+	cam.max_depth = 10;
+	cam.vfov = 40;
+	cam.lookfrom = point3(-12, 5, -12);
+	cam.lookat = point3(0, 0, 0);
+	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
+	render_scene(cam, world);
+}
+
+/* The OBJ or PLY mesh file standing on a ground plane, framed from its bounds */
+void mesh_scene()
+{
+	auto build_start = std::chrono::steady_clock::now();
+	const std::string& file = settings.mesh_file;
+	bool is_ply = file.size() >= 4 && file.compare(file.size() - 4, 4, ".ply") == 0;
+	shared_ptr<mesh_buffers> buffers = is_ply ? ply_loader::load(file) : obj_loader::load(file);
+	if (!buffers)
+		return;
+	auto mesh = make_shared<triangle_mesh>(buffers, make_shared<lambertian>(color(0.7, 0.6, 0.5)));
+	double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+	std::clog << mesh->triangle_count() << " triangles loaded and built in " << build_seconds << " s\n";
+
+	aabb box = mesh->bounding_box();
+	double size = std::fmax(box.x.size(), std::fmax(box.y.size(), box.z.size()));
+	hittable_list world;
+	world.add(mesh);
+	world.add(make_shared<plane>(point3(0, box.y.min, 0), vec3(0, 1, 0), make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+	standard_camera cam;
+	cam.setSD();
+	cam.samples_per_pixel = 32;
+	cam.max_depth = 10;
+	cam.vfov = 35;
+	cam.lookat = box.centroid();
+	cam.lookfrom = cam.lookat + size * vec3(1.6, 0.9, 1.2);
+	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
+	if (save_snapshot(world, cam))
+		return;
+	render_scene(cam, world);
+}
+
+/* Writes the scene to the --snapshot file instead of rendering it, when one was given */
+bool save_snapshot(const hittable_list& objects, const camera& cam)
+{
+	if (settings.snapshot_file.empty())
+		return false;
+	auto start = std::chrono::steady_clock::now();
+	if (scene_snapshot::write(settings.snapshot_file, objects.objects, cam))
+	{
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::clog << "Wrote " << settings.snapshot_file << " in " << seconds << " s\n";
+	}
+	return true;
+}
+
+/* A scene saved with --snapshot, mapped and rendered as it was written */
+void snapshot_scene()
+{
+	auto start = std::chrono::steady_clock::now();
+	auto snapshot = scene_snapshot::open(settings.snapshot_file);
+	if (!snapshot)
+		return;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::clog << "Opened " << snapshot->sphere_total() << " spheres and " << snapshot->triangle_total() << " triangles in "
+		<< seconds * 1e3 << " ms\n";
+
+	camera cam;
+	snapshot->configure(cam);
+	render_scene(cam, *snapshot);
+}
+
+/* A scene read from a --scene-file description, see scene_file.h and the scenes directory */
+void file_scene()
+{
+	auto start = std::chrono::steady_clock::now();
+	scene_description description;
+	if (!scene_file::load(settings.scene_file, description))
+		return;
+	double parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::clog << "Read " << description.objects.size() << " objects and " << description.material_count << " materials in "
+		<< parse_seconds * 1e3 << " ms\n";
+
+	hittable_list world(build_accelerator(description.objects));
+	camera cam;
+	description.configure(cam);
+	render_scene(cam, world);
+}
+
+/*
+ * The mesh scene's model paged in from a chunked copy, written next to it on first use, with
+ * at most --memory-budget megabytes of chunks loaded at once
+ */
+void streamed_scene()
+{
+	std::string chunks = settings.mesh_file + ".chunks";
+	if (!std::filesystem::exists(chunks))
+	{
+		const std::string& file = settings.mesh_file;
+		bool is_ply = file.size() >= 4 && file.compare(file.size() - 4, 4, ".ply") == 0;
+		shared_ptr<mesh_buffers> buffers = is_ply ? ply_loader::load(file) : obj_loader::load(file);
+		if (!buffers || !chunked_mesh_file::write(chunks, *buffers))
+			return;
+		std::clog << "Wrote " << chunks << "\n";
+	}
+	auto mesh = streamed_mesh::open(chunks, make_shared<lambertian>(color(0.7, 0.6, 0.5)), settings.memory_budget_mb << 20);
+	if (!mesh)
+		return;
+
+	aabb box = mesh->bounding_box();
+	double size = std::fmax(box.x.size(), std::fmax(box.y.size(), box.z.size()));
+	hittable_list world;
+	world.add(mesh);
+	world.add(make_shared<plane>(point3(0, box.y.min, 0), vec3(0, 1, 0), make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+	standard_camera cam;
+	cam.setSD();
+	cam.samples_per_pixel = 32;
+	cam.max_depth = 10;
+	cam.vfov = 35;
+	cam.lookat = box.centroid();
+	cam.lookfrom = cam.lookat + size * vec3(1.6, 0.9, 1.2);
+	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
+	render_scene(cam, world);
+
+	streamed_mesh::streaming_statistics stats = mesh->statistics();
+	std::clog << "Chunks: " << stats.loads << " loads of " << mesh->chunk_count() << " chunks, " << stats.evictions << " evictions, "
+		<< stats.bytes_read / 1e6 << " MB read in " << stats.read_seconds << " s, built in " << stats.build_seconds << " s, "
+		<< stats.stall_seconds << " s stalled in blocking waits\n";
+}
+
+/* Distance field shapes the analytic primitives cannot make, one of them cut by a sphere through hittable_intersection */
+void sdf_scene()
+{
+	hittable_list world;
+	world.add(make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+	auto sponge = make_shared<sdf_menger>(point3(-3, 1, 0), 1, 4);
+	world.add(make_shared<distance_field>(sponge, make_shared<metal>(color(0.8, 0.7, 0.6), 0.1)));
+
+	auto slab = make_shared<sdf_box>(point3(0, 0.5, 0), vec3(1, 0.5, 1), 0.15);
+	auto ring = make_shared<sdf_torus>(point3(0, 1.25, 0), 0.7, 0.25);
+	world.add(make_shared<distance_field>(make_shared<sdf_blend>(slab, ring, 0.4), make_shared<lambertian>(color(0.8, 0.3, 0.2))));
+
+	// Twisted about its own vertical axis, so it is built at the origin and moved by the instance
+	auto column = make_shared<sdf_twist>(make_shared<sdf_box>(point3(0, 1.25, 0), vec3(0.5, 1.25, 0.5), 0.05), 1.2);
+	world.add(make_shared<instance>(make_shared<distance_field>(column, make_shared<lambertian>(color(0.2, 0.4, 0.8))),
+		affine::translation(vec3(3, 0, 0))));
+
+	auto rippled = make_shared<sdf_displace>(make_shared<sdf_sphere>(point3(1.5, 0.8, 2.5), 0.7), 0.04, 12);
+	world.add(make_shared<distance_field>(rippled, make_shared<dielectric>(1.5)));
+
+	// A second sponge rounded off by a sphere
+	auto cut = make_shared<hittable_intersection>();
+	cut->add(make_shared<distance_field>(make_shared<sdf_menger>(point3(-1.5, 0.8, 2.5), 0.8, 3), make_shared<lambertian>(color(0.9, 0.9, 0.3))));
+	cut->add(make_shared<sphere>(point3(-1.5, 0.8, 2.5), 1.0, make_shared<lambertian>(color(0.9, 0.9, 0.3))));
+	world.add(cut);
+
+	standard_camera cam;
+	cam.setSD();
+	cam.samples_per_pixel = 64;
+	cam.max_depth = 12;
+	cam.vfov = 40;
+	cam.lookfrom = point3(2, 4, 10);
+	cam.lookat = point3(0, 1, 0);
+	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
+	render_scene(cam, world);
+}
+
+/* Unions, intersections and differences, in glass where the absence of inner surfaces shows */
+void csg_scene()
+{
+	hittable_list world;
+	world.add(make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+	// Cheese, a block with holes joined into one balanced union
+	auto cheese_mat = make_shared<lambertian>(color(0.9, 0.75, 0.3));
+	std::vector<shared_ptr<hittable>> holes;
+	for (int i = 0; i < 60; i++)
+		holes.push_back(make_shared<sphere>(point3(-3, 0.6, 0) + vec3::random(-1, 1), random_double(0.1, 0.3), cheese_mat));
+	world.add(make_shared<csg_difference>(make_shared<aabb_box>(point3(-4, 0, -1), point3(-2, 1.2, 1), cheese_mat), csg_union::balanced(holes)));
+
+	// Three overlapping glass balls that refract as one solid
+	auto glass = make_shared<dielectric>(1.5);
+	auto cluster = make_shared<csg_union>(make_shared<sphere>(point3(-0.3, 0.7, 0), 0.7, glass),
+		make_shared<csg_union>(make_shared<sphere>(point3(0.4, 0.7, 0.2), 0.7, glass), make_shared<sphere>(point3(0, 1.3, 0), 0.6, glass)));
+	world.add(cluster);
+
+	// Lens, the overlap of two large spheres
+	auto lens = make_shared<hittable_intersection>();
+	lens->add(make_shared<sphere>(point3(2.8, 1.8, -2.5), 3, glass));
+	lens->add(make_shared<sphere>(point3(2.8, 1.8, 2.5), 3, glass));
+	world.add(lens);
+
+	// Die, a rounded cube with pips carved out
+	auto ivory = make_shared<lambertian>(color(0.9, 0.9, 0.85));
+	auto rounded = make_shared<hittable_intersection>();
+	rounded->add(make_shared<aabb_box>(point3(-0.5, 0, 2), point3(0.5, 1, 3), ivory));
+	rounded->add(make_shared<sphere>(point3(0, 0.5, 2.5), 0.7, ivory));
+	std::vector<shared_ptr<hittable>> pips;
+	for (point3 pip : { point3(0, 1, 2.5), point3(-0.25, 1, 2.25), point3(0.25, 1, 2.75), point3(0.5, 0.5, 2.5),
+						point3(0.5, 0.75, 2.25), point3(0.5, 0.25, 2.75), point3(0, 0.5, 3), point3(-0.25, 0.75, 3),
+						point3(0.25, 0.25, 3) })
+		pips.push_back(make_shared<sphere>(pip, 0.1, ivory));
+	world.add(make_shared<csg_difference>(rounded, csg_union::balanced(pips)));
+
+	standard_camera cam;
+	cam.setSD();
+	cam.samples_per_pixel = 64;
+	cam.max_depth = 16;
+	cam.vfov = 40;
+	cam.lookfrom = point3(3, 4, 9);
+	cam.lookat = point3(0, 0.7, 0.5);
+	cam.focus_dist = (cam.lookat - cam.lookfrom).length();
+	render_scene(cam, world);
+}
+
+/* The final scene's small spheres, one per unit cell, generated for a field 40 km across as rays reach them */
+void landscape_scene()
+{
+	hittable_list world;
+	world.add(make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+	cell_generator scatter = [](const aabb& cell, std::vector<shared_ptr<hittable>>& objects)
+	{
+		point3 center(cell.x.min + 0.2 + 0.6 * random_double(), 0.2, cell.z.min + 0.2 + 0.6 * random_double());
+		if ((center - point3(0, 0.2, 0)).length() < 1.2 || (center - point3(-4, 0.2, 0)).length() < 1.2
+			|| (center - point3(4, 0.2, 0)).length() < 1.2)
+			return;
+
+		shared_ptr<material> sphere_material;
+		auto choose_mat = random_double();
+		if (choose_mat < 0.8)
+			sphere_material = make_shared<lambertian>(color::random() * color::random());
+		else if (choose_mat < 0.95)
+			sphere_material = make_shared<metal>(color::random(0.5, 1), random_double(0, 0.5));
+		else
+			sphere_material = make_shared<dielectric>(1.5);
+		objects.push_back(make_shared<sphere>(center, 0.2, sphere_material));
+	};
+	auto field = make_shared<procedural_field>(aabb(point3(-20000, 0, -20000), point3(20000, 0.4, 20000)), vec3(1, 0.4, 1), 2026, scatter);
+	world.add(field);
+
+	world.add(make_shared<sphere>(point3(0, 1, 0), 1.0, make_shared<dielectric>(1.5)));
+	world.add(make_shared<sphere>(point3(-4, 1, 0), 1.0, make_shared<lambertian>(color(0.4, 0.2, 0.1))));
+	world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, make_shared<metal>(color(0.7, 0.6, 0.5), 0.0)));
+
+	standard_camera cam;
+	cam.setSD();
+	cam.samples_per_pixel = 32;
+	cam.max_depth = 16;
+	cam.vfov = 20;
+	cam.lookfrom = point3(13, 2, 3);
+	cam.lookat = point3(0, 0, 0);
+	cam.focus_dist = 10.0;
+	render_scene(cam, world);
+
+	cache_statistics stats = field->statistics();
+	std::clog << "Cells: " << stats.resident << " of " << field->cell_count() << " resident, "
+		<< 100 * stats.hit_rate() << "% cache hits, " << stats.evictions << " evicted\n";
+}
 
 void begin_csv(void);
 void write_to_csv(vec3, vec3, vec3, vec3);
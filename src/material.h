@@ -7,11 +7,27 @@
 
 #include "hittable.h"
 
+// The built-in materials, for code that writes scenes out
+enum class material_kind : uint32_t { other, lambertian, metal, dielectric };
+
+struct material_description
+{
+	material_kind kind = material_kind::other;
+	color albedo;
+	double parameter = 0; // Fuzz of a metal, refractive index of a dielectric
+};
+
 class material
 {
   public:
 	virtual ~material() = default;
 
+	/* Which built-in material this is and its settings, other for materials defined elsewhere */
+	virtual material_description describe() const
+	{
+		return material_description();
+	}
+
 	virtual bool scatter(
 		const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
 	) const
@@ -38,6 +54,11 @@ public:
 		return true;
 	}
 
+	material_description describe() const override
+	{
+		return { material_kind::lambertian, albedo, 0 };
+	}
+
 private:
 	color albedo;
 };
@@ -56,6 +77,11 @@ public:
 		return true;
 	}
 
+	material_description describe() const override
+	{
+		return { material_kind::metal, albedo, fuzz };
+	}
+
 private:
 	color albedo;
 	double fuzz;
@@ -86,6 +112,12 @@ public:
 		scattered = ray(rec.p, direction);
 		return true;
 	}
+
+	material_description describe() const override
+	{
+		return { material_kind::dielectric, color(1, 1, 1), refractive_index };
+	}
+
 private:
 	// Refractive index in vacuum / air / enclosing media
 	double refractive_index;
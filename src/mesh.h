@@ -0,0 +1,257 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef MESH_H
+#define MESH_H
+
+#include "bvh.h"
+#include "hittable.h"
+
+#include <cstring>
+#include <vector>
+
+/*
+ * Vertex attributes and triangle corners shared by every triangle of a mesh. Positions and
+ * position indices are read through raw pointers and byte strides, so they can point into a
+ * loader's own vectors or straight into a mapped file whose records hold other fields too.
+ */
+struct mesh_buffers
+{
+	static const uint32_t missing = 0xffffffffu; // Corner without a normal or uv
+
+	const unsigned char* position_data = nullptr; // Three floats per vertex
+	size_t position_stride = 3 * sizeof(float);
+	size_t vertex_count = 0;
+
+	const unsigned char* index_data = nullptr;    // Three uint32 position indices per triangle
+	size_t triangle_stride = 3 * sizeof(uint32_t);
+	size_t triangle_count = 0;
+
+	// Optional attributes, indexed per corner independently of the positions as in OBJ files.
+	// Without index arrays they follow the position indices, as in PLY files
+	std::vector<float> normals, uvs;
+	std::vector<uint32_t> normal_indices, uv_indices;
+
+	// Backing storage when the data was converted rather than used in place
+	std::vector<float> position_storage;
+	std::vector<uint32_t> index_storage;
+	shared_ptr<const void> owner; // Keeps external memory, like a mapped file, alive
+
+	/* Points the position and index views at the owned storage */
+	void use_storage()
+	{
+		position_data = reinterpret_cast<const unsigned char*>(position_storage.data());
+		position_stride = 3 * sizeof(float);
+		vertex_count = position_storage.size() / 3;
+		index_data = reinterpret_cast<const unsigned char*>(index_storage.data());
+		triangle_stride = 3 * sizeof(uint32_t);
+		triangle_count = index_storage.size() / 3;
+	}
+
+	// Copied out byte-wise since mapped records need not be aligned
+	point3 position(uint32_t vertex) const
+	{
+		float xyz[3];
+		std::memcpy(xyz, position_data + vertex * position_stride, sizeof(xyz));
+		return point3(xyz[0], xyz[1], xyz[2]);
+	}
+
+	void corners(uint32_t triangle, uint32_t out[3]) const
+	{
+		std::memcpy(out, index_data + triangle * triangle_stride, 3 * sizeof(uint32_t));
+	}
+
+	/* Bytes held by the mesh itself, not counting memory it only borrows */
+	size_t owned_bytes() const
+	{
+		return (normals.size() + uvs.size() + position_storage.size()) * sizeof(float)
+			+ (normal_indices.size() + uv_indices.size() + index_storage.size()) * sizeof(uint32_t);
+	}
+};
+
+// Per-ray setup of the watertight test: the dominant axis becomes z and the ray is sheared onto it
+struct watertight_ray
+{
+	point3 origin;
+	int kx, ky, kz;
+	double sx, sy, sz;
+
+	watertight_ray(const ray& r) : origin(r.origin())
+	{
+		const vec3& d = r.direction();
+		kz = std::fabs(d.x()) > std::fabs(d.y()) ? (std::fabs(d.x()) > std::fabs(d.z()) ? 0 : 2)
+												 : (std::fabs(d.y()) > std::fabs(d.z()) ? 1 : 2);
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		if (d[kz] < 0)
+			std::swap(kx, ky); // Keeps the winding, and so the sign of the edge functions, intact
+		sx = d[kx] / d[kz];
+		sy = d[ky] / d[kz];
+		sz = 1.0 / d[kz];
+	}
+};
+
+/*
+ * Watertight test of one triangle, the distance and the barycentric weights of p1 and p2 when
+ * the ray crosses it inside ray_t
+ */
+inline bool intersect_triangle(const watertight_ray& w, const point3& p0, const point3& p1, const point3& p2,
+							   const interval& ray_t, double& t, double& b1, double& b2)
+{
+	vec3 a = p0 - w.origin;
+	vec3 b = p1 - w.origin;
+	vec3 p = p2 - w.origin;
+
+	double ax = a[w.kx] - w.sx * a[w.kz], ay = a[w.ky] - w.sy * a[w.kz];
+	double bx = b[w.kx] - w.sx * b[w.kz], by = b[w.ky] - w.sy * b[w.kz];
+	double cx = p[w.kx] - w.sx * p[w.kz], cy = p[w.ky] - w.sy * p[w.kz];
+
+	// Edge functions, a ray through an edge gives 0 for it and hits exactly one of the two sides
+	double u = cx * by - cy * bx;
+	double v = ax * cy - ay * cx;
+	double e = bx * ay - by * ax;
+	if ((u < 0 || v < 0 || e < 0) && (u > 0 || v > 0 || e > 0))
+		return false;
+	double det = u + v + e;
+	if (det == 0)
+		return false;
+
+	double scaled_t = u * (w.sz * a[w.kz]) + v * (w.sz * b[w.kz]) + e * (w.sz * p[w.kz]);
+	t = scaled_t / det;
+	if (!ray_t.surrounds(t))
+		return false;
+	b1 = v / det;
+	b2 = e / det;
+	return true;
+}
+
+/*
+ * Indexed triangle mesh with its own BVH over the triangles. Rays are intersected with the
+ * watertight test of Woop, Benthin and Wald, so rays through shared edges and vertices never slip
+ * between neighbouring triangles. Hits report barycentric or texture u, v and smooth normals when
+ * the mesh has them.
+ */
+class triangle_mesh : public hittable
+{
+  public:
+	triangle_mesh(shared_ptr<mesh_buffers> buffers, shared_ptr<material> mat) : buffers(buffers), mat(mat)
+	{
+		std::vector<aabb> boxes(buffers->triangle_count);
+		#pragma omp parallel for schedule(static)
+		for (long i = 0; i < long(boxes.size()); i++)
+		{
+			uint32_t c[3];
+			buffers->corners(uint32_t(i), c);
+			point3 a = buffers->position(c[0]), b = buffers->position(c[1]), p = buffers->position(c[2]);
+			boxes[i] = aabb(aabb(a, b), aabb(p, p));
+		}
+		tree.build(boxes);
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		watertight_ray w(r);
+		uint32_t hit_triangle = 0;
+		double hit_b1 = 0, hit_b2 = 0;
+		bool hit_anything = tree.traverse(r, ray_t, [&](uint32_t i, interval& t)
+		{
+			double b1, b2, distance;
+			if (!intersect(w, i, t, distance, b1, b2))
+				return false;
+			t.max = distance;
+			hit_triangle = i;
+			hit_b1 = b1;
+			hit_b2 = b2;
+			return true;
+		});
+		if (!hit_anything)
+			return false;
+
+		uint32_t c[3];
+		buffers->corners(hit_triangle, c);
+		point3 p0 = buffers->position(c[0]), p1 = buffers->position(c[1]), p2 = buffers->position(c[2]);
+		double b0 = 1 - hit_b1 - hit_b2;
+		vec3 geometric = unit_vector(cross(p1 - p0, p2 - p0));
+
+		rec.t = ray_t.max;
+		rec.p = r.at(rec.t);
+		rec.mat = mat;
+		rec.u = hit_b1;
+		rec.v = hit_b2;
+
+		size_t corner = size_t(hit_triangle) * 3;
+		const uint32_t* uv = buffers->uv_indices.empty() ? c : &buffers->uv_indices[corner];
+		if (!buffers->uvs.empty() && uv[0] != mesh_buffers::missing)
+		{
+			rec.u = b0 * buffers->uvs[2 * uv[0]] + hit_b1 * buffers->uvs[2 * uv[1]] + hit_b2 * buffers->uvs[2 * uv[2]];
+			rec.v = b0 * buffers->uvs[2 * uv[0] + 1] + hit_b1 * buffers->uvs[2 * uv[1] + 1] + hit_b2 * buffers->uvs[2 * uv[2] + 1];
+		}
+
+		// Facing comes from the true surface, the shading normal only bends the light
+		vec3 shading = geometric;
+		const uint32_t* n = buffers->normal_indices.empty() ? c : &buffers->normal_indices[corner];
+		if (!buffers->normals.empty() && n[0] != mesh_buffers::missing)
+		{
+			auto normal = [&](uint32_t k) { return vec3(buffers->normals[3 * k], buffers->normals[3 * k + 1], buffers->normals[3 * k + 2]); };
+			vec3 blended = b0 * normal(n[0]) + hit_b1 * normal(n[1]) + hit_b2 * normal(n[2]);
+			if (blended.length_squared() > 0)
+				shading = unit_vector(blended);
+			if (dot(shading, geometric) < 0)
+				shading = -shading;
+		}
+		rec.front_face = dot(r.direction(), geometric) < 0;
+		rec.normal = rec.front_face ? shading : -shading;
+		return true;
+	}
+
+	/* Even-odd count of the crossings along a ray, the mesh has to be closed for this to mean anything */
+	bool volume_contains(const point3 p) const override
+	{
+		if (!tree.bounds().contains(p))
+			return false;
+		ray probe(p, vec3(0.5773, 0.5774, 0.5775));
+		watertight_ray w(probe);
+		interval t(0, infinity);
+		int crossings = 0;
+		tree.traverse(probe, t, [&](uint32_t i, interval& range)
+		{
+			double b1, b2, distance;
+			if (intersect(w, i, range, distance, b1, b2))
+				crossings++;
+			return false;
+		});
+		return crossings % 2 == 1;
+	}
+
+	aabb bounding_box() const override
+	{
+		return tree.bounds();
+	}
+
+	size_t triangle_count() const { return buffers->triangle_count; }
+	const mesh_buffers& geometry() const { return *buffers; }
+	const shared_ptr<material>& surface_material() const { return mat; }
+
+	/* Bytes of the mesh's own buffers and hierarchy */
+	size_t memory_bytes() const
+	{
+		return buffers->owned_bytes() + tree.nodes.size() * sizeof(bvh_node) + tree.indices.size() * sizeof(uint32_t);
+	}
+
+  private:
+	shared_ptr<mesh_buffers> buffers;
+	shared_ptr<material> mat;
+	bvh_tree tree;
+
+	bool intersect(const watertight_ray& w, uint32_t triangle, const interval& ray_t,
+				   double& t, double& b1, double& b2) const
+	{
+		uint32_t c[3];
+		buffers->corners(triangle, c);
+		return intersect_triangle(w, buffers->position(c[0]), buffers->position(c[1]), buffers->position(c[2]),
+								  ray_t, t, b1, b2);
+	}
+};
+
+#endif
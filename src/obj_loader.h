@@ -0,0 +1,309 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "mesh.h"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Wavefront OBJ reader for the geometry of a single mesh: v, vt, vn and f lines, with polygons
+ * fanned into triangles. Groups, objects and materials are skipped.
+ *
+ * The file is cut into chunks at line breaks and read in two parallel passes. The first counts
+ * each chunk's records, which fixes where every chunk writes and what negative indices refer to,
+ * so the second pass parses straight into the final arrays without any per-triangle allocation.
+ */
+class obj_loader
+{
+  public:
+	/* The mesh in the file, or nullptr after printing why it could not be read */
+	static shared_ptr<mesh_buffers> load(const std::string& filename)
+	{
+		std::ifstream in(filename, std::ios::binary | std::ios::ate);
+		if (!in)
+		{
+			std::cerr << "Could not open " << filename << "\n";
+			return nullptr;
+		}
+		std::string text(size_t(in.tellg()), '\0');
+		in.seekg(0);
+		in.read(text.data(), text.size());
+		if (!in)
+		{
+			std::cerr << "Could not read " << filename << "\n";
+			return nullptr;
+		}
+		return parse(text.data(), text.data() + text.size(), filename);
+	}
+
+	static shared_ptr<mesh_buffers> parse(const char* begin, const char* end, const std::string& name = "obj")
+	{
+		std::vector<chunk> chunks;
+		for (const char* p = begin; p < end;)
+		{
+			const char* stop = p + std::min<size_t>(chunk_size, end - p);
+			while (stop < end && *(stop - 1) != '\n')
+				stop++;
+			chunk c;
+			c.begin = p;
+			c.end = stop;
+			chunks.push_back(c);
+			p = stop;
+		}
+
+		#pragma omp parallel for schedule(dynamic)
+		for (long i = 0; i < long(chunks.size()); i++)
+			count(chunks[i]);
+
+		// Running totals turn each chunk's counts into its first slot in every array
+		chunk total;
+		for (chunk& c : chunks)
+		{
+			chunk local = c;
+			c.vertices = total.vertices;
+			c.uvs = total.uvs;
+			c.normals = total.normals;
+			c.triangles = total.triangles;
+			c.lines = total.lines;
+			total.vertices += local.vertices;
+			total.uvs += local.uvs;
+			total.normals += local.normals;
+			total.triangles += local.triangles;
+			total.lines += local.lines;
+		}
+		if (total.vertices >= mesh_buffers::missing || total.triangles * 3 >= mesh_buffers::missing)
+		{
+			std::cerr << name << ": too large for 32-bit indices\n";
+			return nullptr;
+		}
+
+		auto mesh = make_shared<mesh_buffers>();
+		mesh->position_storage.resize(3 * total.vertices);
+		mesh->index_storage.resize(3 * total.triangles);
+		mesh->uvs.resize(2 * total.uvs);
+		mesh->normals.resize(3 * total.normals);
+		if (total.uvs > 0)
+			mesh->uv_indices.resize(3 * total.triangles);
+		if (total.normals > 0)
+			mesh->normal_indices.resize(3 * total.triangles);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (long i = 0; i < long(chunks.size()); i++)
+			fill(chunks[i], total, *mesh);
+
+		for (const chunk& c : chunks)
+		{
+			if (!c.error.empty())
+			{
+				std::cerr << name << ":" << c.error_line << ": " << c.error << "\n";
+				return nullptr;
+			}
+		}
+		mesh->use_storage();
+		return mesh;
+	}
+
+  private:
+	static const size_t chunk_size = size_t(1) << 20;
+
+	struct chunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		size_t vertices = 0, uvs = 0, normals = 0, triangles = 0, lines = 0;
+		std::string error;
+		size_t error_line = 0;
+	};
+
+	static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	static const char* skip_space(const char* p, const char* end)
+	{
+		while (p < end && is_space(*p))
+			p++;
+		return p;
+	}
+
+	static const char* line_end(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n')
+			p++;
+		return p;
+	}
+
+	// Record keyword at the start of a line, 0 when the line holds nothing this reader uses
+	static char keyword(const char*& p, const char* end)
+	{
+		p = skip_space(p, end);
+		if (end - p < 2)
+			return 0;
+		char kind = 0;
+		if (p[0] == 'f' && is_space(p[1]))
+			kind = 'f';
+		else if (p[0] == 'v' && is_space(p[1]))
+			kind = 'v';
+		else if (end - p >= 3 && p[0] == 'v' && (p[1] == 't' || p[1] == 'n') && is_space(p[2]))
+			kind = p[1];
+		if (kind)
+			p += kind == 'f' || kind == 'v' ? 1 : 2;
+		return kind;
+	}
+
+	static void count(chunk& c)
+	{
+		for (const char* p = c.begin; p < c.end;)
+		{
+			const char* stop = line_end(p, c.end);
+			switch (keyword(p, stop))
+			{
+			case 'v': c.vertices++; break;
+			case 't': c.uvs++; break;
+			case 'n': c.normals++; break;
+			case 'f':
+			{
+				size_t corners = 0;
+				for (p = skip_space(p, stop); p < stop; p = skip_space(p, stop))
+				{
+					corners++;
+					while (p < stop && !is_space(*p))
+						p++;
+				}
+				c.triangles += corners > 2 ? corners - 2 : 0;
+				break;
+			}
+			}
+			c.lines++;
+			p = stop + 1;
+		}
+	}
+
+	static void fill(chunk& c, const chunk& total, mesh_buffers& mesh)
+	{
+		size_t vertex = c.vertices, uv = c.uvs, normal = c.normals, triangle = c.triangles, line = c.lines;
+		auto fail = [&](const char* message)
+		{
+			c.error = message;
+			c.error_line = line + 1;
+		};
+
+		for (const char* p = c.begin; p < c.end && c.error.empty(); line++)
+		{
+			const char* stop = line_end(p, c.end);
+			switch (keyword(p, stop))
+			{
+			case 'v':
+				if (!read_floats(p, stop, &mesh.position_storage[3 * vertex++], 3, 3))
+					fail("expected three vertex coordinates");
+				break;
+			case 't':
+				if (!read_floats(p, stop, &mesh.uvs[2 * uv++], 2, 1))
+					fail("expected texture coordinates");
+				break;
+			case 'n':
+				if (!read_floats(p, stop, &mesh.normals[3 * normal++], 3, 3))
+					fail("expected three normal components");
+				break;
+			case 'f':
+			{
+				// Fan around the first corner, keeping only it and the previous corner
+				uint32_t first[3], previous[3], current[3];
+				int corners = 0;
+				for (p = skip_space(p, stop); p < stop && c.error.empty(); p = skip_space(p, stop))
+				{
+					if (!read_corner(p, stop, vertex, uv, normal, total, current))
+					{
+						fail("bad face corner");
+						break;
+					}
+					if (corners == 0)
+						std::copy(current, current + 3, first);
+					else if (corners >= 2)
+					{
+						size_t slot = 3 * triangle++;
+						const uint32_t* fan[3] = { first, previous, current };
+						// An attribute missing at any corner is dropped for the whole triangle
+						bool has_uv = fan[0][1] != mesh_buffers::missing && fan[1][1] != mesh_buffers::missing
+							&& fan[2][1] != mesh_buffers::missing;
+						bool has_normal = fan[0][2] != mesh_buffers::missing && fan[1][2] != mesh_buffers::missing
+							&& fan[2][2] != mesh_buffers::missing;
+						for (int k = 0; k < 3; k++)
+						{
+							mesh.index_storage[slot + k] = fan[k][0];
+							if (!mesh.uv_indices.empty())
+								mesh.uv_indices[slot + k] = has_uv ? fan[k][1] : mesh_buffers::missing;
+							if (!mesh.normal_indices.empty())
+								mesh.normal_indices[slot + k] = has_normal ? fan[k][2] : mesh_buffers::missing;
+						}
+					}
+					std::copy(current, current + 3, previous);
+					corners++;
+				}
+				break;
+			}
+			}
+			p = stop + 1;
+		}
+	}
+
+	/* Reads up to count floats, at least required of them, zeroing the rest */
+	static bool read_floats(const char*& p, const char* end, float* out, int count, int required)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			p = skip_space(p, end);
+			auto [next, error] = std::from_chars(p, end, out[i]);
+			if (error != std::errc())
+			{
+				if (i < required)
+					return false;
+				std::fill(out + i, out + count, 0.0f);
+				return true;
+			}
+			p = next;
+		}
+		return true;
+	}
+
+	/*
+	 * One v, v/vt, v//vn or v/vt/vn corner as zero-based position, uv and normal indices. Negative
+	 * indices count back from the records read so far, which are given by the seen counts.
+	 */
+	static bool read_corner(const char*& p, const char* end, size_t vertices_seen, size_t uvs_seen,
+							size_t normals_seen, const chunk& total, uint32_t out[3])
+	{
+		out[1] = out[2] = mesh_buffers::missing;
+		size_t seen[3] = { vertices_seen, uvs_seen, normals_seen };
+		size_t limit[3] = { total.vertices, total.uvs, total.normals };
+		for (int field = 0; field < 3; field++)
+		{
+			if (field > 0)
+			{
+				if (p >= end || *p != '/')
+					break;
+				p++;
+				if (p < end && *p == '/')
+					continue; // Empty texture slot in v//vn
+			}
+			long long index;
+			auto [next, error] = std::from_chars(p, end, index);
+			if (error != std::errc() || index == 0)
+				return false;
+			p = next;
+			long long resolved = index > 0 ? index - 1 : (long long)(seen[field]) + index;
+			if (resolved < 0 || resolved >= (long long)(limit[field]))
+				return false;
+			out[field] = uint32_t(resolved);
+		}
+		return p >= end || is_space(*p);
+	}
+};
+
+#endif
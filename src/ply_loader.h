@@ -0,0 +1,474 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef PLY_LOADER_H
+#define PLY_LOADER_H
+
+#include "mapped_file.h"
+#include "mesh.h"
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Binary little-endian PLY reader. The file is mapped rather than read, and when its records
+ * already hold what mesh_buffers expects, float x y z vertices and triangles stored as a list of
+ * 32-bit indices, the mesh points straight into the mapping and nothing is copied. Faces are only
+ * checked in one parallel pass that every list holds three indices in range.
+ *
+ * Any other layout, doubles, 16-bit indices, quads, is converted into owned arrays. Vertex
+ * records have a fixed size so they convert in parallel. Face records can vary, so a quick scan
+ * of their list counts first marks where every block of faces starts and how many triangles it
+ * fans into, and the blocks then convert in parallel.
+ */
+class ply_loader
+{
+  public:
+	/* The mesh in the file, or nullptr after printing why it could not be read */
+	static shared_ptr<mesh_buffers> load(const std::string& filename)
+	{
+		auto file = make_shared<mapped_file>(filename);
+		if (!file->valid())
+		{
+			std::cerr << "Could not open " << filename << "\n";
+			return nullptr;
+		}
+
+		std::vector<element> elements;
+		size_t offset = 0;
+		std::string error = read_header(*file, elements, offset);
+		if (!error.empty())
+		{
+			std::cerr << filename << ": " << error << "\n";
+			return nullptr;
+		}
+
+		auto mesh = make_shared<mesh_buffers>();
+		mesh->owner = file;
+		const element* vertices = nullptr;
+		for (const element& e : elements)
+		{
+			if (e.name == "vertex")
+			{
+				error = read_vertices(*file, e, offset, *mesh);
+				vertices = &e;
+			}
+			else if (e.name == "face")
+				error = vertices ? read_faces(*file, e, offset, *mesh) : "faces come before the vertices";
+			else
+				error = skip(*file, e, offset);
+			if (!error.empty())
+			{
+				std::cerr << filename << ": " << error << "\n";
+				return nullptr;
+			}
+		}
+		if (!vertices)
+		{
+			std::cerr << filename << ": no vertex element\n";
+			return nullptr;
+		}
+		return mesh;
+	}
+
+	/* Whether the last load used the file's vertex and face records in place */
+	static bool zero_copy(const mesh_buffers& mesh)
+	{
+		return mesh.position_storage.empty() && mesh.index_storage.empty();
+	}
+
+  private:
+	enum scalar_type { int8, uint8, int16, uint16, int32, uint32, float32, float64, unknown };
+
+	// Faces per block in the converting pass over variable-size face records
+	static const size_t face_block = 4096;
+
+	struct property
+	{
+		std::string name;
+		scalar_type type = unknown;
+		scalar_type count_type = unknown; // Set for list properties, which are a count then that many items
+		size_t offset = 0;                // Byte offset within a fixed-size record
+	};
+
+	struct element
+	{
+		std::string name;
+		size_t count = 0;
+		std::vector<property> properties;
+		size_t record_size = 0; // 0 when the element has list properties
+
+		const property* find(std::initializer_list<const char*> names) const
+		{
+			for (const char* name : names)
+			{
+				for (const property& p : properties)
+				{
+					if (p.name == name)
+						return &p;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	static size_t type_size(scalar_type type)
+	{
+		static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+		return sizes[type];
+	}
+
+	static scalar_type parse_type(const std::string& name)
+	{
+		static const char* names[][2] = {
+			{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+			{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" } };
+		for (int i = 0; i < 8; i++)
+		{
+			if (name == names[i][0] || name == names[i][1])
+				return scalar_type(i);
+		}
+		return unknown;
+	}
+
+	// Values are copied out byte-wise since records are packed without alignment
+	static double read_scalar(const unsigned char* p, scalar_type type)
+	{
+		switch (type)
+		{
+		case int8: return double(int8_t(*p));
+		case uint8: return double(*p);
+		case int16: { int16_t v; std::memcpy(&v, p, 2); return v; }
+		case uint16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+		case int32: { int32_t v; std::memcpy(&v, p, 4); return v; }
+		case uint32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+		case float32: { float v; std::memcpy(&v, p, 4); return v; }
+		case float64: { double v; std::memcpy(&v, p, 8); return v; }
+		default: return 0;
+		}
+	}
+
+	// Integers read as 64 bits so negative and oversized indices both fail the range check
+	static int64_t read_integer(const unsigned char* p, scalar_type type)
+	{
+		switch (type)
+		{
+		case int8: return int8_t(*p);
+		case uint8: return *p;
+		case int16: { int16_t v; std::memcpy(&v, p, 2); return v; }
+		case uint16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+		case int32: { int32_t v; std::memcpy(&v, p, 4); return v; }
+		case uint32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+		default: return -1;
+		}
+	}
+
+	/* Parses the text header, leaving offset at the first data byte. Returns an error message or "" */
+	static std::string read_header(const mapped_file& file, std::vector<element>& elements, size_t& offset)
+	{
+		const char* text = reinterpret_cast<const char*>(file.data());
+		const char* marker = "end_header";
+		const char* end = nullptr;
+		for (size_t i = 0; i + 10 < file.size() && i < (1 << 20); i++)
+		{
+			if (std::memcmp(text + i, marker, 10) == 0 && (text[i + 10] == '\n' || text[i + 10] == '\r'))
+			{
+				end = text + i + 10;
+				break;
+			}
+		}
+		if (file.size() < 4 || std::memcmp(text, "ply", 3) != 0 || !end)
+			return "not a PLY file";
+		while (end < text + file.size() && *end != '\n')
+			end++;
+		offset = size_t(end + 1 - text);
+
+		std::istringstream header(std::string(text, end));
+		std::string line;
+		while (std::getline(header, line))
+		{
+			std::istringstream words(line);
+			std::string keyword;
+			words >> keyword;
+			if (keyword == "format")
+			{
+				std::string format;
+				words >> format;
+				if (format != "binary_little_endian")
+					return "only binary little-endian PLY files are supported, this one is " + format;
+				if constexpr (std::endian::native != std::endian::little)
+					return "binary little-endian PLY files can only be mapped on little-endian machines";
+			}
+			else if (keyword == "element")
+			{
+				element e;
+				words >> e.name >> e.count;
+				elements.push_back(e);
+			}
+			else if (keyword == "property")
+			{
+				if (elements.empty())
+					return "property before any element";
+				property p;
+				std::string type;
+				words >> type;
+				if (type == "list")
+				{
+					std::string count_type, item_type;
+					words >> count_type >> item_type;
+					p.count_type = parse_type(count_type);
+					p.type = parse_type(item_type);
+					if (p.count_type == unknown || p.count_type == float32 || p.count_type == float64)
+						return "bad list count type " + count_type;
+				}
+				else
+					p.type = parse_type(type);
+				words >> p.name;
+				if (p.type == unknown)
+					return "unknown property type in \"" + line + "\"";
+				elements.back().properties.push_back(p);
+			}
+		}
+
+		for (element& e : elements)
+		{
+			size_t size = 0;
+			for (property& p : e.properties)
+			{
+				p.offset = size;
+				size += p.count_type == unknown ? type_size(p.type) : 0;
+			}
+			bool fixed = true;
+			for (const property& p : e.properties)
+				fixed = fixed && p.count_type == unknown;
+			e.record_size = fixed ? size : 0;
+		}
+		return "";
+	}
+
+	static std::string read_vertices(const mapped_file& file, const element& e, size_t& offset, mesh_buffers& mesh)
+	{
+		if (e.record_size == 0)
+			return "list properties on vertices are not supported";
+		if (offset + e.count * e.record_size > file.size())
+			return "file ends inside the vertex data";
+		const property* x = e.find({ "x" });
+		const property* y = e.find({ "y" });
+		const property* z = e.find({ "z" });
+		if (!x || !y || !z)
+			return "vertices without x, y and z";
+		if (e.count >= mesh_buffers::missing)
+			return "too many vertices for 32-bit indices";
+
+		const unsigned char* records = file.data() + offset;
+		mesh.vertex_count = e.count;
+		if (x->type == float32 && y->type == float32 && z->type == float32 && y->offset == x->offset + 4 && z->offset == x->offset + 8)
+		{
+			mesh.position_data = records + x->offset;
+			mesh.position_stride = e.record_size;
+		}
+		else
+		{
+			mesh.position_storage.resize(3 * e.count);
+			convert_vertex_attribute(records, e, { x, y, z }, mesh.position_storage);
+			mesh.position_data = reinterpret_cast<const unsigned char*>(mesh.position_storage.data());
+			mesh.position_stride = 3 * sizeof(float);
+		}
+
+		const property* nx = e.find({ "nx" });
+		const property* ny = e.find({ "ny" });
+		const property* nz = e.find({ "nz" });
+		if (nx && ny && nz)
+		{
+			mesh.normals.resize(3 * e.count);
+			convert_vertex_attribute(records, e, { nx, ny, nz }, mesh.normals);
+		}
+		const property* u = e.find({ "u", "s", "texture_u", "texture_s" });
+		const property* v = e.find({ "v", "t", "texture_v", "texture_t" });
+		if (u && v)
+		{
+			mesh.uvs.resize(2 * e.count);
+			convert_vertex_attribute(records, e, { u, v }, mesh.uvs);
+		}
+		offset += e.count * e.record_size;
+		return "";
+	}
+
+	static void convert_vertex_attribute(const unsigned char* records, const element& e,
+										 std::initializer_list<const property*> fields, std::vector<float>& out)
+	{
+		const property* field[3];
+		size_t width = 0;
+		for (const property* p : fields)
+			field[width++] = p;
+		#pragma omp parallel for schedule(static)
+		for (long i = 0; i < long(e.count); i++)
+		{
+			const unsigned char* record = records + size_t(i) * e.record_size;
+			for (size_t k = 0; k < width; k++)
+				out[size_t(i) * width + k] = float(read_scalar(record + field[k]->offset, field[k]->type));
+		}
+	}
+
+	static std::string read_faces(const mapped_file& file, const element& e, size_t& offset, mesh_buffers& mesh)
+	{
+		const property* list = e.find({ "vertex_indices", "vertex_index" });
+		if (!list || list->count_type == unknown || list->type == float32 || list->type == float64)
+			return "faces without an integer vertex_indices list";
+		for (const property& p : e.properties)
+		{
+			if (p.count_type != unknown && &p != list)
+				return "faces with more than one list property are not supported";
+		}
+
+		// Scalars around the list, and where the list starts, are the same in every record
+		size_t before = 0, after = 0;
+		for (const property& p : e.properties)
+		{
+			if (&p == list)
+				continue;
+			(&p < list ? before : after) += type_size(p.type);
+		}
+		size_t count_size = type_size(list->count_type), item_size = type_size(list->type);
+		const unsigned char* records = file.data() + offset;
+		size_t available = file.size() - offset;
+
+		// In place when every face is a triangle of 32-bit indices, which makes the records one size
+		size_t triangle_record = before + count_size + 3 * item_size + after;
+		if (item_size == 4 && e.count * triangle_record <= available
+			&& all_triangles(records, e.count, triangle_record, before, list->count_type, list->type, mesh.vertex_count))
+		{
+			mesh.index_data = records + before + count_size;
+			mesh.triangle_stride = triangle_record;
+			mesh.triangle_count = e.count;
+			offset += e.count * triangle_record;
+			return "";
+		}
+
+		// Record starts of each block and the triangles it fans into, the only serial part of the conversion
+		size_t blocks = (e.count + face_block - 1) / face_block;
+		std::vector<size_t> block_offset(blocks + 1), block_triangles(blocks + 1, 0);
+		size_t position = 0, triangles = 0;
+		for (size_t face = 0; face < e.count; face++)
+		{
+			if (face % face_block == 0)
+			{
+				block_offset[face / face_block] = position;
+				block_triangles[face / face_block] = triangles;
+			}
+			if (position + before + count_size > available)
+				return "file ends inside the face data";
+			int64_t corners = read_integer(records + position + before, list->count_type);
+			if (corners < 0)
+				return "negative face size";
+			triangles += corners > 2 ? size_t(corners) - 2 : 0;
+			position += before + count_size + size_t(corners) * item_size + after;
+		}
+		if (position > available)
+			return "file ends inside the face data";
+		block_offset[blocks] = position;
+		block_triangles[blocks] = triangles;
+		if (3 * triangles >= mesh_buffers::missing)
+			return "too many triangles for 32-bit indices";
+
+		mesh.index_storage.resize(3 * triangles);
+		std::atomic<bool> in_range{ true };
+		#pragma omp parallel for schedule(dynamic)
+		for (long block = 0; block < long(blocks); block++)
+		{
+			const unsigned char* p = records + block_offset[block];
+			uint32_t* out = mesh.index_storage.data() + 3 * block_triangles[block];
+			size_t last = std::min(e.count, size_t(block + 1) * face_block);
+			for (size_t face = size_t(block) * face_block; face < last; face++)
+			{
+				p += before;
+				int64_t corners = read_integer(p, list->count_type);
+				p += count_size;
+				int64_t first = 0, previous = 0;
+				for (int64_t k = 0; k < corners; k++, p += item_size)
+				{
+					int64_t index = read_integer(p, list->type);
+					if (index < 0 || index >= int64_t(mesh.vertex_count))
+					{
+						in_range.store(false, std::memory_order_relaxed);
+						index = 0;
+					}
+					if (k == 0)
+						first = index;
+					else if (k >= 2)
+					{
+						*out++ = uint32_t(first);
+						*out++ = uint32_t(previous);
+						*out++ = uint32_t(index);
+					}
+					previous = index;
+				}
+				p += after;
+			}
+		}
+		if (!in_range)
+			return "face index out of range";
+
+		mesh.index_data = reinterpret_cast<const unsigned char*>(mesh.index_storage.data());
+		mesh.triangle_stride = 3 * sizeof(uint32_t);
+		mesh.triangle_count = triangles;
+		offset += position;
+		return "";
+	}
+
+	/* Whether every record's list holds three indices below the vertex count */
+	static bool all_triangles(const unsigned char* records, size_t count, size_t record_size, size_t count_offset,
+							  scalar_type count_type, scalar_type index_type, size_t vertex_count)
+	{
+		std::atomic<bool> valid{ true };
+		#pragma omp parallel for schedule(static)
+		for (long i = 0; i < long(count); i++)
+		{
+			const unsigned char* p = records + size_t(i) * record_size + count_offset;
+			bool ok = read_integer(p, count_type) == 3;
+			p += type_size(count_type);
+			for (int k = 0; k < 3 && ok; k++)
+			{
+				int64_t index = read_integer(p + 4 * k, index_type);
+				ok = index >= 0 && index < int64_t(vertex_count);
+			}
+			if (!ok)
+				valid.store(false, std::memory_order_relaxed);
+		}
+		return valid;
+	}
+
+	/* Steps over an element this reader does not use */
+	static std::string skip(const mapped_file& file, const element& e, size_t& offset)
+	{
+		if (e.record_size > 0 || e.properties.empty())
+		{
+			offset += e.count * e.record_size;
+			return offset <= file.size() ? "" : "file ends inside element " + e.name;
+		}
+		for (size_t i = 0; i < e.count; i++)
+		{
+			for (const property& p : e.properties)
+			{
+				if (offset + type_size(p.count_type == unknown ? p.type : p.count_type) > file.size())
+					return "file ends inside element " + e.name;
+				if (p.count_type == unknown)
+				{
+					offset += type_size(p.type);
+					continue;
+				}
+				int64_t items = read_integer(file.data() + offset, p.count_type);
+				offset += type_size(p.count_type) + size_t(std::max<int64_t>(items, 0)) * type_size(p.type);
+			}
+		}
+		return offset <= file.size() ? "" : "file ends inside element " + e.name;
+	}
+};
+
+#endif
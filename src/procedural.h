@@ -0,0 +1,215 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef PROCEDURAL_H
+#define PROCEDURAL_H
+
+#include "bvh.h"
+#include "hittable.h"
+#include "lru_cache.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+/*
+ * Fills one cell of a procedural_field with objects. It runs with thread_rng seeded for that
+ * cell alone, so random_double(), vec3::random() and the rest draw the same numbers for the
+ * same cell on every thread and every run. Objects must stay inside the cell's box.
+ */
+using cell_generator = std::function<void(const aabb& cell, std::vector<shared_ptr<hittable>>& objects)>;
+
+/*
+ * Region of space divided into cells whose objects are generated the first time a ray or a
+ * point query reaches them, for fields of objects too large to generate up front. Rays walk
+ * the cells with a 3D-DDA, like grid_accel, generating as they go.
+ *
+ * Generated cells live in a bounded least recently used cache shared by the rendering threads,
+ * so memory follows what the camera sees rather than the size of the field. An evicted cell is
+ * regenerated identically if a ray comes back to it.
+ */
+class procedural_field : public hittable
+{
+  public:
+	/*
+	 * Cells of roughly cell_size tiling bounds, filled by generate. The cache holds cells until
+	 * their objects, counting each cell as one more, pass max_resident_objects.
+	 */
+	procedural_field(const aabb& bounds, const vec3& cell_size, uint64_t seed, cell_generator generate,
+					 size_t max_resident_objects = 1 << 20)
+		: bounds(bounds), seed(seed), generate(std::move(generate)), cache(max_resident_objects)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double size = bounds.axis_interval(axis).size();
+			resolution[axis] = std::max(1, int(std::ceil(size / cell_size[axis])));
+			this->cell_size[axis] = size / resolution[axis];
+			inv_cell_size[axis] = 1.0 / this->cell_size[axis];
+		}
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		const point3& origin = r.origin();
+		const vec3& d = r.direction();
+		const vec3& inv_dir = r.inverse_direction();
+		interval field_t = ray_t;
+		if (!bounds.hit(origin, inv_dir, field_t))
+			return false;
+
+		// Set up the walk from the cell where the ray enters the field
+		point3 entry = r.at(field_t.min);
+		int cell[3], step[3], stop[3];
+		double next_t[3], delta_t[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double offset = entry[axis] - bounds.axis_interval(axis).min;
+			cell[axis] = std::clamp(int(offset * inv_cell_size[axis]), 0, resolution[axis] - 1);
+			if (d[axis] > 0)
+			{
+				step[axis] = 1;
+				stop[axis] = resolution[axis];
+				next_t[axis] = field_t.min + ((cell[axis] + 1) * cell_size[axis] - offset) * inv_dir[axis];
+				delta_t[axis] = cell_size[axis] * inv_dir[axis];
+			}
+			else if (d[axis] < 0)
+			{
+				step[axis] = -1;
+				stop[axis] = -1;
+				next_t[axis] = field_t.min + (cell[axis] * cell_size[axis] - offset) * inv_dir[axis];
+				delta_t[axis] = -cell_size[axis] * inv_dir[axis];
+			}
+			else
+			{
+				step[axis] = 0;
+				stop[axis] = -1;
+				next_t[axis] = infinity;
+				delta_t[axis] = infinity;
+			}
+		}
+
+		bool hit_anything = false;
+		uint64_t visits = 0, tests = 0;
+		while (true)
+		{
+			shared_ptr<const procedural_cell> contents = cell_at(cell);
+			visits++;
+			tests += contents->objects.size();
+			for (const auto& object : contents->objects)
+			{
+				if (object->hit(r, ray_t, rec))
+				{
+					hit_anything = true;
+					ray_t.max = rec.t;
+				}
+			}
+
+			// Objects stay inside their cell, so a hit ends the walk at the cell's far side
+			int axis = (next_t[0] < next_t[1]) ? (next_t[0] < next_t[2] ? 0 : 2) : (next_t[1] < next_t[2] ? 1 : 2);
+			if (ray_t.max <= next_t[axis] || next_t[axis] > field_t.max)
+				break;
+			cell[axis] += step[axis];
+			if (cell[axis] == stop[axis])
+				break;
+			next_t[axis] += delta_t[axis];
+		}
+		ray_stats.node_visits += visits;
+		ray_stats.primitive_tests += tests;
+		return hit_anything;
+	}
+
+	/* Treated as the union of its objects, generating the cell holding the point */
+	bool volume_contains(const point3 p) const override
+	{
+		if (!bounds.contains(p))
+			return false;
+		int cell[3];
+		for (int axis = 0; axis < 3; axis++)
+			cell[axis] = std::clamp(int((p[axis] - bounds.axis_interval(axis).min) * inv_cell_size[axis]), 0, resolution[axis] - 1);
+		for (const auto& object : cell_at(cell)->objects)
+		{
+			if (object->volume_contains(p))
+				return true;
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		return bounds;
+	}
+
+	uint64_t cell_count() const { return uint64_t(resolution[0]) * resolution[1] * resolution[2]; }
+
+	/* Every cell's objects, the same ones rays would generate, for building the field up front instead */
+	std::vector<shared_ptr<hittable>> generate_all() const
+	{
+		std::vector<shared_ptr<hittable>> objects;
+		int cell[3];
+		for (cell[2] = 0; cell[2] < resolution[2]; cell[2]++)
+			for (cell[1] = 0; cell[1] < resolution[1]; cell[1]++)
+				for (cell[0] = 0; cell[0] < resolution[0]; cell[0]++)
+					generate_cell(key_of(cell), cell, objects);
+		return objects;
+	}
+
+	/* Cache lookups so far, with the cells and objects resident now */
+	cache_statistics statistics() const { return cache.statistics(); }
+
+  private:
+	struct procedural_cell
+	{
+		std::vector<shared_ptr<hittable>> objects; // A single bvh when the generator made many
+		size_t generated = 0;                      // Objects the generator made, the cell's cost in the cache
+	};
+
+	// Cells with more objects than this are searched through a bvh of their own
+	static const size_t bvh_threshold = 8;
+
+	aabb bounds;
+	uint64_t seed;
+	cell_generator generate;
+	int resolution[3];
+	vec3 cell_size;
+	vec3 inv_cell_size;
+	mutable lru_cache<procedural_cell> cache;
+
+	uint64_t key_of(const int cell[3]) const
+	{
+		return (uint64_t(cell[2]) * resolution[1] + cell[1]) * resolution[0] + cell[0];
+	}
+
+	shared_ptr<const procedural_cell> cell_at(const int cell[3]) const
+	{
+		uint64_t key = key_of(cell);
+		return cache.get(key, [&] { return make_cell(key, cell); },
+			[](const procedural_cell& c) { return c.generated + 1; });
+	}
+
+	shared_ptr<const procedural_cell> make_cell(uint64_t key, const int cell[3]) const
+	{
+		auto made = make_shared<procedural_cell>();
+		generate_cell(key, cell, made->objects);
+		made->generated = made->objects.size();
+		if (made->objects.size() > bvh_threshold)
+			made->objects = { make_shared<bvh>(made->objects) };
+		return made;
+	}
+
+	void generate_cell(uint64_t key, const int cell[3], std::vector<shared_ptr<hittable>>& objects) const
+	{
+		point3 low;
+		for (int axis = 0; axis < 3; axis++)
+			low[axis] = bounds.axis_interval(axis).min + cell[axis] * cell_size[axis];
+
+		// The cell's stream depends only on the field's seed and the cell, never on which thread got here first
+		rng saved = thread_rng;
+		thread_rng = rng(rng(seed ^ (key * 0xd1b54a32d192ed03ULL)).next());
+		generate(aabb(low, low + cell_size), objects);
+		thread_rng = saved;
+	}
+};
+
+#endif
@@ -0,0 +1,402 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef QUADRIC_H
+#define QUADRIC_H
+
+#include "bvh.h"
+#include "hittable.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Second-order surface x^T Q x = 0 over homogeneous points x = (p, 1), with Q a symmetric 4x4
+ * matrix and the solid where x^T Q x < 0. Spheres, cylinders, cones, paraboloids and hyperboloids
+ * all take this form, so they share one intersection kernel. Up to four half-spaces clip the
+ * surface, which leaves it open where they cut, like a cone without its cap.
+ *
+ * The kernel reads every coefficient from structure-of-arrays lanes. A lone quadric is one
+ * lane, quadric_set runs a whole BVH leaf of mixed shapes through it at once.
+ */
+class quadric : public hittable
+{
+  public:
+	static const int max_clips = 4;
+
+	// Q's ten distinct entries, then a normal and offset per clip plane, keeping dot(normal, p) <= offset
+	static const int field_count = 10 + 4 * max_clips;
+
+	/* Surface of a symmetric matrix. Only the upper triangle is read. The box has to enclose the clipped surface */
+	quadric(const double (&matrix)[4][4], shared_ptr<material> mat, const aabb& bbox = aabb::universe)
+		: mat(mat), bbox(bbox)
+	{
+		double entries[10] = { matrix[0][0], matrix[1][1], matrix[2][2], matrix[0][1], matrix[0][2],
+							   matrix[1][2], matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3] };
+		std::copy(entries, entries + 10, fields);
+		for (int k = 0; k < max_clips; k++)
+			set_clip(k, vec3(0, 0, 0), infinity); // Unused planes keep every point
+	}
+
+	/* Keeps the part of the surface behind a plane through the point, returns false when all clip planes are in use */
+	bool clip(const point3& point, const vec3& normal)
+	{
+		if (clip_count == max_clips)
+			return false;
+		vec3 n = unit_vector(normal);
+		set_clip(clip_count++, n, dot(n, point));
+		return true;
+	}
+
+	/* Ball around a center */
+	static shared_ptr<quadric> make_sphere(const point3& center, double radius, shared_ptr<material> mat)
+	{
+		vec3 reach(radius, radius, radius);
+		return axial(center, vec3(0, 1, 0), 1, 0, 0, -radius * radius, mat, aabb(center - reach, center + reach));
+	}
+
+	/* Open tube of a radius rising along the axis from the center of its base */
+	static shared_ptr<quadric> make_cylinder(const point3& base, const vec3& axis, double radius, double height,
+											 shared_ptr<material> mat)
+	{
+		vec3 a = unit_vector(axis);
+		point3 top = base + height * a;
+		auto q = axial(base, a, 1, -1, 0, -radius * radius, mat, aabb(disk_box(base, a, radius), disk_box(top, a, radius)));
+		q->clip(base, -a);
+		q->clip(top, a);
+		return q;
+	}
+
+	/* Open cone from an apex along the axis at a half-angle in degrees, cut off at the height */
+	static shared_ptr<quadric> make_cone(const point3& apex, const vec3& axis, double angle, double height,
+										 shared_ptr<material> mat)
+	{
+		vec3 a = unit_vector(axis);
+		point3 base = apex + height * a;
+		double radius = height * std::tan(degrees_to_radians(angle));
+		auto q = cone_around(apex, a, angle, mat, aabb(aabb(apex, apex), disk_box(base, a, radius)));
+		q->clip(base, a);
+		return q;
+	}
+
+	/* The unbounded single cone of infinite_cone */
+	static shared_ptr<quadric> make_infinite_cone(const point3& apex, const vec3& axis, double angle, shared_ptr<material> mat)
+	{
+		return cone_around(apex, unit_vector(axis), angle, mat, aabb::universe);
+	}
+
+	/* Open bowl from its vertex along the axis, reaching the radius at the height */
+	static shared_ptr<quadric> make_paraboloid(const point3& vertex, const vec3& axis, double radius, double height,
+											   shared_ptr<material> mat)
+	{
+		vec3 a = unit_vector(axis);
+		point3 rim = vertex + height * a;
+		// Radial distance squared grows linearly along the axis, so the sides bulge past the cone to the rim and need the cylinder's box
+		auto q = axial(vertex, a, 1, -1, -radius * radius / height, 0, mat, aabb(disk_box(vertex, a, radius), disk_box(rim, a, radius)));
+		q->clip(rim, a);
+		return q;
+	}
+
+	/* Open hyperboloid of one sheet around its center, narrowest at the waist and widening to the radius at both ends */
+	static shared_ptr<quadric> make_hyperboloid(const point3& center, const vec3& axis, double waist, double radius,
+												double height, shared_ptr<material> mat)
+	{
+		vec3 a = unit_vector(axis);
+		double half = height / 2;
+		// Radial^2 / waist^2 - axial^2 / c^2 = 1, with c chosen so the ends reach the radius
+		double c_squared = half * half / std::fmax(radius * radius / (waist * waist) - 1, epsilon);
+		double w = 1 / (waist * waist);
+		point3 bottom = center - half * a, top = center + half * a;
+		auto q = axial(center, a, w, -w - 1 / c_squared, 0, -1, mat, aabb(disk_box(bottom, a, radius), disk_box(top, a, radius)));
+		q->clip(bottom, -a);
+		q->clip(top, a);
+		return q;
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		if (nearest_lane(fields, 1, 0, 1, clip_count, r, ray_t) < 0)
+			return false;
+		record_hit(r, ray_t.max, rec);
+		return true;
+	}
+
+	bool volume_contains(const point3 p) const override
+	{
+		return value(p) <= 0 && inside_clips(p);
+	}
+
+	aabb bounding_box() const override
+	{
+		return bbox;
+	}
+
+	/* Fills in a hit found by the kernel at distance t */
+	void record_hit(const ray& r, double t, hit_record& rec) const
+	{
+		rec.t = t;
+		rec.p = r.at(t);
+		vec3 gradient = half_gradient(rec.p);
+		double length = gradient.length();
+		// The apex of a cone has no normal, face the ray there
+		rec.set_face_normal(r, length > 0 ? gradient / length : -unit_vector(r.direction()));
+		rec.mat = mat;
+	}
+
+	/* Value of x^T Q x at a point, negative inside */
+	double value(const point3& p) const
+	{
+		const double* f = fields;
+		double x = p.x(), y = p.y(), z = p.z();
+		return f[0] * x * x + f[1] * y * y + f[2] * z * z + 2 * (f[3] * x * y + f[4] * x * z + f[5] * y * z)
+			 + 2 * (f[6] * x + f[7] * y + f[8] * z) + f[9];
+	}
+
+	const double* lane_fields() const { return fields; }
+	int clip_planes() const { return clip_count; }
+
+	/*
+	 * Intersects a ray with count quadrics whose field k is at fields[k * stride + first + lane], testing only
+	 * their first clips clip planes. Returns the lane with the nearest hit inside ray_t after narrowing
+	 * ray_t.max to it, or -1. Lanes run as SIMD in chunks, and chunks the ray misses entirely stop after the
+	 * discriminant, as most do.
+	 */
+	static int nearest_lane(const double* fields, size_t stride, size_t first, int count, int clips, const ray& r,
+							interval& ray_t)
+	{
+		const double ox = r.origin().x(), oy = r.origin().y(), oz = r.origin().z();
+		const double dx = r.direction().x(), dy = r.direction().y(), dz = r.direction().z();
+		int best = -1;
+
+		for (int base = 0; base < count; base += lane_chunk)
+		{
+			int lanes = std::min(lane_chunk, count - base);
+			const double* f[field_count];
+			for (int k = 0; k < 10 + 4 * clips; k++)
+				f[k] = fields + k * stride + first + base;
+
+			// Q applied to the direction and the origin gives the quadratic a t^2 + 2 half_b t + c
+			double a[lane_chunk], half_b[lane_chunk], c[lane_chunk], discriminant[lane_chunk];
+			bool any_real = false;
+			#pragma omp simd reduction(|:any_real)
+			for (int i = 0; i < lanes; i++)
+			{
+				double A = f[0][i], B = f[1][i], C = f[2][i], D = f[3][i], E = f[4][i], F = f[5][i];
+				double G = f[6][i], H = f[7][i], I = f[8][i], J = f[9][i];
+				double qdx = A * dx + D * dy + E * dz, qdy = D * dx + B * dy + F * dz, qdz = E * dx + F * dy + C * dz;
+				double qox = A * ox + D * oy + E * oz + G, qoy = D * ox + B * oy + F * oz + H, qoz = E * ox + F * oy + C * oz + I;
+				c[i] = qox * ox + qoy * oy + qoz * oz + G * ox + H * oy + I * oz + J;
+				a[i] = qdx * dx + qdy * dy + qdz * dz;
+				half_b[i] = qox * dx + qoy * dy + qoz * dz;
+				discriminant[i] = half_b[i] * half_b[i] - a[i] * c[i];
+				any_real |= discriminant[i] >= 0;
+			}
+			if (!any_real)
+				continue;
+
+			const double t_min = ray_t.min, t_max = ray_t.max;
+			double nearest[lane_chunk];
+			#pragma omp simd
+			for (int i = 0; i < lanes; i++)
+			{
+				// The stable root pair, which also gives the single root when a vanishes
+				double root = std::sqrt(std::fmax(discriminant[i], 0.0));
+				double q = -(half_b[i] + std::copysign(root, half_b[i]));
+				double t0 = q / a[i], t1 = c[i] / q;
+				double near_t = std::fmin(t0, t1), far_t = std::fmax(t0, t1);
+
+				bool near_ok = discriminant[i] >= 0 && near_t > t_min && near_t < t_max;
+				bool far_ok = discriminant[i] >= 0 && far_t > t_min && far_t < t_max;
+				for (int k = 0; k < clips; k++)
+				{
+					double nx = f[10 + 4 * k][i], ny = f[11 + 4 * k][i], nz = f[12 + 4 * k][i], offset = f[13 + 4 * k][i];
+					double start = nx * ox + ny * oy + nz * oz - offset, rate = nx * dx + ny * dy + nz * dz;
+					near_ok = near_ok && start + near_t * rate <= 0;
+					far_ok = far_ok && start + far_t * rate <= 0;
+				}
+				nearest[i] = near_ok ? near_t : (far_ok ? far_t : infinity);
+			}
+
+			for (int i = 0; i < lanes; i++)
+			{
+				if (nearest[i] < ray_t.max)
+				{
+					ray_t.max = nearest[i];
+					best = base + i;
+				}
+			}
+		}
+		return best;
+	}
+
+  private:
+	static const int lane_chunk = 8;
+
+	double fields[field_count];
+	int clip_count = 0;
+	shared_ptr<material> mat;
+	aabb bbox;
+
+	void set_clip(int k, const vec3& normal, double offset)
+	{
+		fields[10 + 4 * k] = normal.x();
+		fields[11 + 4 * k] = normal.y();
+		fields[12 + 4 * k] = normal.z();
+		fields[13 + 4 * k] = offset;
+	}
+
+	bool inside_clips(const point3& p) const
+	{
+		for (int k = 0; k < clip_count; k++)
+		{
+			const double* plane = fields + 10 + 4 * k;
+			if (plane[0] * p.x() + plane[1] * p.y() + plane[2] * p.z() > plane[3])
+				return false;
+		}
+		return true;
+	}
+
+	// Half the gradient of x^T Q x, pointing out of the solid
+	vec3 half_gradient(const point3& p) const
+	{
+		const double* f = fields;
+		return vec3(f[0] * p.x() + f[3] * p.y() + f[4] * p.z() + f[6],
+					f[3] * p.x() + f[1] * p.y() + f[5] * p.z() + f[7],
+					f[4] * p.x() + f[5] * p.y() + f[2] * p.z() + f[8]);
+	}
+
+	/*
+	 * Surface alpha |d|^2 + beta (a.d)^2 + gamma (a.d) + delta = 0 in the offset d = p - center from a point
+	 * on a unit axis. Expanding d gives Q = [M, l; l^T, k] with M = alpha I + beta a a^T.
+	 */
+	static shared_ptr<quadric> axial(const point3& center, const vec3& a, double alpha, double beta, double gamma,
+									 double delta, shared_ptr<material> mat, const aabb& bbox)
+	{
+		double m[3][3];
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				m[i][j] = (i == j ? alpha : 0) + beta * a[i] * a[j];
+
+		double q[4][4];
+		vec3 mc;
+		for (int i = 0; i < 3; i++)
+		{
+			mc[i] = m[i][0] * center.x() + m[i][1] * center.y() + m[i][2] * center.z();
+			for (int j = 0; j < 3; j++)
+				q[i][j] = m[i][j];
+		}
+		for (int i = 0; i < 3; i++)
+			q[i][3] = q[3][i] = -mc[i] + 0.5 * gamma * a[i];
+		q[3][3] = dot(center, mc) - gamma * dot(a, center) + delta;
+		return make_shared<quadric>(q, mat, bbox);
+	}
+
+	// Double cone dot(d, a)^2 = cos^2 |d|^2 around the apex, clipped to the nappe the axis points into
+	static shared_ptr<quadric> cone_around(const point3& apex, const vec3& a, double angle, shared_ptr<material> mat,
+										   const aabb& bbox)
+	{
+		double cos_angle = std::cos(degrees_to_radians(angle));
+		auto q = axial(apex, a, cos_angle * cos_angle, -1, 0, 0, mat, bbox);
+		q->clip(apex, -a);
+		return q;
+	}
+
+	// Box around a disk, whose extent along each axis shrinks as it tilts towards that axis
+	static aabb disk_box(const point3& center, const vec3& normal, double radius)
+	{
+		vec3 reach(radius * std::sqrt(std::fmax(0.0, 1 - normal.x() * normal.x())),
+				   radius * std::sqrt(std::fmax(0.0, 1 - normal.y() * normal.y())),
+				   radius * std::sqrt(std::fmax(0.0, 1 - normal.z() * normal.z())));
+		return aabb(center - reach, center + reach);
+	}
+};
+
+/*
+ * Many quadrics of any shape under one BVH with up to eight per leaf. Their fields are stored
+ * as arrays in leaf order, so a leaf is a contiguous run of lanes for quadric::nearest_lane.
+ * Unbounded quadrics sit outside the tree and are tested on every ray.
+ */
+class quadric_set : public hittable
+{
+  public:
+	quadric_set(const std::vector<shared_ptr<quadric>>& quadrics)
+	{
+		std::vector<aabb> boxes;
+		for (const auto& q : quadrics)
+		{
+			aabb box = q->bounding_box();
+			if (box.is_bounded())
+			{
+				bounded.push_back(q);
+				boxes.push_back(box);
+			}
+			else
+			{
+				unbounded.push_back(q);
+			}
+		}
+
+		tree.max_leaf_size = 8;
+		tree.build(boxes);
+		stride = bounded.size();
+		fields.resize(quadric::field_count * stride);
+		for (size_t i = 0; i < stride; i++)
+		{
+			ordered.push_back(bounded[tree.indices[i]]);
+			clips = std::max(clips, ordered.back()->clip_planes());
+			const double* source = ordered.back()->lane_fields();
+			for (int k = 0; k < quadric::field_count; k++)
+				fields[k * stride + i] = source[k];
+		}
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		const quadric* nearest = nullptr;
+		for (const auto& q : unbounded)
+		{
+			if (quadric::nearest_lane(q->lane_fields(), 1, 0, 1, q->clip_planes(), r, ray_t) >= 0)
+				nearest = q.get();
+		}
+		tree.traverse_leaves(r, ray_t, [&](uint32_t first, uint32_t count, interval& t)
+		{
+			int lane = quadric::nearest_lane(fields.data(), stride, first, int(count), clips, r, t);
+			if (lane < 0)
+				return false;
+			nearest = ordered[first + lane].get();
+			return true;
+		});
+		if (!nearest)
+			return false;
+		nearest->record_hit(r, ray_t.max, rec);
+		return true;
+	}
+
+	/* Treated as the union of its quadrics */
+	bool volume_contains(const point3 p) const override
+	{
+		for (const auto& q : unbounded)
+		{
+			if (q->volume_contains(p))
+				return true;
+		}
+		return tree.any_containing(p, [&](uint32_t i) { return bounded[i]->volume_contains(p); });
+	}
+
+	aabb bounding_box() const override
+	{
+		return unbounded.empty() ? tree.bounds() : aabb::universe;
+	}
+
+  private:
+	bvh_tree tree;
+	std::vector<shared_ptr<quadric>> bounded; // In primitive order
+	std::vector<shared_ptr<quadric>> ordered; // The same in leaf order
+	std::vector<shared_ptr<quadric>> unbounded;
+	std::vector<double> fields;               // Field k of the quadric at leaf position i is fields[k * stride + i]
+	size_t stride = 0;
+	int clips = 0;                            // Most clip planes on any bounded quadric, unused ones pass every point
+};
+
+#endif
@@ -12,11 +12,15 @@ class ray
   public:
 	ray() {}
 
-	ray(const point3& origin, const vec3& direction) : orig(origin), dir(direction) {}
+	ray(const point3& origin, const vec3& direction)
+		: orig(origin), dir(direction), inv_dir(1.0 / direction.x(), 1.0 / direction.y(), 1.0 / direction.z()) {}
 
 	const point3& origin() const { return orig; }
 	const vec3& direction() const { return dir; }
 
+	// Reciprocal of each direction component for slab tests, infinite along axes the ray is parallel to
+	const vec3& inverse_direction() const { return inv_dir; }
+
 	point3 at(double t) const
 	{
 		return orig + t * dir;
@@ -25,6 +29,7 @@ class ray
   private:
 	point3 orig;
 	vec3 dir;
+	vec3 inv_dir; // Computed once here rather than by every box, grid and bvh the ray visits
 };
 
 #endif
\ No newline at end of file
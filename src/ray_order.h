@@ -0,0 +1,91 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef RAY_ORDER_H
+#define RAY_ORDER_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * Orders a stream of rays so neighbours start near each other and head the same way. Rays are
+ * binned by direction octant, then sorted by the Morton code of their origin within the bounds
+ * of all the origins. Each key is 3 octant bits above 27 Morton bits, 9 per axis, and a radix
+ * sort of one byte per pass orders them in time linear in the ray count. The buffers are kept
+ * between calls, so a sorter reused across bounces stops allocating after the first.
+ */
+class ray_order
+{
+  public:
+	/* Sets order to the indices of rays in sorted order */
+	void sort(std::span<const ray> rays, std::vector<uint32_t>& order)
+	{
+		size_t n = rays.size();
+		order.resize(n);
+		if (n == 0)
+			return;
+
+		point3 lo = rays[0].origin(), hi = lo;
+		for (const ray& r : rays)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				lo[axis] = std::fmin(lo[axis], r.origin()[axis]);
+				hi[axis] = std::fmax(hi[axis], r.origin()[axis]);
+			}
+		}
+		double scale[3];
+		for (int axis = 0; axis < 3; axis++)
+			scale[axis] = hi[axis] > lo[axis] ? (cells - 1) / (hi[axis] - lo[axis]) : 0;
+
+		// Key in the high half, ray index in the low half, so sorting moves both at once
+		items.resize(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			const point3& o = rays[i].origin();
+			const vec3& d = rays[i].direction();
+			uint32_t octant = (d.x() < 0) | (d.y() < 0) << 1 | (d.z() < 0) << 2;
+			uint32_t morton = spread(uint32_t((o.x() - lo.x()) * scale[0]))
+				| spread(uint32_t((o.y() - lo.y()) * scale[1])) << 1
+				| spread(uint32_t((o.z() - lo.z()) * scale[2])) << 2;
+			items[i] = uint64_t(octant << 27 | morton) << 32 | i;
+		}
+
+		scratch.resize(n);
+		for (int shift = 32; shift < 64; shift += 8)
+		{
+			size_t counts[257] = {};
+			for (uint64_t item : items)
+				counts[((item >> shift) & 0xff) + 1]++;
+			for (int digit = 0; digit < 256; digit++)
+				counts[digit + 1] += counts[digit];
+			for (uint64_t item : items)
+				scratch[counts[(item >> shift) & 0xff]++] = item;
+			items.swap(scratch);
+		}
+
+		for (size_t i = 0; i < n; i++)
+			order[i] = uint32_t(items[i]);
+	}
+
+  private:
+	static const uint32_t cells = 512; // Morton cells per axis
+
+	std::vector<uint64_t> items;
+	std::vector<uint64_t> scratch;
+
+	// Moves the low 9 bits of v to every third bit
+	static uint32_t spread(uint32_t v)
+	{
+		v &= 0x1ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+};
+
+#endif
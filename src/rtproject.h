@@ -6,11 +6,16 @@
 #define RTPROJECT_H
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <memory>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
 // C++ Std Usings
 
 using std::make_shared;
@@ -29,10 +34,50 @@ inline double degrees_to_radians(double degrees)
 	return degrees * pi / 180.0;
 }
 
+/* Asks for the cache line holding address to be loaded, without waiting for it */
+inline void prefetch(const void* address)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(address);
+#else
+	(void) address;
+#endif
+}
+
+// Random Number Generation
+
+/* Splitmix64 generator, small enough that every thread and every sample can own a stream */
+class rng
+{
+  public:
+	uint64_t state;
+
+	rng(uint64_t seed = 0) : state(seed) {}
+
+	uint64_t next()
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	// Returns a random real in [0, 1)
+	double next_double()
+	{
+		return (next() >> 11) * 0x1.0p-53;
+	}
+};
+
+// Stream used by the calling thread, the camera reseeds it for every sample
+inline thread_local rng thread_rng;
+
 // Returns a random real in [0, 1)
 inline double random_double()
 {
-	return std::rand() / (RAND_MAX + 1.0);
+	return thread_rng.next_double();
 }
 
 // Returns a random real in [min, max)
@@ -47,5 +92,6 @@ inline double random_double(double min, double max)
 #include "interval.h"
 #include "ray.h"
 #include "vec3.h"
+#include "aabb.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,998 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "accelerator.h"
+#include "box.h"
+#include "camera.h"
+#include "cone.h"
+#include "csg.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "infinite_cone.h"
+#include "instance.h"
+#include "material.h"
+#include "mesh.h"
+#include "obj_loader.h"
+#include "plane.h"
+#include "ply_loader.h"
+#include "quadric.h"
+#include "sphere.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/* Objects and camera settings read from a scene file, ready for build_accelerator */
+struct scene_description
+{
+	std::vector<shared_ptr<hittable>> objects;
+	size_t material_count = 0; // Distinct materials after merging identical definitions
+
+	int image_width = 640;
+	int image_height = 360;
+	int samples_per_pixel = 32;
+	int max_depth = 10;
+	double vfov = 40;
+	point3 lookfrom = point3(0, 0, 0);
+	point3 lookat = point3(0, 0, -1);
+	vec3 vup = vec3(0, 1, 0);
+	double defocus_angle = 0;
+	double focus_dist = 0; // 0 focuses on lookat
+
+	void configure(camera& cam) const
+	{
+		cam.image_width = image_width;
+		cam.image_height = image_height;
+		cam.samples_per_pixel = samples_per_pixel;
+		cam.max_depth = max_depth;
+		cam.vfov = vfov;
+		cam.lookfrom = lookfrom;
+		cam.lookat = lookat;
+		cam.vup = vup;
+		cam.defocus_angle = defocus_angle;
+		cam.focus_dist = focus_dist > 0 ? focus_dist : (lookat - lookfrom).length();
+	}
+};
+
+/*
+ * Reader for text scene files, so scenes can change without rebuilding the program. A file is a
+ * list of statements:
+ *
+ *     camera { width 1200 height 675 samples 500 depth 50 fov 20
+ *              from (13, 2, 3) at (0, 0, 0) up (0, 1, 0) defocus 0.6 focus 10 }
+ *     material ground lambertian (0.5, 0.5, 0.5)     # also metal (r, g, b) fuzz, dielectric index
+ *     let radius = 0.2
+ *     sphere (0, -1000, 0) 1000 ground
+ *     for a in -11 .. 11 { if random() < 0.8 { sphere (a, 0.2, 0) radius lambertian (random(), 0.5, 0.5) } }
+ *
+ * Objects are sphere center radius, plane point normal, box corner corner, cone apex base_center
+ * radius [open], infinite_cone apex axis degrees, cylinder base axis radius height and mesh "file",
+ * each followed by a material, either a defined name or an inline definition. union, intersection
+ * and difference take a block of objects, difference cutting the rest from the first, and
+ * instance takes translate v, rotate axis degrees and scale s or v, applied in the order written,
+ * then a block of objects.
+ *
+ * Expressions have numbers, vectors written (x, y, z), variables, arithmetic with scalars spread
+ * over vectors, comparisons, && || !, and the functions random() random(lo, hi) sqrt sin cos abs
+ * min max floor radians length dot. Loops run over lo <= variable < hi.
+ *
+ * The text is parsed in a single pass that lexes a token ahead, evaluates as it goes and builds
+ * objects directly, with loop bodies read again for every iteration and branches not taken
+ * skipped by their braces. Materials with the same kind and settings are made once and shared.
+ * Errors stop the parse and report file:line:column.
+ */
+class scene_file
+{
+  public:
+	/* The scene in the file, false after printing why it could not be read */
+	static bool load(const std::string& filename, scene_description& scene)
+	{
+		std::ifstream in(filename, std::ios::binary | std::ios::ate);
+		if (!in)
+		{
+			std::cerr << "Could not open " << filename << "\n";
+			return false;
+		}
+		std::string text(size_t(in.tellg()), '\0');
+		in.seekg(0);
+		in.read(text.data(), text.size());
+		if (!in)
+		{
+			std::cerr << "Could not read " << filename << "\n";
+			return false;
+		}
+		return parse(text, filename, std::filesystem::path(filename).parent_path().string(), scene);
+	}
+
+	/* Parses scene text, with name in error messages and mesh paths taken relative to directory */
+	static bool parse(std::string_view text, const std::string& name, const std::string& directory, scene_description& scene)
+	{
+		parser p(text, directory, scene);
+		if (!p.run())
+		{
+			std::cerr << name << ":" << p.error_line << ":" << p.error_column << ": " << p.error << "\n";
+			return false;
+		}
+		scene.material_count = p.material_count();
+		return true;
+	}
+
+  private:
+	enum token_kind { end_of_file, number, identifier, string, symbol };
+
+	struct token
+	{
+		token_kind kind;
+		std::string_view text; // Without the quotes of a string
+		double value;
+		int line, column;
+	};
+
+	// A number, or a vector when is_vector, whose x holds a number's value
+	struct value
+	{
+		vec3 v;
+		bool is_vector = false;
+
+		double number() const { return v.x(); }
+	};
+
+	class parser
+	{
+	  public:
+		std::string error;
+		int error_line = 0, error_column = 0;
+
+		parser(std::string_view text, const std::string& directory, scene_description& scene)
+			: text(text), directory(directory), scene(scene)
+		{
+			cursor.p = cursor.line_start = text.data();
+		}
+
+		bool run()
+		{
+			lex();
+			while (peek().kind != end_of_file)
+			{
+				if (!statement(scene.objects))
+					return false;
+			}
+			return error.empty();
+		}
+
+		size_t material_count() const { return distinct_materials.size(); }
+
+	  private:
+		std::string_view text;
+		const std::string& directory;
+		scene_description& scene;
+
+		// Where the lexer is, copied to come back to the start of a loop body
+		struct lexer_state
+		{
+			const char* p;
+			const char* line_start;
+			int line = 1;
+			token current;
+		} cursor;
+
+		// Looked up by the token's text in place, without making a string for every use of a name
+		struct name_hash
+		{
+			using is_transparent = void;
+			size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+		};
+		template <typename mapped>
+		using name_map = std::unordered_map<std::string, mapped, name_hash, std::equal_to<>>;
+
+		name_map<value> variables;
+		name_map<shared_ptr<material>> named_materials;
+		std::map<std::tuple<int, double, double, double, double>, shared_ptr<material>> distinct_materials;
+
+		// Lexing
+
+		// Reads the token after the one in current. Errors are recorded and end the file there
+		void lex()
+		{
+			const char* end = text.data() + text.size();
+			const char*& p = cursor.p;
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == '#'))
+			{
+				if (*p == '#')
+				{
+					while (p < end && *p != '\n')
+						p++;
+					continue;
+				}
+				if (*p == '\n')
+				{
+					cursor.line++;
+					cursor.line_start = p + 1;
+				}
+				p++;
+			}
+			token& t = cursor.current;
+			t = token{ end_of_file, {}, 0, cursor.line, int(p - cursor.line_start) + 1 };
+			if (p == end)
+				return;
+
+			const char* start = p;
+			if (is_digit(*p) || (*p == '.' && p + 1 < end && is_digit(p[1])))
+			{
+				// A dot only belongs to the number when a digit follows, so 0..10 is a range
+				while (p < end && is_digit(*p))
+					p++;
+				if (p + 1 < end && *p == '.' && is_digit(p[1]))
+				{
+					p++;
+					while (p < end && is_digit(*p))
+						p++;
+				}
+				if (p < end && (*p == 'e' || *p == 'E'))
+				{
+					const char* exponent = p + 1;
+					if (exponent < end && (*exponent == '+' || *exponent == '-'))
+						exponent++;
+					if (exponent < end && is_digit(*exponent))
+					{
+						p = exponent;
+						while (p < end && is_digit(*p))
+							p++;
+					}
+				}
+				t.kind = number;
+				std::from_chars(start, p, t.value);
+			}
+			else if (is_letter(*p))
+			{
+				while (p < end && (is_letter(*p) || is_digit(*p)))
+					p++;
+				t.kind = identifier;
+			}
+			else if (*p == '"')
+			{
+				start = ++p;
+				while (p < end && *p != '"' && *p != '\n')
+					p++;
+				if (p == end || *p != '"')
+				{
+					fail_at(t, "string is not closed on its line");
+					p = end;
+					return;
+				}
+				t.kind = string;
+				t.text = std::string_view(start, p - start);
+				p++;
+				return;
+			}
+			else
+			{
+				static const char* pairs[] = { "..", "<=", ">=", "==", "!=", "&&", "||" };
+				t.kind = symbol;
+				p++;
+				for (const char* pair : pairs)
+				{
+					if (p < end && start[0] == pair[0] && *p == pair[1])
+					{
+						p++;
+						break;
+					}
+				}
+				if (p - start == 1 && std::string_view("(){},=+-*/<>!").find(*start) == std::string_view::npos)
+				{
+					fail_at(t, "unexpected character '" + std::string(1, *start) + "'");
+					p = end;
+					return;
+				}
+			}
+			t.text = std::string_view(start, p - start);
+		}
+
+		static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+		static bool is_letter(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+
+		// Token stream
+
+		const token& peek() const { return cursor.current; }
+
+		token next()
+		{
+			token t = cursor.current;
+			if (t.kind != end_of_file)
+				lex();
+			return t;
+		}
+
+		bool at(std::string_view text) const
+		{
+			return peek().kind != string && peek().text == text;
+		}
+
+		bool accept(std::string_view text)
+		{
+			if (!at(text))
+				return false;
+			next();
+			return true;
+		}
+
+		bool expect(std::string_view text)
+		{
+			if (accept(text))
+				return true;
+			return fail("expected '" + std::string(text) + "'");
+		}
+
+		bool expect_name(std::string_view& name, const char* what)
+		{
+			if (peek().kind != identifier)
+				return fail(std::string("expected ") + what);
+			name = next().text;
+			return true;
+		}
+
+		// Records the first error, at the next unread token
+		bool fail(const std::string& message)
+		{
+			token t = peek();
+			std::string found = t.kind == end_of_file ? "end of file" : "'" + std::string(t.text) + "'";
+			return fail_at(t, message + ", found " + found);
+		}
+
+		bool fail_at(const token& t, const std::string& message)
+		{
+			if (error.empty())
+			{
+				error = message;
+				error_line = t.line;
+				error_column = t.column;
+			}
+			return false;
+		}
+
+		// Moves past a braced block without running it, the next token is its opening brace
+		bool skip_block()
+		{
+			if (!expect("{"))
+				return false;
+			for (int depth = 1; depth > 0;)
+			{
+				if (peek().kind == end_of_file)
+					return fail("block is not closed");
+				token t = next();
+				if (t.kind == symbol)
+					depth += (t.text == "{") - (t.text == "}");
+			}
+			return true;
+		}
+
+		// Statements
+
+		bool statement(std::vector<shared_ptr<hittable>>& objects)
+		{
+			if (peek().kind != identifier)
+				return fail("expected a statement");
+			if (accept("camera"))
+				return camera_block();
+			if (accept("material"))
+			{
+				std::string_view name;
+				shared_ptr<material> mat;
+				if (!expect_name(name, "a material name") || !material_value(mat))
+					return false;
+				named_materials[std::string(name)] = mat;
+				return true;
+			}
+			if (accept("let"))
+			{
+				std::string_view name;
+				value v;
+				if (!expect_name(name, "a variable name") || !expect("=") || !expression(v))
+					return false;
+				assign(name, v);
+				return true;
+			}
+			if (accept("for"))
+				return for_loop(objects);
+			if (accept("if"))
+				return if_block(objects);
+
+			shared_ptr<hittable> object;
+			if (!object_value(object))
+				return false;
+			objects.push_back(object);
+			return true;
+		}
+
+		// Statements up to the closing brace of a block
+		bool block(std::vector<shared_ptr<hittable>>& objects)
+		{
+			if (!expect("{"))
+				return false;
+			while (!accept("}"))
+			{
+				if (peek().kind == end_of_file)
+					return fail("block is not closed");
+				if (!statement(objects))
+					return false;
+			}
+			return true;
+		}
+
+		bool camera_block()
+		{
+			if (!expect("{"))
+				return false;
+			while (!accept("}"))
+			{
+				static const std::string_view keys[] = { "width", "height", "samples", "depth", "fov", "from", "at", "up",
+														 "defocus", "focus" };
+				if (std::find(std::begin(keys), std::end(keys), peek().text) == std::end(keys) || peek().kind != identifier)
+					return fail("expected a camera setting");
+				std::string key(next().text);
+				value v;
+				bool wants_vector = key == "from" || key == "at" || key == "up";
+				if (!(wants_vector ? vector_expression(v) : number_expression(v)))
+					return false;
+				if (key == "width")
+					scene.image_width = int(v.number());
+				else if (key == "height")
+					scene.image_height = int(v.number());
+				else if (key == "samples")
+					scene.samples_per_pixel = int(v.number());
+				else if (key == "depth")
+					scene.max_depth = int(v.number());
+				else if (key == "fov")
+					scene.vfov = v.number();
+				else if (key == "from")
+					scene.lookfrom = v.v;
+				else if (key == "at")
+					scene.lookat = v.v;
+				else if (key == "up")
+					scene.vup = v.v;
+				else if (key == "defocus")
+					scene.defocus_angle = v.number();
+				else
+					scene.focus_dist = v.number();
+			}
+			return true;
+		}
+
+		bool for_loop(std::vector<shared_ptr<hittable>>& objects)
+		{
+			std::string_view name;
+			value low, high;
+			if (!expect_name(name, "a loop variable") || !expect("in") || !number_expression(low) || !expect("..")
+				|| !number_expression(high))
+				return false;
+			lexer_state body = cursor;
+			if (low.number() >= high.number())
+				return skip_block();
+			value& variable = assign(name, value());
+			for (double i = low.number(); i < high.number(); i++)
+			{
+				cursor = body;
+				variable = scalar(i);
+				if (!block(objects))
+					return false;
+			}
+			return true;
+		}
+
+		bool if_block(std::vector<shared_ptr<hittable>>& objects)
+		{
+			value condition;
+			if (!number_expression(condition))
+				return false;
+			bool taken = condition.number() != 0;
+			if (!(taken ? block(objects) : skip_block()))
+				return false;
+			if (!accept("else"))
+				return true;
+			if (accept("if"))
+			{
+				if (!taken)
+					return if_block(objects);
+				// Skips the whole chain, each condition and its block
+				while (true)
+				{
+					while (!at("{") && peek().kind != end_of_file)
+						next();
+					if (!skip_block())
+						return false;
+					if (!accept("else"))
+						return true;
+					if (!accept("if"))
+						return skip_block();
+				}
+			}
+			return taken ? skip_block() : block(objects);
+		}
+
+		// Objects
+
+		bool object_value(shared_ptr<hittable>& object)
+		{
+			token start = peek();
+			std::string_view kind;
+			if (!expect_name(kind, "an object"))
+				return false;
+
+			value a, b, c, d;
+			shared_ptr<material> mat;
+			if (kind == "sphere")
+			{
+				if (!vector_expression(a) || !number_expression(b) || !material_value(mat))
+					return false;
+				object = make_shared<sphere>(a.v, b.number(), mat);
+			}
+			else if (kind == "plane")
+			{
+				if (!vector_expression(a) || !vector_expression(b) || !material_value(mat))
+					return false;
+				object = make_shared<plane>(a.v, unit_vector(b.v), mat);
+			}
+			else if (kind == "box")
+			{
+				if (!vector_expression(a) || !vector_expression(b) || !material_value(mat))
+					return false;
+				object = make_shared<aabb_box>(a.v, b.v, mat);
+			}
+			else if (kind == "cone")
+			{
+				if (!vector_expression(a) || !vector_expression(b) || !number_expression(c) || !material_value(mat))
+					return false;
+				object = make_shared<cone>(a.v, b.v, c.number(), mat, !accept("open"));
+			}
+			else if (kind == "infinite_cone")
+			{
+				if (!vector_expression(a) || !vector_expression(b) || !number_expression(c) || !material_value(mat))
+					return false;
+				object = make_shared<infinite_cone>(a.v, unit_vector(b.v), c.number(), mat);
+			}
+			else if (kind == "cylinder")
+			{
+				if (!vector_expression(a) || !vector_expression(b) || !number_expression(c) || !number_expression(d)
+					|| !material_value(mat))
+					return false;
+				object = quadric::make_cylinder(a.v, b.v, c.number(), d.number(), mat);
+			}
+			else if (kind == "mesh")
+				return mesh_value(object);
+			else if (kind == "union" || kind == "intersection" || kind == "difference")
+				return csg_value(kind, object);
+			else if (kind == "instance")
+				return instance_value(object);
+			else
+				return fail_at(start, "unknown object '" + std::string(kind) + "'");
+			return true;
+		}
+
+		bool mesh_value(shared_ptr<hittable>& object)
+		{
+			if (peek().kind != string)
+				return fail("expected a quoted file name");
+			token file = next();
+			shared_ptr<material> mat;
+			if (!material_value(mat))
+				return false;
+
+			std::filesystem::path path(file.text);
+			if (path.is_relative() && !directory.empty())
+				path = std::filesystem::path(directory) / path;
+			std::string filename = path.string();
+			bool is_ply = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".ply") == 0;
+			shared_ptr<mesh_buffers> buffers = is_ply ? ply_loader::load(filename) : obj_loader::load(filename);
+			if (!buffers)
+				return fail_at(file, "could not load the mesh");
+			object = make_shared<triangle_mesh>(buffers, mat);
+			return true;
+		}
+
+		bool csg_value(std::string_view kind, shared_ptr<hittable>& object)
+		{
+			token start = peek();
+			std::vector<shared_ptr<hittable>> children;
+			if (!block(children))
+				return false;
+			if (children.empty())
+				return fail_at(start, std::string(kind) + " needs at least one object");
+
+			if (kind == "union")
+				object = csg_union::balanced(children);
+			else if (kind == "difference")
+			{
+				if (children.size() < 2)
+					return fail_at(start, "difference needs an object and something to cut from it");
+				std::vector<shared_ptr<hittable>> cuts(children.begin() + 1, children.end());
+				object = make_shared<csg_difference>(children[0], csg_union::balanced(cuts));
+			}
+			else
+			{
+				auto both = make_shared<hittable_intersection>();
+				for (const auto& child : children)
+					both->add(child);
+				object = both;
+			}
+			return true;
+		}
+
+		bool instance_value(shared_ptr<hittable>& object)
+		{
+			affine transform;
+			while (true)
+			{
+				value a, b;
+				if (accept("translate"))
+				{
+					if (!vector_expression(a))
+						return false;
+					transform = affine::translation(a.v) * transform;
+				}
+				else if (accept("rotate"))
+				{
+					if (!vector_expression(a) || !number_expression(b))
+						return false;
+					transform = affine::rotation(a.v, b.number()) * transform;
+				}
+				else if (accept("scale"))
+				{
+					if (!expression(a))
+						return false;
+					transform = (a.is_vector ? affine::scaling(a.v) : affine::scaling(a.number())) * transform;
+				}
+				else
+					break;
+			}
+
+			token start = peek();
+			std::vector<shared_ptr<hittable>> children;
+			if (!block(children))
+				return false;
+			if (children.empty())
+				return fail_at(start, "instance needs at least one object");
+			object = make_shared<instance>(children.size() == 1 ? children[0] : build_accelerator(children), transform);
+			return true;
+		}
+
+		// Materials
+
+		bool material_value(shared_ptr<material>& mat)
+		{
+			token start = peek();
+			std::string_view name;
+			if (!expect_name(name, "a material"))
+				return false;
+
+			value albedo, parameter;
+			material_kind kind;
+			if (name == "lambertian")
+			{
+				kind = material_kind::lambertian;
+				if (!vector_expression(albedo))
+					return false;
+			}
+			else if (name == "metal")
+			{
+				kind = material_kind::metal;
+				if (!vector_expression(albedo) || !number_expression(parameter))
+					return false;
+			}
+			else if (name == "dielectric")
+			{
+				kind = material_kind::dielectric;
+				if (!number_expression(parameter))
+					return false;
+			}
+			else
+			{
+				auto found = named_materials.find(name);
+				if (found == named_materials.end())
+					return fail_at(start, "no material named '" + std::string(name) + "'");
+				mat = found->second;
+				return true;
+			}
+
+			auto key = std::make_tuple(int(kind), albedo.v.x(), albedo.v.y(), albedo.v.z(), parameter.number());
+			auto found = distinct_materials.find(key);
+			if (found != distinct_materials.end())
+			{
+				mat = found->second;
+				return true;
+			}
+			if (kind == material_kind::lambertian)
+				mat = make_shared<lambertian>(albedo.v);
+			else if (kind == material_kind::metal)
+				mat = make_shared<metal>(albedo.v, parameter.number());
+			else
+				mat = make_shared<dielectric>(parameter.number());
+			distinct_materials.emplace(key, mat);
+			return true;
+		}
+
+		// Expressions, lowest precedence first
+
+		bool number_expression(value& v)
+		{
+			token start = peek();
+			if (!expression(v))
+				return false;
+			return v.is_vector ? fail_at(start, "expected a number, not a vector") : true;
+		}
+
+		bool vector_expression(value& v)
+		{
+			token start = peek();
+			if (!expression(v))
+				return false;
+			return v.is_vector ? true : fail_at(start, "expected a vector (x, y, z)");
+		}
+
+		bool expression(value& v)
+		{
+			if (!conjunction(v))
+				return false;
+			while (at("||"))
+			{
+				token op = next();
+				value rhs;
+				if (!conjunction(rhs) || !numbers(op, v, rhs))
+					return false;
+				v = scalar(v.number() != 0 || rhs.number() != 0);
+			}
+			return true;
+		}
+
+		bool conjunction(value& v)
+		{
+			if (!comparison(v))
+				return false;
+			while (at("&&"))
+			{
+				token op = next();
+				value rhs;
+				if (!comparison(rhs) || !numbers(op, v, rhs))
+					return false;
+				v = scalar(v.number() != 0 && rhs.number() != 0);
+			}
+			return true;
+		}
+
+		bool comparison(value& v)
+		{
+			if (!sum(v))
+				return false;
+			while (at("<") || at(">") || at("<=") || at(">=") || at("==") || at("!="))
+			{
+				token op = next();
+				value rhs;
+				if (!sum(rhs) || !numbers(op, v, rhs))
+					return false;
+				double x = v.number(), y = rhs.number();
+				char c0 = op.text[0], c1 = op.text.size() > 1 ? op.text[1] : 0;
+				bool result = c0 == '<' ? (c1 ? x <= y : x < y) : c0 == '>' ? (c1 ? x >= y : x > y) : c0 == '=' ? x == y : x != y;
+				v = scalar(result);
+			}
+			return true;
+		}
+
+		bool sum(value& v)
+		{
+			if (!product(v))
+				return false;
+			while (at("+") || at("-"))
+			{
+				bool add = next().text == "+";
+				value rhs;
+				if (!product(rhs))
+					return false;
+				combine(v, rhs, [add](double x, double y) { return add ? x + y : x - y; });
+			}
+			return true;
+		}
+
+		bool product(value& v)
+		{
+			if (!unary(v))
+				return false;
+			while (at("*") || at("/"))
+			{
+				bool multiply = next().text == "*";
+				value rhs;
+				if (!unary(rhs))
+					return false;
+				combine(v, rhs, [multiply](double x, double y) { return multiply ? x * y : x / y; });
+			}
+			return true;
+		}
+
+		bool unary(value& v)
+		{
+			if (accept("-"))
+			{
+				if (!unary(v))
+					return false;
+				v.v = -v.v;
+				return true;
+			}
+			if (at("!"))
+			{
+				token op = next();
+				if (!unary(v) || !numbers(op, v, v))
+					return false;
+				v = scalar(v.number() == 0);
+				return true;
+			}
+			return primary(v);
+		}
+
+		bool primary(value& v)
+		{
+			token t = peek();
+			if (t.kind == number)
+			{
+				v = scalar(next().value);
+				return true;
+			}
+			if (accept("("))
+			{
+				value y, z;
+				if (!expression(v))
+					return false;
+				if (accept(")"))
+					return true;
+				if (!expect(",") || !number_expression(y) || !expect(",") || !number_expression(z) || !expect(")"))
+					return false;
+				if (v.is_vector)
+					return fail_at(t, "vector components must be numbers");
+				v = value{ vec3(v.number(), y.number(), z.number()), true };
+				return true;
+			}
+			if (t.kind != identifier)
+				return fail("expected a value");
+
+			std::string_view name = next().text;
+			if (at("("))
+				return call(t, name, v);
+			if (name == "pi")
+			{
+				v = scalar(pi);
+				return true;
+			}
+			auto found = variables.find(name);
+			if (found == variables.end())
+				return fail_at(t, "no variable named '" + std::string(name) + "'");
+			v = found->second;
+			return true;
+		}
+
+		bool call(const token& t, std::string_view name, value& v)
+		{
+			// No function takes more than two, the third slot only catches a call with too many
+			value args[3];
+			size_t count = 0;
+			next();
+			if (!accept(")"))
+			{
+				do
+				{
+					if (!expression(args[std::min<size_t>(count, 2)]))
+						return false;
+					count++;
+				} while (accept(","));
+				if (!expect(")"))
+					return false;
+			}
+
+			auto arity = [&](size_t n, bool vectors = false)
+			{
+				if (count != n)
+					return fail_at(t, std::string(name) + " takes " + std::to_string(n) + " argument" + (n == 1 ? "" : "s"));
+				for (size_t i = 0; i < n; i++)
+				{
+					if (args[i].is_vector != vectors)
+						return fail_at(t, std::string(name) + (vectors ? " takes vectors" : " takes numbers"));
+				}
+				return true;
+			};
+			if (name == "random")
+			{
+				if (count == 0)
+					v = scalar(random_double());
+				else if (arity(2))
+					v = scalar(random_double(args[0].number(), args[1].number()));
+				else
+					return false;
+				return true;
+			}
+			if (name == "length")
+			{
+				if (!arity(1, true))
+					return false;
+				v = scalar(args[0].v.length());
+				return true;
+			}
+			if (name == "dot")
+			{
+				if (!arity(2, true))
+					return false;
+				v = scalar(::dot(args[0].v, args[1].v));
+				return true;
+			}
+			if (name == "min" || name == "max")
+			{
+				if (!arity(2))
+					return false;
+				v = scalar(name == "min" ? std::fmin(args[0].number(), args[1].number()) : std::fmax(args[0].number(), args[1].number()));
+				return true;
+			}
+
+			static const std::unordered_map<std::string_view, double (*)(double)> functions = {
+				{ "sqrt", [](double x) { return std::sqrt(x); } },
+				{ "sin", [](double x) { return std::sin(x); } },
+				{ "cos", [](double x) { return std::cos(x); } },
+				{ "abs", [](double x) { return std::fabs(x); } },
+				{ "floor", [](double x) { return std::floor(x); } },
+				{ "radians", [](double x) { return degrees_to_radians(x); } },
+			};
+			auto found = functions.find(name);
+			if (found == functions.end())
+				return fail_at(t, "no function named '" + std::string(name) + "'");
+			if (!arity(1))
+				return false;
+			v = scalar(found->second(args[0].number()));
+			return true;
+		}
+
+		value& assign(std::string_view name, const value& v)
+		{
+			auto found = variables.find(name);
+			if (found == variables.end())
+				found = variables.emplace(std::string(name), v).first;
+			else
+				found->second = v;
+			return found->second;
+		}
+
+		static value scalar(double x)
+		{
+			return value{ vec3(x, 0, 0), false };
+		}
+
+		// Applies op per component, spreading a number over the other side's vector
+		template <typename operation>
+		static void combine(value& v, const value& rhs, operation&& op)
+		{
+			if (!v.is_vector && !rhs.is_vector)
+			{
+				v.v[0] = op(v.number(), rhs.number());
+				return;
+			}
+			vec3 a = v.is_vector ? v.v : vec3(v.number(), v.number(), v.number());
+			vec3 b = rhs.is_vector ? rhs.v : vec3(rhs.number(), rhs.number(), rhs.number());
+			v = value{ vec3(op(a.x(), b.x()), op(a.y(), b.y()), op(a.z(), b.z())), true };
+		}
+
+		bool numbers(const token& op, const value& a, const value& b)
+		{
+			if (a.is_vector || b.is_vector)
+				return fail_at(op, "'" + std::string(op.text) + "' takes numbers, not vectors");
+			return true;
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,438 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef SDF_H
+#define SDF_H
+
+#include "hittable.h"
+#include "stats.h"
+
+#include <algorithm>
+
+/*
+ * Node of a signed distance expression, negative inside. Every node reports a Lipschitz bound,
+ * how fast its value can change per unit of distance, so tracing can scale its steps to stay
+ * safe under operators that stretch space, and a box that holds its whole surface.
+ */
+class sdf_node
+{
+  public:
+	virtual ~sdf_node() = default;
+
+	virtual double distance(const point3& p) const = 0;
+	virtual double lipschitz() const { return 1; }
+	virtual aabb bounds() const = 0;
+
+  protected:
+	static aabb grow(const aabb& box, double reach)
+	{
+		vec3 r(reach, reach, reach);
+		return aabb(point3(box.x.min, box.y.min, box.z.min) - r, point3(box.x.max, box.y.max, box.z.max) + r);
+	}
+};
+
+class sdf_sphere : public sdf_node
+{
+  public:
+	sdf_sphere(const point3& center, double radius) : center(center), radius(radius) {}
+
+	double distance(const point3& p) const override
+	{
+		return (p - center).length() - radius;
+	}
+
+	aabb bounds() const override
+	{
+		return grow(aabb(center, center), radius);
+	}
+
+  private:
+	point3 center;
+	double radius;
+};
+
+/* Box with edges rounded off to a radius, which stays within the half extents */
+class sdf_box : public sdf_node
+{
+  public:
+	sdf_box(const point3& center, const vec3& half_extents, double rounding = 0)
+		: center(center), half_extents(half_extents), rounding(rounding) {}
+
+	double distance(const point3& p) const override
+	{
+		vec3 d = p - center;
+		vec3 q(std::fabs(d.x()) - half_extents.x() + rounding, std::fabs(d.y()) - half_extents.y() + rounding,
+			   std::fabs(d.z()) - half_extents.z() + rounding);
+		vec3 outside(std::fmax(q.x(), 0.0), std::fmax(q.y(), 0.0), std::fmax(q.z(), 0.0));
+		return outside.length() + std::fmin(std::fmax(q.x(), std::fmax(q.y(), q.z())), 0.0) - rounding;
+	}
+
+	aabb bounds() const override
+	{
+		return aabb(center - half_extents, center + half_extents);
+	}
+
+  private:
+	point3 center;
+	vec3 half_extents;
+	double rounding;
+};
+
+/* Ring around the y axis through the center */
+class sdf_torus : public sdf_node
+{
+  public:
+	sdf_torus(const point3& center, double major_radius, double minor_radius)
+		: center(center), major_radius(major_radius), minor_radius(minor_radius) {}
+
+	double distance(const point3& p) const override
+	{
+		vec3 d = p - center;
+		double ring = std::sqrt(d.x() * d.x() + d.z() * d.z()) - major_radius;
+		return std::sqrt(ring * ring + d.y() * d.y()) - minor_radius;
+	}
+
+	aabb bounds() const override
+	{
+		double outer = major_radius + minor_radius;
+		return aabb(center - vec3(outer, minor_radius, outer), center + vec3(outer, minor_radius, outer));
+	}
+
+  private:
+	point3 center;
+	double major_radius, minor_radius;
+};
+
+/* Menger sponge filling a cube, each iteration carving the cross-shaped holes three times finer */
+class sdf_menger : public sdf_node
+{
+  public:
+	sdf_menger(const point3& center, double half_size, int iterations)
+		: center(center), half_size(half_size), iterations(iterations) {}
+
+	double distance(const point3& p) const override
+	{
+		// Work in the unit cube, distances scale back by half_size
+		vec3 q = (p - center) / half_size;
+		vec3 a(std::fabs(q.x()) - 1, std::fabs(q.y()) - 1, std::fabs(q.z()) - 1);
+		vec3 outside(std::fmax(a.x(), 0.0), std::fmax(a.y(), 0.0), std::fmax(a.z(), 0.0));
+		double d = outside.length() + std::fmin(std::fmax(a.x(), std::fmax(a.y(), a.z())), 0.0);
+
+		double scale = 1;
+		for (int i = 0; i < iterations; i++)
+		{
+			// Fold into one cell of the current level, centered on the origin
+			vec3 cell;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				double x = q[axis] * scale;
+				cell[axis] = x - 2 * std::floor(x / 2) - 1;
+			}
+			scale *= 3;
+			vec3 r(std::fabs(1 - 3 * std::fabs(cell.x())), std::fabs(1 - 3 * std::fabs(cell.y())),
+				   std::fabs(1 - 3 * std::fabs(cell.z())));
+			double hole = (std::fmin(std::fmax(r.x(), r.y()), std::fmin(std::fmax(r.y(), r.z()), std::fmax(r.z(), r.x()))) - 1) / scale;
+			d = std::fmax(d, hole);
+		}
+		return d * half_size;
+	}
+
+	aabb bounds() const override
+	{
+		return grow(aabb(center, center), half_size);
+	}
+
+  private:
+	point3 center;
+	double half_size;
+	int iterations;
+};
+
+/* Shared shape of the two-child operators */
+class sdf_binary : public sdf_node
+{
+  public:
+	sdf_binary(shared_ptr<sdf_node> a, shared_ptr<sdf_node> b) : a(a), b(b) {}
+
+	double lipschitz() const override
+	{
+		return std::fmax(a->lipschitz(), b->lipschitz());
+	}
+
+  protected:
+	shared_ptr<sdf_node> a, b;
+};
+
+class sdf_union : public sdf_binary
+{
+  public:
+	using sdf_binary::sdf_binary;
+
+	double distance(const point3& p) const override
+	{
+		return std::fmin(a->distance(p), b->distance(p));
+	}
+
+	aabb bounds() const override
+	{
+		return aabb(a->bounds(), b->bounds());
+	}
+};
+
+class sdf_intersection : public sdf_binary
+{
+  public:
+	using sdf_binary::sdf_binary;
+
+	double distance(const point3& p) const override
+	{
+		return std::fmax(a->distance(p), b->distance(p));
+	}
+
+	aabb bounds() const override
+	{
+		return aabb::intersect(a->bounds(), b->bounds());
+	}
+};
+
+/* The first shape with the second carved out of it */
+class sdf_difference : public sdf_binary
+{
+  public:
+	using sdf_binary::sdf_binary;
+
+	double distance(const point3& p) const override
+	{
+		return std::fmax(a->distance(p), -b->distance(p));
+	}
+
+	aabb bounds() const override
+	{
+		return a->bounds();
+	}
+};
+
+/* Union that fills in the crease where the shapes meet over a blend width */
+class sdf_blend : public sdf_binary
+{
+  public:
+	sdf_blend(shared_ptr<sdf_node> a, shared_ptr<sdf_node> b, double width) : sdf_binary(a, b), width(width) {}
+
+	// Polynomial smooth minimum, its gradient mixes the children's so their bound still holds
+	double distance(const point3& p) const override
+	{
+		double da = a->distance(p), db = b->distance(p);
+		double h = std::fmax(width - std::fabs(da - db), 0.0) / width;
+		return std::fmin(da, db) - 0.25 * width * h * h;
+	}
+
+	// The fill dips at most width / 4 below either child
+	aabb bounds() const override
+	{
+		return grow(aabb(a->bounds(), b->bounds()), 0.25 * width);
+	}
+
+  private:
+	double width;
+};
+
+/* Rotates each horizontal slice about the y axis by an angle growing with its height */
+class sdf_twist : public sdf_node
+{
+  public:
+	sdf_twist(shared_ptr<sdf_node> child, double radians_per_unit) : child(child), rate(radians_per_unit)
+	{
+		// Every slice can turn all the way round, so the box becomes the cylinder around the child's box
+		aabb box = child->bounds();
+		double x = std::fmax(std::fabs(box.x.min), std::fabs(box.x.max));
+		double z = std::fmax(std::fabs(box.z.min), std::fabs(box.z.max));
+		reach = std::sqrt(x * x + z * z);
+	}
+
+	double distance(const point3& p) const override
+	{
+		double angle = rate * p.y();
+		double c = std::cos(angle), s = std::sin(angle);
+		return child->distance(point3(c * p.x() - s * p.z(), p.y(), s * p.x() + c * p.z()));
+	}
+
+	// A shear of k = rate * r stretches lengths by at most its largest singular value. Marches stay in
+	// bounds(), the square of half width reach, so r runs out to its corners at reach * sqrt(2)
+	double lipschitz() const override
+	{
+		double half_shear = 0.5 * std::fabs(rate) * reach * std::sqrt(2.0);
+		return child->lipschitz() * (half_shear + std::sqrt(1 + half_shear * half_shear));
+	}
+
+	aabb bounds() const override
+	{
+		aabb box = child->bounds();
+		return aabb(interval(-reach, reach), box.y, interval(-reach, reach));
+	}
+
+  private:
+	shared_ptr<sdf_node> child;
+	double rate;
+	double reach;
+};
+
+/* Ripples the surface by up to an amplitude with a product of sines */
+class sdf_displace : public sdf_node
+{
+  public:
+	sdf_displace(shared_ptr<sdf_node> child, double amplitude, double frequency)
+		: child(child), amplitude(amplitude), frequency(frequency) {}
+
+	double distance(const point3& p) const override
+	{
+		return child->distance(p)
+			+ amplitude * std::sin(frequency * p.x()) * std::sin(frequency * p.y()) * std::sin(frequency * p.z());
+	}
+
+	double lipschitz() const override
+	{
+		return child->lipschitz() + std::fabs(amplitude * frequency) * std::sqrt(3.0);
+	}
+
+	aabb bounds() const override
+	{
+		return grow(child->bounds(), std::fabs(amplitude));
+	}
+
+  private:
+	shared_ptr<sdf_node> child;
+	double amplitude, frequency;
+};
+
+/*
+ * Surface of a distance expression, found by sphere tracing: each step goes as far as the
+ * distance divided by the Lipschitz bound, which cannot cross the surface. The march only
+ * runs where the ray is inside the expression's box.
+ *
+ * Over-relaxation stretches each step by the relaxation factor. When the spheres of two
+ * consecutive steps stop overlapping, or the stretched step crossed the surface, that step
+ * is redone at the plain length and the rest of the march stays plain. A relaxation of 1
+ * traces plainly.
+ */
+class distance_field : public hittable
+{
+  public:
+	double tolerance = 1e-5; // Distance at which a march counts as having reached the surface
+	int max_steps = 512;     // Marches that take longer are treated as misses
+
+	distance_field(shared_ptr<sdf_node> root, shared_ptr<material> mat, double relaxation = 1.2)
+		: root(root), mat(mat), relaxation(relaxation), bbox(root->bounds()), inverse_lipschitz(1 / root->lipschitz()) {}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		const vec3& d = r.direction();
+		interval clipped = ray_t;
+		if (!bbox.hit(r.origin(), r.inverse_direction(), clipped))
+			return false;
+
+		// March in units of distance, t only scales back at the end
+		double speed = d.length();
+		vec3 step_direction = d / speed;
+		double s = clipped.min * speed, s_end = clipped.max * speed;
+		auto bound = [&](double at) { return root->distance(r.origin() + at * step_direction) * inverse_lipschitz; };
+
+		int steps = 0;
+		double radius = bound(s);
+		steps++;
+
+		// Rays leaving a surface start on it, so step off before deciding which side they march on.
+		// A ray entering the box on a face the surface lies in has simply hit it.
+		bool starts_inside_box = clipped.min == ray_t.min;
+		while (starts_inside_box && std::fabs(radius) < 2 * tolerance && steps < 16 && s < s_end)
+		{
+			s += 2 * tolerance;
+			radius = bound(s);
+			steps++;
+		}
+		// Inside, the march looks for where the ray leaves. Rays from outside the box start outside the solid.
+		double side = starts_inside_box && radius < 0 ? -1 : 1;
+		radius *= side;
+
+		double omega = relaxation;
+		double previous_radius = 0, previous_s = s, step = 0;
+		bool found = false;
+		while (steps < max_steps)
+		{
+			// A stretched step is unsafe once its sphere misses the previous one, or it ended past the surface or the box
+			bool overshot = s > s_end || radius < 0 || radius + previous_radius < step;
+			if (omega > 1 && step > 0 && overshot)
+			{
+				omega = 1;
+				s = previous_s + previous_radius;
+				radius = side * bound(s);
+				steps++;
+				continue;
+			}
+			if (s > s_end)
+				break;
+			if (radius < tolerance)
+			{
+				// Only a surface the ray goes on into counts. Grazing passes, and the seams where bounds
+				// such as the sponge's dip to zero inside without crossing, grow again just beyond.
+				double ahead = side * bound(s + 10 * tolerance);
+				steps++;
+				if (ahead < radius)
+				{
+					found = true;
+					break;
+				}
+				s += 10 * tolerance;
+				radius = ahead;
+				step = 0;
+				continue;
+			}
+			previous_s = s;
+			previous_radius = radius;
+			step = omega * radius;
+			s += step;
+			radius = side * bound(s);
+			steps++;
+		}
+		ray_stats.march_steps += steps;
+		ray_stats.marched_rays++;
+		if (!found)
+			return false;
+
+		rec.t = s / speed;
+		rec.p = r.at(rec.t);
+		rec.set_face_normal(r, gradient(rec.p));
+		rec.mat = mat;
+		return true;
+	}
+
+	virtual bool volume_contains(const point3 p) const override
+	{
+		return root->distance(p) <= 0;
+	}
+
+	aabb bounding_box() const override
+	{
+		return bbox;
+	}
+
+  private:
+	shared_ptr<sdf_node> root;
+	shared_ptr<material> mat;
+	double relaxation;
+	aabb bbox;
+	double inverse_lipschitz;
+
+	// Outward normal from the tetrahedral difference of four samples
+	vec3 gradient(const point3& p) const
+	{
+		double h = 10 * tolerance;
+		vec3 k0(1, -1, -1), k1(-1, -1, 1), k2(-1, 1, -1), k3(1, 1, 1);
+		vec3 g = k0 * root->distance(p + h * k0) + k1 * root->distance(p + h * k1) + k2 * root->distance(p + h * k2)
+			+ k3 * root->distance(p + h * k3);
+		double length = g.length();
+		return length > 0 ? g / length : vec3(0, 1, 0);
+	}
+};
+
+#endif
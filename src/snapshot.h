@@ -0,0 +1,477 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "bvh.h"
+#include "camera.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "mapped_file.h"
+#include "material.h"
+#include "mesh.h"
+#include "plane.h"
+#include "sphere.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Built scene saved as one file that is mapped and traced where it lies: the camera, the
+ * materials, spheres, planes and triangles, and a BVH over the bounded primitives. Every section
+ * is plain data at a fixed offset from the start of the file, and nodes refer to each other and
+ * to primitives by index, so opening a snapshot checks its header and points at the sections
+ * without reading, parsing or rebuilding anything. Pages load as rays first touch them. Only the
+ * header and section table are checked, the records themselves are trusted like a checkpoint's.
+ *
+ * Snapshots are written and read by the same build on the same kind of machine, a file from
+ * another byte order or format version is refused rather than converted.
+ */
+class scene_snapshot : public hittable
+{
+  public:
+	static const uint32_t version = 1;
+	static const uint32_t byte_order_mark = 0x01020304;
+	static const size_t alignment = 64; // Sections start on cache lines
+
+	// Section of count records starting offset bytes into the file
+	struct section
+	{
+		uint64_t offset = 0;
+		uint64_t count = 0;
+	};
+
+	struct camera_record
+	{
+		int32_t image_width, image_height, samples_per_pixel, max_depth;
+		double vfov;
+		double lookfrom[3], lookat[3], vup[3];
+		double defocus_angle, focus_dist;
+	};
+
+	struct header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint64_t file_size;
+		camera_record camera;
+		section materials, spheres, planes, vertices, triangles, nodes, indices;
+	};
+
+	struct material_record
+	{
+		uint32_t kind; // A material_kind
+		uint32_t unused;
+		double albedo[3];
+		double parameter;
+	};
+
+	struct sphere_record
+	{
+		double center[3];
+		double radius;
+		uint32_t material;
+		uint32_t unused;
+	};
+
+	struct plane_record
+	{
+		double point[3];
+		double normal[3];
+		uint32_t material;
+		uint32_t unused;
+	};
+
+	struct triangle_record
+	{
+		uint32_t corners[3]; // Into the vertex section, three floats each
+		uint32_t material;
+	};
+
+	/*
+	 * Writes the objects and camera to filename, building the BVH on the way. Lists are flattened,
+	 * triangle meshes keep their positions but not their normals or uvs, and any other object or a
+	 * material other than the built-in ones fails with a message.
+	 */
+	static bool write(const std::string& filename, const std::vector<shared_ptr<hittable>>& objects, const camera& cam)
+	{
+		scene_writer scene;
+		for (const auto& object : objects)
+		{
+			if (!scene.add(object))
+				return false;
+		}
+
+		// Spheres come first in the BVH's primitive numbering, triangles after them
+		std::vector<aabb> boxes;
+		boxes.reserve(scene.spheres.size() + scene.triangles.size());
+		for (const auto& s : scene.spheres)
+		{
+			vec3 r(s.radius, s.radius, s.radius);
+			point3 c(s.center[0], s.center[1], s.center[2]);
+			boxes.push_back(aabb(c - r, c + r));
+		}
+		for (const auto& t : scene.triangles)
+		{
+			point3 p[3];
+			for (int k = 0; k < 3; k++)
+				p[k] = vertex(scene.vertices.data(), t.corners[k]);
+			boxes.push_back(aabb(aabb(p[0], p[1]), aabb(p[2], p[2])));
+		}
+		bvh_tree tree;
+		tree.build(boxes);
+
+		header h = {};
+		std::memcpy(h.magic, magic, sizeof(h.magic));
+		h.version = version;
+		h.byte_order = byte_order_mark;
+		h.camera = {
+			cam.image_width, cam.image_height, cam.samples_per_pixel, cam.max_depth, cam.vfov,
+			{ cam.lookfrom.x(), cam.lookfrom.y(), cam.lookfrom.z() },
+			{ cam.lookat.x(), cam.lookat.y(), cam.lookat.z() },
+			{ cam.vup.x(), cam.vup.y(), cam.vup.z() },
+			cam.defocus_angle, cam.focus_dist
+		};
+
+		uint64_t end = align(sizeof(header));
+		auto place = [&end](section& s, size_t count, size_t record_size)
+		{
+			s = { end, count };
+			end = align(end + count * record_size);
+		};
+		place(h.materials, scene.materials.size(), sizeof(material_record));
+		place(h.spheres, scene.spheres.size(), sizeof(sphere_record));
+		place(h.planes, scene.planes.size(), sizeof(plane_record));
+		place(h.vertices, scene.vertices.size() / 3, 3 * sizeof(float));
+		place(h.triangles, scene.triangles.size(), sizeof(triangle_record));
+		place(h.nodes, tree.nodes.size(), sizeof(bvh_node));
+		place(h.indices, tree.indices.size(), sizeof(uint32_t));
+		h.file_size = end;
+
+		std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cerr << "Could not write " << filename << "\n";
+			return false;
+		}
+		auto put = [&out](const section& s, const void* data, size_t bytes)
+		{
+			out.seekp(std::streamoff(s.offset));
+			out.write(static_cast<const char*>(data), std::streamsize(bytes));
+		};
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		put(h.materials, scene.materials.data(), scene.materials.size() * sizeof(material_record));
+		put(h.spheres, scene.spheres.data(), scene.spheres.size() * sizeof(sphere_record));
+		put(h.planes, scene.planes.data(), scene.planes.size() * sizeof(plane_record));
+		put(h.vertices, scene.vertices.data(), scene.vertices.size() * sizeof(float));
+		put(h.triangles, scene.triangles.data(), scene.triangles.size() * sizeof(triangle_record));
+		put(h.nodes, tree.nodes.data(), tree.nodes.size() * sizeof(bvh_node));
+		put(h.indices, tree.indices.data(), tree.indices.size() * sizeof(uint32_t));
+
+		// Pads the last section out to the size the header promises
+		out.seekp(std::streamoff(h.file_size - 1));
+		out.put(0);
+		if (!out)
+		{
+			std::cerr << "Could not write " << filename << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	/* Maps a snapshot for tracing, nullptr with a message when it cannot be used */
+	static shared_ptr<scene_snapshot> open(const std::string& filename)
+	{
+		auto file = make_shared<mapped_file>(filename);
+		if (!file->valid())
+		{
+			std::cerr << "Could not map " << filename << "\n";
+			return nullptr;
+		}
+		if (file->size() < sizeof(header))
+		{
+			std::cerr << filename << " is too short to be a scene snapshot\n";
+			return nullptr;
+		}
+		const header& h = *reinterpret_cast<const header*>(file->data());
+		if (std::memcmp(h.magic, magic, sizeof(h.magic)) != 0)
+		{
+			std::cerr << filename << " is not a scene snapshot\n";
+			return nullptr;
+		}
+		if (h.version != version || h.byte_order != byte_order_mark)
+		{
+			std::cerr << filename << " is a snapshot of another version or byte order, write it again\n";
+			return nullptr;
+		}
+		if (h.file_size != file->size()
+			|| !fits(h.materials, sizeof(material_record), h.file_size) || !fits(h.spheres, sizeof(sphere_record), h.file_size)
+			|| !fits(h.planes, sizeof(plane_record), h.file_size) || !fits(h.vertices, 3 * sizeof(float), h.file_size)
+			|| !fits(h.triangles, sizeof(triangle_record), h.file_size) || !fits(h.nodes, sizeof(bvh_node), h.file_size)
+			|| !fits(h.indices, sizeof(uint32_t), h.file_size))
+		{
+			std::cerr << filename << " is truncated or its section table is damaged\n";
+			return nullptr;
+		}
+		return shared_ptr<scene_snapshot>(new scene_snapshot(file));
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		bool hit_anything = false;
+		for (const auto& p : planes)
+		{
+			if (p->hit(r, ray_t, rec))
+			{
+				hit_anything = true;
+				ray_t.max = rec.t;
+			}
+		}
+
+		watertight_ray w(r);
+		uint32_t hit_primitive = 0;
+		double hit_b1 = 0, hit_b2 = 0;
+		bool hit_bounded = tree.traverse(r, ray_t, [&](uint32_t i, interval& t)
+		{
+			if (i < sphere_count)
+			{
+				const sphere_record& s = spheres[i];
+				vec3 oc = point3(s.center[0], s.center[1], s.center[2]) - r.origin();
+				double a = r.direction().length_squared();
+				double b = -2.0 * dot(r.direction(), oc);
+				double c = oc.length_squared() - s.radius * s.radius;
+				if (!solve_quadratic(r, t, rec, a, b, c))
+					return false;
+			}
+			else
+			{
+				const triangle_record& tri = triangles[i - sphere_count];
+				double distance, b1, b2;
+				if (!intersect_triangle(w, vertex(vertices, tri.corners[0]), vertex(vertices, tri.corners[1]),
+										vertex(vertices, tri.corners[2]), t, distance, b1, b2))
+					return false;
+				rec.t = distance;
+				hit_b1 = b1;
+				hit_b2 = b2;
+			}
+			t.max = rec.t;
+			hit_primitive = i;
+			return true;
+		});
+		if (!hit_bounded)
+			return hit_anything;
+
+		// Surface details only for the nearest primitive
+		if (hit_primitive < sphere_count)
+		{
+			const sphere_record& s = spheres[hit_primitive];
+			rec.set_face_normal(r, (rec.p - point3(s.center[0], s.center[1], s.center[2])) / s.radius);
+			rec.mat = materials[s.material];
+			return true;
+		}
+		const triangle_record& tri = triangles[hit_primitive - sphere_count];
+		point3 p0 = vertex(vertices, tri.corners[0]), p1 = vertex(vertices, tri.corners[1]), p2 = vertex(vertices, tri.corners[2]);
+		rec.p = r.at(rec.t);
+		rec.u = hit_b1;
+		rec.v = hit_b2;
+		rec.set_face_normal(r, unit_vector(cross(p1 - p0, p2 - p0)));
+		rec.mat = materials[tri.material];
+		return true;
+	}
+
+	/* Treated as a surface, like the meshes it holds */
+	bool volume_contains(const point3) const override
+	{
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		return planes.empty() ? tree.bounds() : aabb::universe;
+	}
+
+	/* Sets the camera up as it was when the snapshot was written */
+	void configure(camera& cam) const
+	{
+		const camera_record& c = layout().camera;
+		cam.image_width = c.image_width;
+		cam.image_height = c.image_height;
+		cam.samples_per_pixel = c.samples_per_pixel;
+		cam.max_depth = c.max_depth;
+		cam.vfov = c.vfov;
+		cam.lookfrom = point3(c.lookfrom[0], c.lookfrom[1], c.lookfrom[2]);
+		cam.lookat = point3(c.lookat[0], c.lookat[1], c.lookat[2]);
+		cam.vup = vec3(c.vup[0], c.vup[1], c.vup[2]);
+		cam.defocus_angle = c.defocus_angle;
+		cam.focus_dist = c.focus_dist;
+	}
+
+	size_t sphere_total() const { return sphere_count; }
+	size_t triangle_total() const { return layout().triangles.count; }
+	size_t file_size() const { return file->size(); }
+
+  private:
+	static constexpr char magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+
+	static_assert(std::is_trivially_copyable_v<bvh_node> && std::is_standard_layout_v<bvh_node>,
+				  "BVH nodes are written to snapshots byte for byte");
+
+	shared_ptr<mapped_file> file;
+	const sphere_record* spheres = nullptr;
+	const float* vertices = nullptr;
+	const triangle_record* triangles = nullptr;
+	uint32_t sphere_count = 0;
+	bvh_view tree;
+
+	// Built on opening, there are only a handful and they are objects with behaviour rather than data
+	std::vector<shared_ptr<material>> materials;
+	std::vector<shared_ptr<plane>> planes;
+
+	explicit scene_snapshot(shared_ptr<mapped_file> mapped) : file(std::move(mapped))
+	{
+		const header& h = layout();
+		auto at = [this](const section& s) { return file->data() + s.offset; };
+		spheres = reinterpret_cast<const sphere_record*>(at(h.spheres));
+		sphere_count = uint32_t(h.spheres.count);
+		vertices = reinterpret_cast<const float*>(at(h.vertices));
+		triangles = reinterpret_cast<const triangle_record*>(at(h.triangles));
+		tree = bvh_view{ reinterpret_cast<const bvh_node*>(at(h.nodes)), reinterpret_cast<const uint32_t*>(at(h.indices)),
+						 size_t(h.nodes.count) };
+
+		auto records = reinterpret_cast<const material_record*>(at(h.materials));
+		for (uint64_t i = 0; i < h.materials.count; i++)
+		{
+			const material_record& m = records[i];
+			color albedo(m.albedo[0], m.albedo[1], m.albedo[2]);
+			switch (material_kind(m.kind))
+			{
+			case material_kind::metal:
+				materials.push_back(make_shared<metal>(albedo, m.parameter));
+				break;
+			case material_kind::dielectric:
+				materials.push_back(make_shared<dielectric>(m.parameter));
+				break;
+			default:
+				materials.push_back(make_shared<lambertian>(albedo));
+				break;
+			}
+		}
+		auto plane_records = reinterpret_cast<const plane_record*>(at(h.planes));
+		for (uint64_t i = 0; i < h.planes.count; i++)
+		{
+			const plane_record& p = plane_records[i];
+			planes.push_back(make_shared<plane>(point3(p.point[0], p.point[1], p.point[2]),
+												vec3(p.normal[0], p.normal[1], p.normal[2]), materials[p.material]));
+		}
+	}
+
+	const header& layout() const { return *reinterpret_cast<const header*>(file->data()); }
+
+	static uint64_t align(uint64_t offset) { return (offset + alignment - 1) / alignment * alignment; }
+
+	static bool fits(const section& s, size_t record_size, uint64_t file_size)
+	{
+		return s.offset % alignment == 0 && s.offset <= file_size && s.count <= (file_size - s.offset) / record_size;
+	}
+
+	static point3 vertex(const float* vertices, uint32_t v)
+	{
+		return point3(vertices[3 * v], vertices[3 * v + 1], vertices[3 * v + 2]);
+	}
+
+	// Scene flattened into records, with each distinct material stored once
+	struct scene_writer
+	{
+		std::vector<material_record> materials;
+		std::vector<sphere_record> spheres;
+		std::vector<plane_record> planes;
+		std::vector<float> vertices;
+		std::vector<triangle_record> triangles;
+		std::unordered_map<const material*, uint32_t> material_index;
+
+		bool add(const shared_ptr<hittable>& object)
+		{
+			// Only plain lists, intersections derive from them but mean something else
+			if (typeid(*object) == typeid(hittable_list))
+			{
+				for (const auto& child : static_cast<const hittable_list&>(*object).objects)
+				{
+					if (!add(child))
+						return false;
+				}
+				return true;
+			}
+			if (auto s = dynamic_cast<const sphere*>(object.get()))
+			{
+				uint32_t m;
+				if (!add_material(s->surface_material(), m))
+					return false;
+				const point3& c = s->sphere_center();
+				spheres.push_back({ { c.x(), c.y(), c.z() }, s->sphere_radius(), m, 0 });
+				return true;
+			}
+			if (auto p = dynamic_cast<const plane*>(object.get()))
+			{
+				uint32_t m;
+				if (!add_material(p->surface_material(), m))
+					return false;
+				const point3& c = p->point();
+				const vec3& n = p->outward_normal();
+				planes.push_back({ { c.x(), c.y(), c.z() }, { n.x(), n.y(), n.z() }, m, 0 });
+				return true;
+			}
+			if (auto mesh = dynamic_cast<const triangle_mesh*>(object.get()))
+			{
+				uint32_t m;
+				if (!add_material(mesh->surface_material(), m))
+					return false;
+				const mesh_buffers& buffers = mesh->geometry();
+				uint32_t first = uint32_t(vertices.size() / 3);
+				for (uint32_t v = 0; v < buffers.vertex_count; v++)
+				{
+					point3 p = buffers.position(v);
+					vertices.insert(vertices.end(), { float(p.x()), float(p.y()), float(p.z()) });
+				}
+				for (uint32_t t = 0; t < buffers.triangle_count; t++)
+				{
+					uint32_t c[3];
+					buffers.corners(t, c);
+					triangles.push_back({ { first + c[0], first + c[1], first + c[2] }, m });
+				}
+				return true;
+			}
+			std::cerr << "Snapshots hold spheres, planes and triangle meshes, not " << typeid(*object).name() << "\n";
+			return false;
+		}
+
+		bool add_material(const shared_ptr<material>& mat, uint32_t& index)
+		{
+			auto found = material_index.find(mat.get());
+			if (found != material_index.end())
+			{
+				index = found->second;
+				return true;
+			}
+			material_description d = mat ? mat->describe() : material_description();
+			if (d.kind == material_kind::other)
+			{
+				std::cerr << "Snapshots hold lambertian, metal and dielectric materials only\n";
+				return false;
+			}
+			index = uint32_t(materials.size());
+			material_index.emplace(mat.get(), index);
+			materials.push_back({ uint32_t(d.kind), 0, { d.albedo.x(), d.albedo.y(), d.albedo.z() }, d.parameter });
+			return true;
+		}
+	};
+};
+
+#endif
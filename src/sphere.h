@@ -28,12 +28,100 @@ class sphere : public hittable
 		return hit_occured;
 	}
 
+	/* The same quadratic as hit, solved for a chunk of rays at a time in SIMD lanes */
+	void hit_stream(std::span<const ray> rays, std::span<interval> ray_t, std::span<hit_record> recs,
+					std::span<const uint8_t> active, std::span<uint8_t> hits) const override
+	{
+		const double cx = center.x(), cy = center.y(), cz = center.z(), radius_sqr = radius * radius;
+		auto kernel = [cx, cy, cz, radius_sqr](const ray_lanes& l, double* nearest, uint8_t*)
+		{
+			double a[ray_lanes::chunk], h[ray_lanes::chunk], inside_sqrt[ray_lanes::chunk];
+			double largest = -infinity;
+			#pragma omp simd reduction(max:largest)
+			for (int i = 0; i < ray_lanes::chunk; i++)
+			{
+				double ocx = cx - l.ox[i], ocy = cy - l.oy[i], ocz = cz - l.oz[i];
+				a[i] = l.dx[i] * l.dx[i] + l.dy[i] * l.dy[i] + l.dz[i] * l.dz[i];
+				h[i] = -0.5 * (-2.0 * (l.dx[i] * ocx + l.dy[i] * ocy + l.dz[i] * ocz));
+				double c = (ocx * ocx + ocy * ocy + ocz * ocz) - radius_sqr;
+				inside_sqrt[i] = h[i] * h[i] - a[i] * c;
+				largest = inside_sqrt[i] > largest ? inside_sqrt[i] : largest;
+			}
+
+			// Most chunks miss a small sphere entirely and stop here
+			if (!(largest >= 0.0))
+			{
+				std::fill(nearest, nearest + ray_lanes::chunk, infinity);
+				return;
+			}
+			#pragma omp simd
+			for (int i = 0; i < ray_lanes::chunk; i++)
+			{
+				bool solvable = (inside_sqrt[i] >= 0.0) & !((a[i] < epsilon) & (a[i] > -epsilon));
+				double sqrtd = std::sqrt(std::fmax(inside_sqrt[i], 0.0));
+				double t0 = (h[i] - sqrtd) / a[i], t1 = (h[i] + sqrtd) / a[i];
+				double near_root = t0 > t1 ? t1 : t0, far_root = t0 > t1 ? t0 : t1;
+				bool near_ok = (l.t_min[i] < near_root) & (near_root < l.t_max[i]);
+				bool far_ok = (l.t_min[i] < far_root) & (far_root < l.t_max[i]);
+				double t = near_ok ? near_root : (far_ok ? far_root : infinity);
+				nearest[i] = solvable ? t : infinity;
+			}
+		};
+		stream_lanes(rays, ray_t, recs, active, hits, kernel, [&](const ray& r, double t, uint8_t, hit_record& rec)
+		{
+			rec.t = t;
+			rec.p = r.at(t);
+			rec.set_face_normal(r, (rec.p - center) / radius);
+			rec.mat = mat;
+		});
+	}
+
+	/* Moves the sphere, containers holding it need a refit afterwards */
+	void move_to(const point3& new_center)
+	{
+		center = new_center;
+	}
+
 	// Implicit volume within radius
 	virtual bool volume_contains(const point3 p) const override
 	{
 		return (p - center).length_squared() <= radius * radius;
 	}
 
+	aabb bounding_box() const override
+	{
+		auto rvec = vec3(radius, radius, radius);
+		return aabb(center - rvec, center + rvec);
+	}
+
+	// Along each axis the ball only reaches as far as its distance to the region's other two sides allows
+	aabb clipped_box(const aabb& region) const override
+	{
+		interval extent[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double distance_squared = 0;
+			for (int other = 0; other < 3; other++)
+			{
+				if (other == axis)
+					continue;
+				const interval& range = region.axis_interval(other);
+				double gap = std::fmax(0.0, std::fmax(range.min - center[other], center[other] - range.max));
+				distance_squared += gap * gap;
+			}
+			if (distance_squared > radius * radius)
+				return aabb::empty;
+			double reach = std::sqrt(radius * radius - distance_squared);
+			const interval& range = region.axis_interval(axis);
+			extent[axis] = interval(std::fmax(range.min, center[axis] - reach), std::fmin(range.max, center[axis] + reach));
+		}
+		return aabb(extent[0], extent[1], extent[2]);
+	}
+
+	const point3& sphere_center() const { return center; }
+	double sphere_radius() const { return radius; }
+	const shared_ptr<material>& surface_material() const { return mat; }
+
   private:
 	point3 center;
 	double radius;
@@ -0,0 +1,43 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef STATS_H
+#define STATS_H
+
+/*
+ * Traversal work counters. Each thread counts into its own copy, so counting never contends,
+ * and whoever wants totals resets and sums them across the threads of a parallel region.
+ */
+struct ray_statistics
+{
+	uint64_t rays = 0;            // Rays the camera traced into the scene
+	uint64_t node_visits = 0;     // Acceleration structure nodes or cells stepped through
+	uint64_t primitive_tests = 0; // Intersection tests against objects
+	uint64_t marched_rays = 0;    // Rays sphere traced through a distance field's box
+	uint64_t march_steps = 0;     // Distance evaluations taken by those marches
+	uint64_t chunk_visits = 0;    // Streamed geometry chunks a ray reached
+	uint64_t chunk_misses = 0;    // Those of them that were not in memory
+	uint64_t packet_rays = 0;     // Rays a BVH traversed in packets rather than one at a time
+	uint64_t packet_steps = 0;    // Node boxes those packets were tested against
+	uint64_t packet_lanes = 0;    // Rays taking part in those tests, over packet_steps the packets' coherence
+
+	ray_statistics& operator+=(const ray_statistics& other)
+	{
+		rays += other.rays;
+		node_visits += other.node_visits;
+		primitive_tests += other.primitive_tests;
+		marched_rays += other.marched_rays;
+		march_steps += other.march_steps;
+		chunk_visits += other.chunk_visits;
+		chunk_misses += other.chunk_misses;
+		packet_rays += other.packet_rays;
+		packet_steps += other.packet_steps;
+		packet_lanes += other.packet_lanes;
+		return *this;
+	}
+};
+
+inline thread_local ray_statistics ray_stats;
+
+#endif
@@ -0,0 +1,474 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef STREAMED_MESH_H
+#define STREAMED_MESH_H
+
+#include "bvh.h"
+#include "hittable.h"
+#include "mesh.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Triangle mesh file split into spatially coherent chunks that load independently, native endianness:
+ * "RTCHUNKS", version, chunk count, one record per chunk, then each chunk's data from a page
+ * boundary, three floats per vertex followed by three uint32 corners per triangle indexing the
+ * chunk's own vertices.
+ */
+class chunked_mesh_file
+{
+  public:
+	static constexpr char magic[8] = { 'R', 'T', 'C', 'H', 'U', 'N', 'K', 'S' };
+	static constexpr uint32_t version = 1;
+	static constexpr uint64_t alignment = 4096;
+
+	struct header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t chunk_count;
+	};
+
+	struct record
+	{
+		double bounds[6];       // Min and max corners of the chunk's vertices
+		uint64_t offset;        // Start of the chunk's data in the file
+		uint32_t vertex_count;
+		uint32_t triangle_count;
+
+		size_t data_bytes() const { return size_t(vertex_count) * 3 * sizeof(float) + size_t(triangle_count) * 3 * sizeof(uint32_t); }
+	};
+
+	/*
+	 * Writes a mesh's positions and triangles as chunks of at most triangles_per_chunk triangles,
+	 * splitting at the median centroid along the widest axis so every chunk is a compact piece.
+	 */
+	static bool write(const std::string& filename, const mesh_buffers& mesh, uint32_t triangles_per_chunk = 16384)
+	{
+		std::vector<point3> centroids(mesh.triangle_count);
+		#pragma omp parallel for schedule(static)
+		for (long i = 0; i < long(centroids.size()); i++)
+		{
+			uint32_t c[3];
+			mesh.corners(uint32_t(i), c);
+			centroids[i] = (mesh.position(c[0]) + mesh.position(c[1]) + mesh.position(c[2])) / 3;
+		}
+		std::vector<uint32_t> order(mesh.triangle_count);
+		std::iota(order.begin(), order.end(), 0);
+
+		// Depth-first, so neighbouring chunks also sit near each other in the file
+		std::vector<std::pair<size_t, size_t>> chunks, pending = { { 0, order.size() } };
+		while (!pending.empty())
+		{
+			auto [begin, end] = pending.back();
+			pending.pop_back();
+			if (end - begin <= triangles_per_chunk)
+			{
+				if (end > begin)
+					chunks.push_back({ begin, end });
+				continue;
+			}
+			aabb spread;
+			for (size_t i = begin; i < end; i++)
+				spread = aabb(spread, aabb(centroids[order[i]], centroids[order[i]]));
+			int axis = spread.longest_axis();
+			size_t middle = begin + (end - begin) / 2;
+			std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+				[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+			pending.push_back({ middle, end });
+			pending.push_back({ begin, middle });
+		}
+
+		std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cerr << "Could not write " << filename << "\n";
+			return false;
+		}
+		header h;
+		std::memcpy(h.magic, magic, sizeof(magic));
+		h.version = version;
+		h.chunk_count = uint32_t(chunks.size());
+		std::vector<record> records(chunks.size());
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(record));
+
+		const uint32_t unused = 0xffffffffu;
+		std::vector<uint32_t> local(mesh.vertex_count, unused), used;
+		std::vector<float> positions;
+		std::vector<uint32_t> corners;
+		uint64_t offset = uint64_t(out.tellp());
+		for (size_t k = 0; k < chunks.size(); k++)
+		{
+			positions.clear();
+			corners.clear();
+			used.clear();
+			aabb bounds;
+			for (size_t i = chunks[k].first; i < chunks[k].second; i++)
+			{
+				uint32_t c[3];
+				mesh.corners(order[i], c);
+				for (uint32_t vertex : c)
+				{
+					if (local[vertex] == unused)
+					{
+						local[vertex] = uint32_t(used.size());
+						used.push_back(vertex);
+						point3 p = mesh.position(vertex);
+						positions.insert(positions.end(), { float(p.x()), float(p.y()), float(p.z()) });
+						bounds = aabb(bounds, aabb(p, p));
+					}
+					corners.push_back(local[vertex]);
+				}
+			}
+			for (uint32_t vertex : used)
+				local[vertex] = unused;
+
+			uint64_t start = (offset + alignment - 1) / alignment * alignment;
+			std::vector<char> padding(start - offset, 0);
+			out.write(padding.data(), padding.size());
+			out.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(float));
+			out.write(reinterpret_cast<const char*>(corners.data()), corners.size() * sizeof(uint32_t));
+
+			record& r = records[k];
+			double extents[6] = { bounds.x.min, bounds.y.min, bounds.z.min, bounds.x.max, bounds.y.max, bounds.z.max };
+			std::memcpy(r.bounds, extents, sizeof(extents));
+			r.offset = start;
+			r.vertex_count = uint32_t(used.size());
+			r.triangle_count = uint32_t(chunks[k].second - chunks[k].first);
+			offset = start + r.data_bytes();
+		}
+		out.seekp(sizeof(header));
+		out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(record));
+		if (!out)
+		{
+			std::cerr << "Could not write " << filename << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	/* Header and chunk records of a file, false with a message when it is not a chunked mesh */
+	static bool read_records(const std::string& filename, std::vector<record>& records)
+	{
+		std::ifstream in(filename, std::ios::binary);
+		header h;
+		if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+		{
+			std::cerr << filename << " is not a chunked mesh file\n";
+			return false;
+		}
+		if (h.version != version)
+		{
+			std::cerr << filename << " is chunked mesh version " << h.version << ", expected " << version << "\n";
+			return false;
+		}
+		records.resize(h.chunk_count);
+		if (!in.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(record)))
+		{
+			std::cerr << filename << " ends inside its chunk table\n";
+			return false;
+		}
+		return true;
+	}
+};
+
+/*
+ * Triangle mesh larger than memory, paged in from a chunked mesh file a chunk at a time. A bvh over
+ * the chunks' boxes stays resident, and each loaded chunk is a triangle_mesh with its own bvh.
+ *
+ * Loader threads read and build chunks in the background, and chunks are evicted least recently
+ * used first once the loaded ones pass the memory budget. A ray reaching a chunk that is not loaded
+ * asks for it, then either defers, when its tracing thread allows that (see ray_deferral), or waits.
+ * Deferring rays keep walking toward nearer chunks, so one pass requests every chunk that could hold
+ * the ray's closest hit.
+ */
+class streamed_mesh : public hittable
+{
+  public:
+	// Loader work and residency so far
+	struct streaming_statistics
+	{
+		uint64_t loads = 0;
+		uint64_t evictions = 0;
+		uint64_t bytes_read = 0;
+		double read_seconds = 0;  // Summed over loader threads
+		double build_seconds = 0; // Summed over loader threads
+		double stall_seconds = 0; // Summed over tracing threads waiting for chunks
+		size_t resident_chunks = 0;
+		size_t resident_bytes = 0;
+	};
+
+	/* Opens a chunked mesh file, nullptr with a message when it cannot be read */
+	static shared_ptr<streamed_mesh> open(const std::string& filename, shared_ptr<material> mat, size_t memory_budget,
+										  int loader_threads = 2)
+	{
+		std::vector<chunked_mesh_file::record> records;
+		if (!chunked_mesh_file::read_records(filename, records))
+			return nullptr;
+		return shared_ptr<streamed_mesh>(new streamed_mesh(filename, std::move(records), mat, memory_budget, loader_threads));
+	}
+
+	~streamed_mesh()
+	{
+		{
+			std::lock_guard<std::mutex> guard(queue_lock);
+			stopping = true;
+		}
+		queue_ready.notify_all();
+		for (auto& loader : loaders)
+			loader.join();
+	}
+
+	streamed_mesh(const streamed_mesh&) = delete;
+	streamed_mesh& operator=(const streamed_mesh&) = delete;
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		uint64_t visits = 0, misses = 0;
+		uint64_t now = use_clock.load(std::memory_order_relaxed);
+		bool hit_anything = top.traverse(r, ray_t, [&](uint32_t c, interval& t)
+		{
+			visits++;
+			chunk_slot& slot = slots[c];
+			shared_ptr<const triangle_mesh> mesh = slot.mesh.load(std::memory_order_acquire);
+			if (!mesh)
+			{
+				misses++;
+				if (deferral.allowed)
+				{
+					// Chunks past this one may be hidden by it, so the walk goes on only to nearer ones
+					request(c);
+					deferral.deferred = true;
+					interval chunk_t = t;
+					if (boxes[c].hit(r.origin(), r.inverse_direction(), chunk_t))
+						t.max = chunk_t.min;
+					return false;
+				}
+				mesh = wait_for(c);
+			}
+			if (slot.last_used.load(std::memory_order_relaxed) != now)
+				slot.last_used.store(now, std::memory_order_relaxed);
+
+			if (!mesh->hit(r, t, rec))
+				return false;
+			t.max = rec.t;
+			return true;
+		});
+		ray_stats.chunk_visits += visits;
+		ray_stats.chunk_misses += misses;
+		return hit_anything;
+	}
+
+	/* Treated as a surface, an inside test would page in every chunk along its probe */
+	bool volume_contains(const point3) const override
+	{
+		return false;
+	}
+
+	aabb bounding_box() const override
+	{
+		return top.bounds();
+	}
+
+	size_t chunk_count() const { return records.size(); }
+
+	streaming_statistics statistics() const
+	{
+		std::lock_guard<std::mutex> guard(residency_lock);
+		streaming_statistics s = totals;
+		s.stall_seconds = stall_nanoseconds.load() * 1e-9;
+		s.resident_chunks = resident.size();
+		s.resident_bytes = resident_bytes;
+		return s;
+	}
+
+  private:
+	enum chunk_state { on_disk, queued, loaded };
+
+	struct chunk_slot
+	{
+		std::atomic<shared_ptr<const triangle_mesh>> mesh;
+		std::atomic<int> state { on_disk };
+		std::atomic<uint64_t> last_used { 0 }; // use_clock when a ray last reached it
+		size_t bytes = 0;                       // Memory of the loaded mesh, under residency_lock
+	};
+
+	std::string filename;
+	std::vector<chunked_mesh_file::record> records;
+	shared_ptr<material> mat;
+	size_t memory_budget;
+	std::vector<aabb> boxes;
+	bvh_tree top;
+	std::unique_ptr<chunk_slot[]> slots;
+	std::vector<std::thread> loaders;
+
+	// Requests, guarded by queue_lock. chunk_loaded wakes tracing threads waiting for a chunk
+	mutable std::mutex queue_lock;
+	mutable std::condition_variable queue_ready, chunk_loaded;
+	mutable std::deque<uint32_t> queue;
+	bool stopping = false;
+
+	// Residency, guarded by residency_lock. Every load advances use_clock, so chunks reached since share its value
+	mutable std::mutex residency_lock;
+	std::vector<uint32_t> resident;
+	size_t resident_bytes = 0;
+	streaming_statistics totals;
+	std::atomic<uint64_t> use_clock { 1 };
+	mutable std::atomic<uint64_t> stall_nanoseconds { 0 };
+
+	streamed_mesh(const std::string& filename, std::vector<chunked_mesh_file::record> chunk_records,
+				  shared_ptr<material> mat, size_t memory_budget, int loader_threads)
+		: filename(filename), records(std::move(chunk_records)), mat(mat), memory_budget(memory_budget),
+		  slots(new chunk_slot[records.size()])
+	{
+		for (const auto& r : records)
+			boxes.push_back(aabb(point3(r.bounds[0], r.bounds[1], r.bounds[2]), point3(r.bounds[3], r.bounds[4], r.bounds[5])));
+		top.build(boxes);
+		for (int i = 0; i < std::max(1, loader_threads); i++)
+			loaders.emplace_back([this] { load_requests(); });
+	}
+
+	// Queues a chunk unless it is already queued or loaded, the caller holds queue_lock
+	void enqueue(uint32_t c) const
+	{
+		int expected = on_disk;
+		if (slots[c].state.compare_exchange_strong(expected, queued))
+		{
+			queue.push_back(c);
+			queue_ready.notify_one();
+		}
+	}
+
+	void request(uint32_t c) const
+	{
+		if (slots[c].state.load(std::memory_order_relaxed) != on_disk)
+			return;
+		std::lock_guard<std::mutex> guard(queue_lock);
+		enqueue(c);
+	}
+
+	shared_ptr<const triangle_mesh> wait_for(uint32_t c) const
+	{
+		auto start = std::chrono::steady_clock::now();
+		shared_ptr<const triangle_mesh> mesh;
+		{
+			// Asks again each time it wakes, the chunk may have been evicted before this thread got to it
+			std::unique_lock<std::mutex> lock(queue_lock);
+			while (!(mesh = slots[c].mesh.load(std::memory_order_acquire)))
+			{
+				enqueue(c);
+				chunk_loaded.wait(lock);
+			}
+		}
+		auto waited = std::chrono::steady_clock::now() - start;
+		stall_nanoseconds += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+		return mesh;
+	}
+
+	void load_requests()
+	{
+		std::ifstream in(filename, std::ios::binary);
+		while (true)
+		{
+			uint32_t c;
+			{
+				std::unique_lock<std::mutex> lock(queue_lock);
+				queue_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+				if (stopping)
+					return;
+				c = queue.front();
+				queue.pop_front();
+			}
+			install(c, load(in, c));
+		}
+	}
+
+	// Reads and builds one chunk, a chunk that cannot be read loads empty so rays never wait on it forever
+	shared_ptr<const triangle_mesh> load(std::ifstream& in, uint32_t c)
+	{
+		const chunked_mesh_file::record& r = records[c];
+		auto buffers = make_shared<mesh_buffers>();
+		buffers->position_storage.resize(size_t(r.vertex_count) * 3);
+		buffers->index_storage.resize(size_t(r.triangle_count) * 3);
+
+		auto read_start = std::chrono::steady_clock::now();
+		in.clear();
+		in.seekg(std::streamoff(r.offset));
+		in.read(reinterpret_cast<char*>(buffers->position_storage.data()), buffers->position_storage.size() * sizeof(float));
+		in.read(reinterpret_cast<char*>(buffers->index_storage.data()), buffers->index_storage.size() * sizeof(uint32_t));
+		if (!in)
+		{
+			std::cerr << "Could not read chunk " << c << " of " << filename << "\n";
+			buffers->position_storage.clear();
+			buffers->index_storage.clear();
+		}
+		auto build_start = std::chrono::steady_clock::now();
+		buffers->use_storage();
+		auto mesh = make_shared<const triangle_mesh>(buffers, mat);
+		auto end = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> guard(residency_lock);
+		totals.bytes_read += r.data_bytes();
+		totals.read_seconds += std::chrono::duration<double>(build_start - read_start).count();
+		totals.build_seconds += std::chrono::duration<double>(end - build_start).count();
+		return mesh;
+	}
+
+	// Publishes a loaded chunk, then evicts the least recently used others while over budget
+	void install(uint32_t c, shared_ptr<const triangle_mesh> mesh)
+	{
+		{
+			std::lock_guard<std::mutex> guard(residency_lock);
+			chunk_slot& slot = slots[c];
+			slot.bytes = mesh->memory_bytes();
+			slot.last_used.store(use_clock.fetch_add(1) + 1, std::memory_order_relaxed);
+			slot.mesh.store(std::move(mesh), std::memory_order_release);
+			slot.state.store(loaded);
+			resident.push_back(c);
+			resident_bytes += slot.bytes;
+			totals.loads++;
+
+			while (resident_bytes > memory_budget && resident.size() > 1)
+			{
+				size_t victim = resident[0] == c ? 1 : 0;
+				for (size_t i = 0; i < resident.size(); i++)
+				{
+					if (resident[i] != c && slots[resident[i]].last_used.load(std::memory_order_relaxed)
+						< slots[resident[victim]].last_used.load(std::memory_order_relaxed))
+						victim = i;
+				}
+				// Rays still using the mesh hold their own reference, it is freed when the last one lets go
+				chunk_slot& evicted = slots[resident[victim]];
+				evicted.mesh.store(nullptr, std::memory_order_release);
+				evicted.state.store(on_disk);
+				resident_bytes -= evicted.bytes;
+				resident[victim] = resident.back();
+				resident.pop_back();
+				totals.evictions++;
+			}
+		}
+		{
+			// A waiter checks for the mesh under queue_lock, taking it here means none can miss this wake-up
+			std::lock_guard<std::mutex> guard(queue_lock);
+		}
+		chunk_loaded.notify_all();
+	}
+};
+
+#endif
@@ -0,0 +1,129 @@
+// Copyright (c) 2026 Kyle Bueche
+// SPDX-License-Identifier: MIT
+// Author: Kyle Bueche
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+/* Affine transform, a 3x3 linear part followed by a translation */
+class affine
+{
+  public:
+	double m[3][3];
+	vec3 t;
+
+	affine() : m{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } } {}
+
+	static affine translation(const vec3& offset)
+	{
+		affine a;
+		a.t = offset;
+		return a;
+	}
+
+	static affine scaling(const vec3& s)
+	{
+		affine a;
+		a.m[0][0] = s.x();
+		a.m[1][1] = s.y();
+		a.m[2][2] = s.z();
+		return a;
+	}
+
+	static affine scaling(double s)
+	{
+		return scaling(vec3(s, s, s));
+	}
+
+	// Right-handed rotation about an axis through the origin
+	static affine rotation(const vec3& axis, double degrees)
+	{
+		vec3 k = unit_vector(axis);
+		double theta = degrees_to_radians(degrees);
+		double c = std::cos(theta), s = std::sin(theta), v = 1 - c;
+
+		affine a;
+		a.m[0][0] = k.x() * k.x() * v + c;
+		a.m[0][1] = k.x() * k.y() * v - k.z() * s;
+		a.m[0][2] = k.x() * k.z() * v + k.y() * s;
+		a.m[1][0] = k.y() * k.x() * v + k.z() * s;
+		a.m[1][1] = k.y() * k.y() * v + c;
+		a.m[1][2] = k.y() * k.z() * v - k.x() * s;
+		a.m[2][0] = k.z() * k.x() * v - k.y() * s;
+		a.m[2][1] = k.z() * k.y() * v + k.x() * s;
+		a.m[2][2] = k.z() * k.z() * v + c;
+		return a;
+	}
+
+	point3 point(const point3& p) const
+	{
+		return vector(p) + t;
+	}
+
+	vec3 vector(const vec3& v) const
+	{
+		return vec3(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+					m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+					m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+	}
+
+	// Multiplies by the transposed linear part, which maps normals back through the inverse transform
+	vec3 transpose_vector(const vec3& v) const
+	{
+		return vec3(m[0][0] * v[0] + m[1][0] * v[1] + m[2][0] * v[2],
+					m[0][1] * v[0] + m[1][1] * v[1] + m[2][1] * v[2],
+					m[0][2] * v[0] + m[1][2] * v[1] + m[2][2] * v[2]);
+	}
+
+	affine inverse() const
+	{
+		double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+				   - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+				   + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+		double inv_det = 1.0 / det;
+
+		affine a;
+		a.m[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv_det;
+		a.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv_det;
+		a.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv_det;
+		a.m[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv_det;
+		a.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv_det;
+		a.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv_det;
+		a.m[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv_det;
+		a.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv_det;
+		a.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv_det;
+		a.t = -a.vector(t);
+		return a;
+	}
+
+	/* Box around the transformed corners of a box, unbounded boxes stay unbounded */
+	aabb bounds(const aabb& box) const
+	{
+		if (!box.is_bounded())
+			return box.is_empty() ? box : aabb::universe;
+
+		aabb result;
+		for (int i = 0; i < 8; i++)
+		{
+			point3 corner((i & 1) ? box.x.max : box.x.min, (i & 2) ? box.y.max : box.y.min, (i & 4) ? box.z.max : box.z.min);
+			point3 p = point(corner);
+			result = aabb(result, aabb(p, p));
+		}
+		return result;
+	}
+};
+
+// Applies b first, then a
+inline affine operator*(const affine& a, const affine& b)
+{
+	affine c;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			c.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+	}
+	c.t = a.point(b.t);
+	return c;
+}
+
+#endif